@@ -27,12 +27,32 @@ ELL_DEFSYM(core_lam,  "ell-lam")
 ELL_DEFSYM(core_app,  "ell-app")
 /* (ell-loop expr) ;; infinite loop */
 ELL_DEFSYM(core_loop, "ell-loop")
+/* (ell-while test expr) ;; loop as long as test is true */
+ELL_DEFSYM(core_while, "ell-while")
+/* (ell-dlet name value body) -> result ;; dynamically bind global variable during body */
+ELL_DEFSYM(core_dlet, "ell-dlet")
 /* (ell-mdef name expander) ;; define macro expander function, that takes and returns syntax */
 ELL_DEFSYM(core_mdef, "ell-mdef")
 /* (ell-snip &rest exprs) ;; Inline C; contains C strings (emitted as-is) and Lisp exprs */
 ELL_DEFSYM(core_snip, "ell-snip")
 /* (ell-stmt &rest exprs) ;; Like ell-snip, but code is emitted as C top-level declarations  */
 ELL_DEFSYM(core_stmt, "ell-stmt")
+/* (ell-declare &rest specs) ;; Optimization policy and parameter types, see `ellc_norm_declare' */
+ELL_DEFSYM(core_declare, "ell-declare")
+/* (ell-the type expr) ;; Promises that expr's value has the type */
+ELL_DEFSYM(core_the, "ell-the")
+/* (ell-mvb (var ...) expr body) ;; Binds the vars to the multiple values of expr */
+ELL_DEFSYM(core_mvb, "ell-mvb")
+/* (ell-ltv expr) ;; Value of expr, evaluated once when the unit is loaded */
+ELL_DEFSYM(core_ltv, "ell-ltv")
+/* (ell-ctv expr) ;; Value of expr, evaluated during compilation; must be a literal */
+ELL_DEFSYM(core_ctv, "ell-ctv")
+/* (ell-cfun name c-name (param-type ...) result-type) ;; define global function calling C function */
+ELL_DEFSYM(core_cfun, "ell-cfun")
+/* (ell-ccall c-name (param-type ...) result-type &rest args) -> result ;; call C function */
+ELL_DEFSYM(core_ccall, "ell-ccall")
+/* (ell-mbind params form body) -> result ;; bind params to the arguments of macro call form */
+ELL_DEFSYM(core_mbind, "ell-mbind")
 
 /* Data and syntax quotation: */
 ELL_DEFSYM(core_quote, "quote")
@@ -60,8 +80,43 @@ ELL_DEFSYM(core_send, "send")
 ELL_DEFSYM(core_syntax_list, "syntax-list")
 ELL_DEFSYM(core_append_syntax_lists, "append-syntax-lists")
 ELL_DEFSYM(core_apply_syntax_list, "apply-syntax-list")
+ELL_DEFSYM(core_syntax_list_rest, "syntax-list-rest")
+ELL_DEFSYM(core_syntax_list_length, "syntax-list-length")
+ELL_DEFSYM(core_syntax_list_ref, "syntax-list-ref")
+ELL_DEFSYM(core_syntax_list_tail, "syntax-list-tail")
+ELL_DEFSYM(core_syntax_list_key_p, "syntax-list-key-p")
+ELL_DEFSYM(core_syntax_list_key, "syntax-list-key")
+ELL_DEFSYM(core_check_syntax_list_length, "check-syntax-list-length")
 ELL_DEFSYM(default_handle, "default-handle")
 
+/* Built-in functions that the compiler open-codes, as long as they
+   aren't lexically shadowed or redefined in the compilation unit: */
+ELL_DEFSYM(prim_add, "+")
+ELL_DEFSYM(prim_sub, "-")
+ELL_DEFSYM(prim_mul, "*")
+ELL_DEFSYM(prim_lt, "<")
+/* With a quoted slot name, these get an inline cache per call site: */
+ELL_DEFSYM(prim_slot_value, "slot-value")
+ELL_DEFSYM(prim_set_slot_value, "set-slot-value")
+/* With keyword arguments, this gets a cache of slot indexes per call site: */
+ELL_DEFSYM(prim_make, "make")
+/* Up to ELL_MAX_VALUES values, and with a literal index, respectively: */
+ELL_DEFSYM(prim_values, "values")
+ELL_DEFSYM(prim_multiple_value_ref, "multiple-value-ref")
+/* Additionally, these are compiled to C conditions in test position: */
+ELL_DEFSYM(prim_typeq, "type?")
+ELL_DEFSYM(prim_t, "#t")
+ELL_DEFSYM(prim_f, "#f")
+ELL_DEFSYM(prim_integer_class, "<integer>")
+/* These call their function arguments only during their own extent,
+   so lambdas passed to them are allocated on the stack: */
+ELL_DEFSYM(prim_block, "block/f")
+ELL_DEFSYM(prim_unwind_protect, "unwind-protect/f")
+ELL_DEFSYM(prim_handler_bind, "handler-bind/f")
+ELL_DEFSYM(prim_with_restart, "with-restart/f")
+ELL_DEFSYM(prim_map_list, "map-list")
+ELL_DEFSYM(prim_map_column, "map-column")
+
 /* Note that there are additional built-in functions defined in
    `ellrt,c' that are not listed here, which is a documentation bug. */
 
@@ -71,3 +126,18 @@ ELL_DEFSYM(param_optional, "&optional")
 ELL_DEFSYM(param_key, "&key")
 ELL_DEFSYM(param_rest, "&rest")
 ELL_DEFSYM(param_all_keys, "&all-keys")
+
+/* Declaration specifiers of ell-declare: */
+ELL_DEFSYM(decl_inline, "inline")
+ELL_DEFSYM(decl_optimize, "optimize")
+ELL_DEFSYM(decl_safety, "safety")
+ELL_DEFSYM(decl_type, "type")
+
+/* C types of ell-ccall, in addition to <integer>: */
+ELL_DEFSYM(ctype_boolean, "<boolean>")
+ELL_DEFSYM(ctype_string, "<string>")
+ELL_DEFSYM(ctype_object, "<object>")
+ELL_DEFSYM(ctype_unspecified, "<unspecified>")
+
+/* Class options of put-class-option: */
+ELL_DEFSYM(class_option_pooled, "pooled")
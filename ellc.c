@@ -11,7 +11,10 @@
 //                                                              //
 //////////////////////////////////////////////////////////////////
 
+#define _GNU_SOURCE // RTLD_DEFAULT
 #include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
 #include <dlfcn.h>
 
 #include "ellc.h"
@@ -88,6 +91,18 @@ ellc_param_boxed(struct ellc_param *p)
     return (p->closed && p->mutable);
 }
 
+static int
+ellc_param_heap_boxed(struct ellc_param *p)
+{
+    return ellc_param_boxed(p) && p->escaping;
+}
+
+static int
+ellc_param_stack_boxed(struct ellc_param *p)
+{
+    return ellc_param_boxed(p) && !p->escaping;
+}
+
 /**** Lexical Contour Utilities ****/
 
 static struct ellc_param *
@@ -129,6 +144,17 @@ ellc_contour_lookup(struct ellc_contour *c, struct ellc_id *id, struct ellc_para
     }
 }
 
+// Returns the contour of the C function containing the contour C,
+// i.e. the nearest contour from C upwards that's not inlined, or NULL
+// for the top-level.
+static struct ellc_contour *
+ellc_function_contour(struct ellc_contour *c)
+{
+    while (c && c->lam->inlined)
+        c = c->up;
+    return c;
+}
+
 /**** Normalization: Syntax Objects -> AST ****/
 
 /* Table of normalization functions. */
@@ -432,6 +458,7 @@ ellc_norm_lam(struct ellc_st *st, struct ell_obj *stx_lst)
     dict_t *deferred_inits = ell_util_make_dict((dict_comp_t) &ell_ptr_cmp); // param -> init_stx
 
     ast->lam.params = ellc_dissect_params(st, ell_stx_lst_elts(params_stx), deferred_inits);
+    ast->lam.safety = c->up ? c->up->lam->safety : st->safety;
 
     for (dnode_t *dn = dict_first(deferred_inits); dn; dn = dict_next(deferred_inits, dn)) {
         struct ellc_param *param = (struct ellc_param *) dnode_getkey(dn);
@@ -469,6 +496,30 @@ ellc_norm_loop(struct ellc_st *st, struct ell_obj *stx_lst)
     return ast;
 }
 
+static struct ellc_ast *
+ellc_norm_while(struct ellc_st *st, struct ell_obj *stx_lst)
+{
+    ell_assert_stx_lst_len(stx_lst, 3);
+    struct ellc_ast *ast = ellc_make_ast(ELLC_AST_LOOP);
+    ast->loop.test = ellc_norm_stx(st, ELL_SEND(stx_lst, second));
+    ast->loop.body = ellc_norm_stx(st, ELL_SEND(stx_lst, third));
+    return ast;
+}
+
+static struct ellc_ast *
+ellc_norm_dlet(struct ellc_st *st, struct ell_obj *stx_lst)
+{
+    ell_assert_stx_lst_len(stx_lst, 4);
+    struct ellc_ast *ast = ellc_make_ast(ELLC_AST_DLET);
+    struct ell_obj *stx_sym = ELL_SEND(stx_lst, second);
+    ell_assert_wrapper(stx_sym, ELL_WRAPPER(stx_sym));
+    ast->dlet.id = ellc_make_id_cx(ell_stx_sym_sym(stx_sym), ELLC_NS_VAR,
+                                   ell_stx_sym_cx(stx_sym));
+    ast->dlet.val = ellc_norm_stx(st, ELL_SEND(stx_lst, third));
+    ast->dlet.body = ellc_norm_stx(st, ELL_SEND(stx_lst, fourth));
+    return ast;
+}
+
 /* (Quasisyntax) */
 
 static struct ellc_ast *
@@ -479,7 +530,8 @@ ellc_build_syntax(struct ellc_st *st, struct ell_obj *stx)
 {
     struct ellc_ast *ast = ellc_make_ast(ELLC_AST_LIT_STX);
     if (!((stx->wrapper == ELL_WRAPPER(stx_sym))
-          || (stx->wrapper == ELL_WRAPPER(stx_str)))) {
+          || (stx->wrapper == ELL_WRAPPER(stx_str))
+          || (stx->wrapper == ELL_WRAPPER(stx_num)))) {
         ell_fail("can't build syntax AST from non-syntax object\n");
     }
     ast->lit_stx.stx = stx;
@@ -624,7 +676,8 @@ ellc_norm_qs(struct ellc_st *st, struct ell_obj *arg_stx, unsigned depth)
     }
 
     if ((arg_stx->wrapper == ELL_WRAPPER(stx_str)) ||
-        (arg_stx->wrapper == ELL_WRAPPER(stx_sym))) {
+        (arg_stx->wrapper == ELL_WRAPPER(stx_sym)) ||
+        (arg_stx->wrapper == ELL_WRAPPER(stx_num))) {
         return ellc_build_syntax(st, arg_stx);
     } else if (arg_stx->wrapper == ELL_WRAPPER(stx_lst)) {
         return ellc_norm_qs_lst(st, arg_stx, depth);
@@ -701,8 +754,475 @@ ellc_norm_stmt(struct ellc_st *st, struct ell_obj *stx_lst)
     return ast;
 }
 
+/* (Declarations) */
+
+/* Returns the level of an optimization quality, which is either a
+   symbol, meaning level 3, or a list of the symbol and its level. */
+static int
+ellc_quality_level(struct ell_obj *quality_stx, struct ell_obj **sym)
+{
+    if (quality_stx->wrapper == ELL_WRAPPER(stx_sym)) {
+        *sym = ell_stx_sym_sym(quality_stx);
+        return 3;
+    }
+    ell_assert_stx_lst_len(quality_stx, 2);
+    *sym = ell_stx_sym_sym(ELL_SEND(quality_stx, first));
+    struct ell_obj *level_stx = ELL_SEND(quality_stx, second);
+    ell_assert_wrapper(level_stx, ELL_WRAPPER(stx_num));
+    int level = ell_num_int(ell_stx_num_num(level_stx));
+    if ((level < 0) || (level > 3))
+        ell_fail("optimization level out of range: %d\n", level);
+    return level;
+}
+
+/* (optimize quality...): Only SAFETY affects the generated code,
+   other qualities such as SPEED are accepted and ignored. */
+static void
+ellc_declare_optimize(struct ellc_st *st, list_t *qualities_stx)
+{
+    for (lnode_t *n = list_first(qualities_stx); n; n = list_next(qualities_stx, n)) {
+        struct ell_obj *sym;
+        int level = ellc_quality_level((struct ell_obj *) lnode_get(n), &sym);
+        if (sym != ELL_SYM(decl_safety)) continue;
+        if (st->bottom_contour)
+            st->bottom_contour->lam->safety = level;
+        else
+            st->safety = level;
+    }
+}
+
+/* (type type-name param...): Declares required parameters of the
+   innermost lambda.  Types other than <integer> are ignored. */
+static void
+ellc_declare_type(struct ellc_st *st, list_t *elts_stx)
+{
+    if (!st->bottom_contour || list_isempty(elts_stx)) return;
+    struct ell_obj *type_stx = (struct ell_obj *) lnode_get(list_first(elts_stx));
+    if (ell_stx_sym_sym(type_stx) != ELL_SYM(prim_integer_class)) return;
+    list_t *req = st->bottom_contour->lam->params->req;
+    for (lnode_t *n = list_next(elts_stx, list_first(elts_stx)); n; n = list_next(elts_stx, n)) {
+        struct ell_obj *name_stx = (struct ell_obj *) lnode_get(n);
+        struct ellc_id *id = ellc_make_id_cx(ell_stx_sym_sym(name_stx), ELLC_NS_VAR,
+                                             ell_stx_sym_cx(name_stx));
+        struct ellc_param *p = ellc_params_list_lookup(req, id);
+        if (p)
+            p->declared = ELLC_TYPE_FIXNUM;
+    }
+}
+
+/* (inline name...): Declares top-level functions of the unit to be
+   exported for inlining into other units (see `ellc_export_inline').
+   Only has an effect at the top-level. */
+static void
+ellc_declare_inline(struct ellc_st *st, list_t *names_stx)
+{
+    if (st->bottom_contour) return;
+    for (lnode_t *n = list_first(names_stx); n; n = list_next(names_stx, n)) {
+        struct ell_obj *name_stx = (struct ell_obj *) lnode_get(n);
+        ell_assert_wrapper(name_stx, ELL_WRAPPER(stx_sym));
+        ell_util_set_add(st->inline_decls, ell_stx_sym_sym(name_stx), (dict_comp_t) &ell_ptr_cmp);
+    }
+}
+
+/* Declarations apply to the innermost lambda whose body they appear
+   in, or at the top-level, to the lambdas in the rest of the unit.  They
+   don't evaluate to anything, so they normalize to an empty sequence. */
+static struct ellc_ast *
+ellc_norm_declare(struct ellc_st *st, struct ell_obj *stx_lst)
+{
+    list_t *specs_stx = ell_util_sublist(ell_stx_lst_elts(stx_lst), 1);
+    for (lnode_t *n = list_first(specs_stx); n; n = list_next(specs_stx, n)) {
+        struct ell_obj *spec_stx = (struct ell_obj *) lnode_get(n);
+        ell_assert_stx_lst_len_min(spec_stx, 1);
+        struct ell_obj *spec_sym = ell_stx_sym_sym(ELL_SEND(spec_stx, first));
+        list_t *args_stx = ell_util_sublist(ell_stx_lst_elts(spec_stx), 1);
+        if (spec_sym == ELL_SYM(decl_optimize))
+            ellc_declare_optimize(st, args_stx);
+        else if (spec_sym == ELL_SYM(decl_type))
+            ellc_declare_type(st, args_stx);
+        else if (spec_sym == ELL_SYM(decl_inline))
+            ellc_declare_inline(st, args_stx);
+    }
+    struct ellc_ast *ast = ellc_make_ast(ELLC_AST_SEQ);
+    ast->seq.exprs = ell_util_make_list();
+    return ast;
+}
+
+static struct ellc_ast *
+ellc_norm_the(struct ellc_st *st, struct ell_obj *stx_lst)
+{
+    ell_assert_stx_lst_len(stx_lst, 3);
+    struct ell_obj *type_sym = ell_stx_sym_sym(ELL_SEND(stx_lst, second));
+    struct ellc_ast *expr = ellc_norm_stx(st, ELL_SEND(stx_lst, third));
+    if (type_sym != ELL_SYM(prim_integer_class))
+        return expr;
+    struct ellc_ast *ast = ellc_make_ast(ELLC_AST_THE);
+    ast->the.type = type_sym;
+    ast->the.expr = expr;
+    return ast;
+}
+
+/* (Load-Time and Compile-Time Values) */
+
+/* The expression is normalized at the top-level, as it's evaluated
+   outside of any lambda. */
+static struct ellc_ast *
+ellc_norm_ltv(struct ellc_st *st, struct ell_obj *stx_lst)
+{
+    ell_assert_stx_lst_len(stx_lst, 2);
+    struct ellc_ast *init = ellc_make_ast(ELLC_AST_LTV);
+    init->ltv.index = st->nltvs++;
+    struct ellc_contour *c = st->bottom_contour;
+    st->bottom_contour = NULL;
+    init->ltv.init = ellc_norm_stx(st, ELL_SEND(stx_lst, second));
+    st->bottom_contour = c;
+    ell_util_list_add(st->ltv_inits, init);
+    struct ellc_ast *ast = ellc_make_ast(ELLC_AST_LTV);
+    ast->ltv.index = init->ltv.index;
+    return ast;
+}
+
+/* The expression is evaluated during compilation, and its value
+   becomes a literal, so it must be a symbol, string, integer or
+   boolean. */
+static struct ellc_ast *
+ellc_norm_ctv(struct ellc_st *st, struct ell_obj *stx_lst)
+{
+    ell_assert_stx_lst_len(stx_lst, 2);
+    struct ell_obj *expr_stx_lst = ell_make_stx_lst();
+    ELL_SEND(expr_stx_lst, add, ELL_SEND(stx_lst, second));
+    struct ell_obj *val = ellc_eval(expr_stx_lst);
+    struct ellc_ast *ast;
+    if (val->wrapper == ELL_WRAPPER(sym)) {
+        ast = ellc_make_ast(ELLC_AST_LIT_SYM);
+        ast->lit_sym.sym = val;
+    } else if (val->wrapper == ELL_WRAPPER(str)) {
+        ast = ellc_make_ast(ELLC_AST_LIT_STR);
+        ast->lit_str.str = val;
+    } else if (val->wrapper == ELL_WRAPPER(num_int)) {
+        ast = ellc_make_ast(ELLC_AST_LIT_NUM);
+        ast->lit_num.num = val;
+    } else if ((val == ell_t) || (val == ell_f)) {
+        ast = ellc_make_ref(st, ell_make_stx_sym(val == ell_t ? ELL_SYM(prim_t) : ELL_SYM(prim_f)),
+                            ELLC_NS_VAR);
+    } else {
+        ell_fail("compile-time value is not a literal\n");
+    }
+    return ast;
+}
+
+/* (Multiple Values) */
+
+static struct ell_obj *
+ellc_make_stx_lst_of(unsigned n, ...)
+{
+    struct ell_obj *stx = ell_make_stx_lst();
+    va_list ap;
+    va_start(ap, n);
+    for (unsigned i = 0; i < n; i++)
+        ELL_SEND(stx, add, va_arg(ap, struct ell_obj *));
+    va_end(ap);
+    return stx;
+}
+
+/* (ell-mvb (var ...) expr body) is rewritten to
+
+       (ell-app (ell-lam (var1)
+                  (ell-app (ell-lam (var2 ... varN) body)
+                           (multiple-value-ref var1 1) ...
+                           (multiple-value-ref var1 N-1)))
+                expr)
+
+   where the applications of inline lambdas compile to plain variable
+   bindings, and the MULTIPLE-VALUE-REFs with literal indexes to
+   direct reads of the multiple values buffer. */
+static struct ellc_ast *
+ellc_norm_mvb(struct ellc_st *st, struct ell_obj *stx_lst)
+{
+    ell_assert_stx_lst_len(stx_lst, 4);
+    struct ell_obj *vars_stx = ELL_SEND(stx_lst, second);
+    ell_assert_stx_lst_len_min(vars_stx, 1);
+    list_t *vars = ell_stx_lst_elts(vars_stx);
+    struct ell_obj *primary_stx = (struct ell_obj *) lnode_get(list_first(vars));
+    struct ell_obj *extra_vars_stx = ell_make_stx_lst();
+    struct ell_obj *inner_stx =
+        ellc_make_stx_lst_of(1, ell_make_stx_sym(ELL_SYM(core_app)));
+    ELL_SEND(inner_stx, add,
+             ellc_make_stx_lst_of(3, ell_make_stx_sym(ELL_SYM(core_lam)), extra_vars_stx,
+                                  ELL_SEND(stx_lst, fourth)));
+    int i = 1;
+    for (lnode_t *n = list_next(vars, list_first(vars)); n; n = list_next(vars, n), i++) {
+        ELL_SEND(extra_vars_stx, add, (struct ell_obj *) lnode_get(n));
+        ELL_SEND(inner_stx, add,
+                 ellc_make_stx_lst_of(3, ell_make_stx_sym(ELL_SYM(prim_multiple_value_ref)),
+                                      primary_stx,
+                                      ell_make_stx_num(ell_make_num_from_int(i))));
+    }
+    struct ell_obj *outer_lam_stx =
+        ellc_make_stx_lst_of(3, ell_make_stx_sym(ELL_SYM(core_lam)),
+                             ellc_make_stx_lst_of(1, primary_stx), inner_stx);
+    return ellc_norm_stx(st, ellc_make_stx_lst_of(3, ell_make_stx_sym(ELL_SYM(core_app)),
+                                                  outer_lam_stx, ELL_SEND(stx_lst, third)));
+}
+
+/* (Macro Lambda Lists) */
+
+static struct ell_obj *
+ellc_make_stx_int(int i)
+{
+    return ell_make_stx_num(ell_make_num_from_int(i));
+}
+
+static struct ell_obj *
+ellc_make_stx_call(struct ell_obj *fun_sym, struct ell_obj *form_stx, int i)
+{
+    return ellc_make_stx_lst_of(3, ell_make_stx_sym(fun_sym), form_stx, ellc_make_stx_int(i));
+}
+
+/* Wraps BODY in the binding of a single variable to VAL. */
+static struct ell_obj *
+ellc_make_stx_let1(struct ell_obj *var_stx, struct ell_obj *val_stx, struct ell_obj *body_stx)
+{
+    return ellc_make_stx_lst_of(3, ell_make_stx_sym(ELL_SYM(core_app)),
+                                ellc_make_stx_lst_of(3, ell_make_stx_sym(ELL_SYM(core_lam)),
+                                                     ellc_make_stx_lst_of(1, var_stx), body_stx),
+                                val_stx);
+}
+
+/* Returns the name of an optional or keyword parameter, and its init
+   form in INIT_STX. */
+static struct ell_obj *
+ellc_mbind_param(struct ell_obj *p_stx, struct ell_obj **init_stx)
+{
+    if (p_stx->wrapper == ELL_WRAPPER(stx_lst)) {
+        ell_assert_stx_lst_len(p_stx, 2);
+        *init_stx = ELL_SEND(p_stx, second);
+        return ELL_SEND(p_stx, first);
+    }
+    // Like an unsupplied optional parameter of a lambda
+    *init_stx = ellc_make_stx_lst_of(2, ell_make_stx_sym(ELL_SYM(core_snip)),
+                                     ell_make_stx_str(ell_make_str("ell_unbound")));
+    return p_stx;
+}
+
+static struct ell_obj *
+ellc_mbind_keyword_stx(struct ell_obj *name_stx)
+{
+    char *name = ell_str_chars(ell_sym_name(ell_stx_sym_sym(name_stx)));
+    char *key = (char *) ell_alloc(strlen(name) + 2);
+    sprintf(key, "%s:", name);
+    return ellc_make_stx_lst_of(2, ell_make_stx_sym(ELL_SYM(core_quote)),
+                                ell_make_stx_sym(ell_intern(ell_make_str(key))));
+}
+
+/* (ell-mbind params form body) binds the params, the lambda list of a
+   macro, to the arguments of the macro call form, which must be a
+   variable.  It is rewritten to
+
+       (ell-seq (check-syntax-list-length form N+1 N+M+1)
+                (ell-app (ell-lam (req1 ... reqN)
+                           (ell-app (ell-lam (opt1)
+                                      ...
+                                        (ell-app (ell-lam (key1)
+                                                   ...
+                                                     (ell-app (ell-lam (rest) body)
+                                                              (syntax-list-tail form N+M+1
+                                                                                'key1: ...)))
+                                                 (ell-cond (syntax-list-key-p form N+M+1 'key1:)
+                                                           (syntax-list-key form N+M+1 'key1:)
+                                                           init1)))
+                                    (ell-cond (< N+1 (syntax-list-length form))
+                                              (syntax-list-ref form N+1)
+                                              init1)))
+                         (syntax-list-ref form 1) ... (syntax-list-ref form N)))
+
+   so that the arguments are read from the form in place, instead of
+   being copied into a new list and applied to a lambda.  The
+   applications of inline lambdas compile to plain variable bindings.
+   Unlike in lambdas, a keyword argument may appear anywhere after the
+   positional ones, and is left out of the rest parameter, so that
+   keywords can follow the elements of the rest.  Lambda lists with an
+   all-keys parameter are applied as before:
+
+       (apply-syntax-list (ell-lam params body) (syntax-list-rest form)) */
+static struct ellc_ast *
+ellc_norm_mbind(struct ellc_st *st, struct ell_obj *stx_lst)
+{
+    ell_assert_stx_lst_len(stx_lst, 4);
+    struct ell_obj *params_stx = ELL_SEND(stx_lst, second);
+    struct ell_obj *form_stx = ELL_SEND(stx_lst, third);
+    struct ell_obj *body_stx = ELL_SEND(stx_lst, fourth);
+    ell_assert_wrapper(params_stx, ELL_WRAPPER(stx_lst));
+    ell_assert_wrapper(form_stx, ELL_WRAPPER(stx_sym));
+    list_t *req = ell_util_make_list();
+    list_t *opt = ell_util_make_list();
+    list_t *key = ell_util_make_list();
+    struct ell_obj *rest_stx = NULL;
+    list_t *cur = req;
+    list_t *elts = ell_stx_lst_elts(params_stx);
+    for (lnode_t *n = list_first(elts); n; n = list_next(elts, n)) {
+        struct ell_obj *p_stx = (struct ell_obj *) lnode_get(n);
+        struct ell_obj *p_sym = (p_stx->wrapper == ELL_WRAPPER(stx_sym)) ? ell_stx_sym_sym(p_stx) : NULL;
+        if (p_sym == ELL_SYM(param_optional)) {
+            cur = opt;
+        } else if (p_sym == ELL_SYM(param_key)) {
+            cur = key;
+        } else if (p_sym == ELL_SYM(param_rest)) {
+            cur = NULL;
+        } else if ((p_sym == ELL_SYM(param_all_keys)) || (!cur && rest_stx)) {
+            struct ell_obj *lam_stx =
+                ellc_make_stx_lst_of(3, ell_make_stx_sym(ELL_SYM(core_lam)), params_stx, body_stx);
+            return ellc_norm_stx(st, ellc_make_stx_lst_of(3, ell_make_stx_sym(ELL_SYM(core_apply_syntax_list)),
+                                                          lam_stx,
+                                                          ellc_make_stx_lst_of(2, ell_make_stx_sym(ELL_SYM(core_syntax_list_rest)),
+                                                                               form_stx)));
+        } else if (cur) {
+            ell_util_list_add(cur, p_stx);
+        } else {
+            rest_stx = p_stx;
+        }
+    }
+    int nreq = list_count(req);
+    int nopt = list_count(opt);
+    int npos = nreq + nopt + 1;
+    struct ell_obj *init_stx;
+    struct ell_obj *stx = body_stx;
+    if (rest_stx) {
+        struct ell_obj *tail_stx = ellc_make_stx_call(ELL_SYM(core_syntax_list_tail), form_stx, npos);
+        for (lnode_t *n = list_first(key); n; n = list_next(key, n))
+            ELL_SEND(tail_stx, add,
+                     ellc_mbind_keyword_stx(ellc_mbind_param((struct ell_obj *) lnode_get(n), &init_stx)));
+        stx = ellc_make_stx_let1(rest_stx, tail_stx, stx);
+    }
+    for (lnode_t *n = list_last(key); n; n = list_prev(key, n)) {
+        struct ell_obj *p_stx = ellc_mbind_param((struct ell_obj *) lnode_get(n), &init_stx);
+        struct ell_obj *keyword_stx = ellc_mbind_keyword_stx(p_stx);
+        struct ell_obj *test_stx = ellc_make_stx_call(ELL_SYM(core_syntax_list_key_p), form_stx, npos);
+        ELL_SEND(test_stx, add, keyword_stx);
+        struct ell_obj *ref_stx = ellc_make_stx_call(ELL_SYM(core_syntax_list_key), form_stx, npos);
+        ELL_SEND(ref_stx, add, keyword_stx);
+        stx = ellc_make_stx_let1(p_stx, ellc_make_stx_lst_of(4, ell_make_stx_sym(ELL_SYM(core_cond)),
+                                                             test_stx, ref_stx, init_stx),
+                                 stx);
+    }
+    int i = nreq + nopt;
+    for (lnode_t *n = list_last(opt); n; n = list_prev(opt, n), i--) {
+        struct ell_obj *p_stx = ellc_mbind_param((struct ell_obj *) lnode_get(n), &init_stx);
+        struct ell_obj *test_stx =
+            ellc_make_stx_lst_of(3, ell_make_stx_sym(ELL_SYM(prim_lt)), ellc_make_stx_int(i),
+                                 ellc_make_stx_lst_of(2, ell_make_stx_sym(ELL_SYM(core_syntax_list_length)),
+                                                      form_stx));
+        struct ell_obj *val_stx =
+            ellc_make_stx_lst_of(4, ell_make_stx_sym(ELL_SYM(core_cond)), test_stx,
+                                 ellc_make_stx_call(ELL_SYM(core_syntax_list_ref), form_stx, i),
+                                 init_stx);
+        stx = ellc_make_stx_let1(p_stx, val_stx, stx);
+    }
+    struct ell_obj *req_stx = ell_make_stx_lst();
+    struct ell_obj *app_stx =
+        ellc_make_stx_lst_of(2, ell_make_stx_sym(ELL_SYM(core_app)),
+                             ellc_make_stx_lst_of(3, ell_make_stx_sym(ELL_SYM(core_lam)), req_stx, stx));
+    i = 1;
+    for (lnode_t *n = list_first(req); n; n = list_next(req, n), i++) {
+        ELL_SEND(req_stx, add, (struct ell_obj *) lnode_get(n));
+        ELL_SEND(app_stx, add, ellc_make_stx_call(ELL_SYM(core_syntax_list_ref), form_stx, i));
+    }
+    struct ell_obj *check_stx =
+        ellc_make_stx_lst_of(4, ell_make_stx_sym(ELL_SYM(core_check_syntax_list_length)), form_stx,
+                             ellc_make_stx_int(nreq + 1),
+                             (rest_stx || !list_isempty(key)) ? ell_make_stx_sym(ELL_SYM(prim_f))
+                                                              : ellc_make_stx_int(npos));
+    return ellc_norm_stx(st, ellc_make_stx_lst_of(3, ell_make_stx_sym(ELL_SYM(core_seq)),
+                                                  check_stx, app_stx));
+}
+
+/* (Foreign Functions) */
+
+static bool
+ellc_is_ctype(struct ell_obj *sym, bool result)
+{
+    return (sym == ELL_SYM(prim_integer_class)) || (sym == ELL_SYM(ctype_boolean))
+        || (sym == ELL_SYM(ctype_string)) || (sym == ELL_SYM(ctype_object))
+        || (result && (sym == ELL_SYM(ctype_unspecified)));
+}
+
+static struct ell_obj *
+ellc_norm_ctype(struct ell_obj *stx, bool result)
+{
+    ell_assert_wrapper(stx, ELL_WRAPPER(stx_sym));
+    struct ell_obj *sym = ell_stx_sym_sym(stx);
+    if (!ellc_is_ctype(sym, result))
+        ell_fail("unknown C type: %s\n", ell_str_chars(ell_sym_name(sym)));
+    return sym;
+}
+
+static struct ellc_ast *
+ellc_norm_ccall(struct ellc_st *st, struct ell_obj *stx_lst)
+{
+    ell_assert_stx_lst_len_min(stx_lst, 4);
+    struct ell_obj *name_stx = ELL_SEND(stx_lst, second);
+    ell_assert_wrapper(name_stx, ELL_WRAPPER(stx_str));
+    struct ellc_ast *ast = ellc_make_ast(ELLC_AST_CCALL);
+    ast->ccall.name = ell_stx_str_str(name_stx);
+    ast->ccall.param_types = ell_util_make_list();
+    list_t *types_stx = ell_stx_lst_elts(ELL_SEND(stx_lst, third));
+    for (lnode_t *n = list_first(types_stx); n; n = list_next(types_stx, n))
+        ell_util_list_add(ast->ccall.param_types,
+                          ellc_norm_ctype((struct ell_obj *) lnode_get(n), 0));
+    ast->ccall.result_type = ellc_norm_ctype(ELL_SEND(stx_lst, fourth), 1);
+    ast->ccall.args = ell_util_make_list();
+    list_t *args_stx = ell_util_sublist(ell_stx_lst_elts(stx_lst), 4);
+    for (lnode_t *n = list_first(args_stx); n; n = list_next(args_stx, n))
+        ell_util_list_add(ast->ccall.args, ellc_norm_stx(st, (struct ell_obj *) lnode_get(n)));
+    if (list_count(ast->ccall.args) != list_count(ast->ccall.param_types))
+        ell_fail("wrong number of arguments to C function %s\n", ell_str_chars(ast->ccall.name));
+    return ast;
+}
+
+/* (ell-cfun name c-name (type1 ... typeN) result-type) is rewritten to
+
+       (ell-fdef name (ell-lam (arg1 ... argN)
+                        (ell-ccall c-name (type1 ... typeN) result-type
+                                   arg1 ... argN)))
+
+   and the lambda is remembered, so that calls of the function in the
+   unit get it inlined (see `ellc_fold_inline'), and thus become direct
+   C calls with the conversions of the arguments and result in line.
+   The function object is only used where the function is used as a
+   value, or called from units that don't inline it. */
+static struct ellc_ast *
+ellc_norm_cfun(struct ellc_st *st, struct ell_obj *stx_lst)
+{
+    ell_assert_stx_lst_len(stx_lst, 5);
+    struct ell_obj *name_stx = ELL_SEND(stx_lst, second);
+    ell_assert_wrapper(name_stx, ELL_WRAPPER(stx_sym));
+    struct ell_obj *types_stx = ELL_SEND(stx_lst, fourth);
+    ell_assert_wrapper(types_stx, ELL_WRAPPER(stx_lst));
+    struct ell_obj *params_stx = ell_make_stx_lst();
+    struct ell_obj *ccall_stx =
+        ellc_make_stx_lst_of(4, ell_make_stx_sym(ELL_SYM(core_ccall)), ELL_SEND(stx_lst, third),
+                             types_stx, (struct ell_obj *) lnode_get(list_last(ell_stx_lst_elts(stx_lst))));
+    for (unsigned i = 1; i <= ell_stx_lst_len(types_stx); i++) {
+        char param[32];
+        snprintf(param, sizeof(param), "arg%u", i);
+        struct ell_obj *param_stx = ell_make_stx_sym(ell_intern(ell_make_str(param)));
+        ELL_SEND(params_stx, add, param_stx);
+        ELL_SEND(ccall_stx, add, param_stx);
+    }
+    struct ellc_inline *in = (struct ellc_inline *) ell_alloc(sizeof(*in));
+    in->id = ellc_make_id(ell_stx_sym_sym(name_stx), ELLC_NS_FUN);
+    in->stx = ellc_make_stx_lst_of(3, ell_make_stx_sym(ELL_SYM(core_lam)), params_stx, ccall_stx);
+    in->cell = NULL;
+    ell_util_dict_put(st->c_functions, in->id->sym, in);
+    return ellc_norm_stx(st, ellc_make_stx_lst_of(3, ell_make_stx_sym(ELL_SYM(core_fdef)),
+                                                  name_stx, in->stx));
+}
+
 /* (Putting it All Together) */
 
+static char *
+ellc_mangle_id(char *prefix, struct ellc_id *id);
+
 // This belongs somewhere else
 /* (compiler-put-expander symbol function) -> unspecified */
 
@@ -720,6 +1240,138 @@ ellc_compiler_put_expander_code(struct ell_obj *clo, ell_arg_ct npos,
     ell_util_dict_put(&ellc_mac_tab, symbol, function);
 }
 
+/* (compiler-note-defined symbol namespace) -> unspecified */
+
+struct ell_obj *__ell_g_compilerDnoteDdefined_2_;
+
+struct ell_obj *
+ellc_compiler_note_defined_code(struct ell_obj *clo, ell_arg_ct npos,
+                                ell_arg_ct nkey, struct ell_obj **args)
+{
+    ell_check_npos(npos, 2);
+    struct ell_obj *symbol = args[0];
+    ell_assert_wrapper(symbol, ELL_WRAPPER(sym));
+    struct ellc_id *id = ellc_make_id(symbol, ell_num_int(args[1]));
+    if (!dict_lookup(&ellc_defined_tab, id))
+        ell_util_dict_put(&ellc_defined_tab, id, id);
+    return ell_unspecified;
+}
+
+/* (compiler-put-inline symbol syntax cell-name) -> unspecified */
+
+struct ell_obj *__ell_g_compilerDputDinline_2_;
+
+struct ell_obj *
+ellc_compiler_put_inline_code(struct ell_obj *clo, ell_arg_ct npos,
+                              ell_arg_ct nkey, struct ell_obj **args)
+{
+    ell_check_npos(npos, 3);
+    struct ell_obj *symbol = args[0];
+    ell_assert_wrapper(symbol, ELL_WRAPPER(sym));
+    ell_assert_wrapper(args[1], ELL_WRAPPER(stx_lst));
+    ell_assert_wrapper(args[2], ELL_WRAPPER(str));
+    struct ellc_inline *in = (struct ellc_inline *) ell_alloc(sizeof(*in));
+    in->id = ellc_make_id(symbol, ELLC_NS_FUN);
+    in->stx = args[1];
+    in->cell = ell_str_chars(args[2]);
+    ell_util_dict_put(&ellc_inline_tab, symbol, in);
+    return ell_unspecified;
+}
+
+/* (compiler-put-link symbol) -> unspecified */
+
+struct ell_obj *__ell_g_compilerDputDlink_2_;
+
+struct ell_obj *
+ellc_compiler_put_link_code(struct ell_obj *clo, ell_arg_ct npos,
+                            ell_arg_ct nkey, struct ell_obj **args)
+{
+    ell_check_npos(npos, 1);
+    struct ell_obj *symbol = args[0];
+    ell_assert_wrapper(symbol, ELL_WRAPPER(sym));
+    struct ellc_link *link = (struct ellc_link *) ell_alloc(sizeof(*link));
+    link->id = ellc_make_id(symbol, ELLC_NS_FUN);
+    link->cell = ellc_mangle_id("l", link->id);
+    ell_util_dict_put(&ellc_link_tab, symbol, link);
+    return ell_unspecified;
+}
+
+/* Globals bound at startup by the runtime (see `ell_init'), the
+   compilation manager and `ellc_init', which must be kept in sync with
+   this table.  Globals defined by the bootstrap aren't in it, because
+   they become known to the compiler like those of any other unit. */
+static struct {
+    char *name;
+    enum ellc_ns ns;
+} ellc_builtin_globals[] = {
+    { "<object>", ELLC_NS_VAR },
+    { "<boolean>", ELLC_NS_VAR },
+    { "<class>", ELLC_NS_VAR },
+    { "<function>", ELLC_NS_VAR },
+    { "<generic-function>", ELLC_NS_VAR },
+    { "<linked-list>", ELLC_NS_VAR },
+    { "<list-range>", ELLC_NS_VAR },
+    { "<string>", ELLC_NS_VAR },
+    { "<integer>", ELLC_NS_VAR },
+    { "<symbol>", ELLC_NS_VAR },
+    { "<syntax-list>", ELLC_NS_VAR },
+    { "<syntax-string>", ELLC_NS_VAR },
+    { "<syntax-symbol>", ELLC_NS_VAR },
+    { "<unspecified>", ELLC_NS_VAR },
+    { "#t", ELLC_NS_VAR },
+    { "#f", ELLC_NS_VAR },
+    { "unspecified", ELLC_NS_VAR },
+    { "block/f", ELLC_NS_FUN },
+    { "unwind-protect/f", ELLC_NS_FUN },
+    { "handler-bind/f", ELLC_NS_FUN },
+    { "signal", ELLC_NS_FUN },
+    { "with-restart/f", ELLC_NS_FUN },
+    { "invoke-restart", ELLC_NS_FUN },
+    { "apply", ELLC_NS_FUN },
+    { "send", ELLC_NS_FUN },
+    { "values", ELLC_NS_FUN },
+    { "multiple-value-ref", ELLC_NS_FUN },
+    { "syntax-list", ELLC_NS_FUN },
+    { "syntax-list-rest", ELLC_NS_FUN },
+    { "syntax-list-length", ELLC_NS_FUN },
+    { "syntax-list-ref", ELLC_NS_FUN },
+    { "syntax-list-tail", ELLC_NS_FUN },
+    { "syntax-list-key-p", ELLC_NS_FUN },
+    { "syntax-list-key", ELLC_NS_FUN },
+    { "check-syntax-list-length", ELLC_NS_FUN },
+    { "append-syntax-lists", ELLC_NS_FUN },
+    { "apply-syntax-list", ELLC_NS_FUN },
+    { "datum->syntax", ELLC_NS_FUN },
+    { "syntax->datum", ELLC_NS_FUN },
+    { "map-list", ELLC_NS_FUN },
+    { "make-class", ELLC_NS_FUN },
+    { "add-superclass", ELLC_NS_FUN },
+    { "put-class-option", ELLC_NS_FUN },
+    { "make-generic-function", ELLC_NS_FUN },
+    { "dissect-generic-function-params", ELLC_NS_FUN },
+    { "put-method", ELLC_NS_FUN },
+    { "make", ELLC_NS_FUN },
+    { "slot-value", ELLC_NS_FUN },
+    { "set-slot-value", ELLC_NS_FUN },
+    { "map-column", ELLC_NS_FUN },
+    { "sum-column", ELLC_NS_FUN },
+    { "type?", ELLC_NS_FUN },
+    { "<", ELLC_NS_FUN },
+    { "+", ELLC_NS_FUN },
+    { "-", ELLC_NS_FUN },
+    { "*", ELLC_NS_FUN },
+    { "exit", ELLC_NS_FUN },
+    { "read-line", ELLC_NS_FUN },
+#define ELL_DEFGENERIC(name, lisp_name) { lisp_name, ELLC_NS_FUN },
+#include "defgeneric.h"
+#undef ELL_DEFGENERIC
+    { "compile", ELLC_NS_FUN },
+    { "compiler-put-expander", ELLC_NS_FUN },
+    { "compiler-note-defined", ELLC_NS_FUN },
+    { "compiler-put-inline", ELLC_NS_FUN },
+    { "compiler-put-link", ELLC_NS_FUN },
+};
+
 __attribute__((constructor(300))) static void
 ellc_init()
 {
@@ -737,16 +1389,41 @@ ellc_init()
     ell_util_dict_put(&ellc_norm_tab, ELL_SYM(core_app), &ellc_norm_app);
     ell_util_dict_put(&ellc_norm_tab, ELL_SYM(core_lam), &ellc_norm_lam);
     ell_util_dict_put(&ellc_norm_tab, ELL_SYM(core_loop), &ellc_norm_loop);
+    ell_util_dict_put(&ellc_norm_tab, ELL_SYM(core_while), &ellc_norm_while);
+    ell_util_dict_put(&ellc_norm_tab, ELL_SYM(core_dlet), &ellc_norm_dlet);
     ell_util_dict_put(&ellc_norm_tab, ELL_SYM(core_quote), &ellc_norm_quote);
     ell_util_dict_put(&ellc_norm_tab, ELL_SYM(core_quasisyntax), &ellc_norm_quasisyntax);
     ell_util_dict_put(&ellc_norm_tab, ELL_SYM(core_syntax), &ellc_norm_quasisyntax);
     ell_util_dict_put(&ellc_norm_tab, ELL_SYM(core_mdef), &ellc_norm_mdef);
     ell_util_dict_put(&ellc_norm_tab, ELL_SYM(core_snip), &ellc_norm_snip);
     ell_util_dict_put(&ellc_norm_tab, ELL_SYM(core_stmt), &ellc_norm_stmt);
+    ell_util_dict_put(&ellc_norm_tab, ELL_SYM(core_declare), &ellc_norm_declare);
+    ell_util_dict_put(&ellc_norm_tab, ELL_SYM(core_the), &ellc_norm_the);
+    ell_util_dict_put(&ellc_norm_tab, ELL_SYM(core_mvb), &ellc_norm_mvb);
+    ell_util_dict_put(&ellc_norm_tab, ELL_SYM(core_ltv), &ellc_norm_ltv);
+    ell_util_dict_put(&ellc_norm_tab, ELL_SYM(core_ctv), &ellc_norm_ctv);
+    ell_util_dict_put(&ellc_norm_tab, ELL_SYM(core_cfun), &ellc_norm_cfun);
+    ell_util_dict_put(&ellc_norm_tab, ELL_SYM(core_ccall), &ellc_norm_ccall);
+    ell_util_dict_put(&ellc_norm_tab, ELL_SYM(core_mbind), &ellc_norm_mbind);
     // Compiler state
     dict_init(&ellc_mac_tab, DICTCOUNT_T_MAX, (dict_comp_t) &ell_sym_cmp);
+    dict_init(&ellc_defined_tab, DICTCOUNT_T_MAX, (dict_comp_t) &ellc_id_cmp);
+    for (size_t i = 0; i < sizeof(ellc_builtin_globals) / sizeof(ellc_builtin_globals[0]); i++) {
+        struct ellc_id *id =
+            ellc_make_id(ell_intern(ell_make_str(ellc_builtin_globals[i].name)),
+                         ellc_builtin_globals[i].ns);
+        ell_util_dict_put(&ellc_defined_tab, id, id);
+    }
+    dict_init(&ellc_inline_tab, DICTCOUNT_T_MAX, (dict_comp_t) &ell_sym_cmp);
+    dict_init(&ellc_link_tab, DICTCOUNT_T_MAX, (dict_comp_t) &ell_sym_cmp);
     __ell_g_compilerDputDexpander_2_ =
         ell_make_clo(&ellc_compiler_put_expander_code, NULL);
+    __ell_g_compilerDnoteDdefined_2_ =
+        ell_make_clo(&ellc_compiler_note_defined_code, NULL);
+    __ell_g_compilerDputDinline_2_ =
+        ell_make_clo(&ellc_compiler_put_inline_code, NULL);
+    __ell_g_compilerDputDlink_2_ =
+        ell_make_clo(&ellc_compiler_put_link_code, NULL);
 }
 
 static struct ellc_ast *
@@ -847,16 +1524,28 @@ ellc_norm(struct ellc_st *st, struct ell_obj *stx_lst)
     for (lnode_t *n = list_first(deferred); n; n = list_next(deferred, n)) {
         struct ell_obj *stx = (struct ell_obj *) lnode_get(n);
         struct ellc_ast *res = ellc_norm_stx(st, stx);
+        for (lnode_t *in = list_first(st->ltv_inits); in; in = list_next(st->ltv_inits, in))
+            ellc_ast_seq_add(ast_seq, (struct ellc_ast *) lnode_get(in));
+        st->ltv_inits = ell_util_make_list();
         if (res) // no-ops return NULL
             ellc_ast_seq_add(ast_seq, res);
     }
     return ast_seq;
 }
 
-/**** Closure Conversion ****/
+/**** Optimization ****/
+
+/* Simplifies the normal form AST produced by macroexpansion: folds
+   arithmetic and comparisons on literals, prunes conditional branches
+   that can't be reached, flattens nested sequences, drops expressions
+   without side effects whose values aren't used, and inlines calls of
+   small functions exported by previously compiled units.  Like
+   closure conversion, this pass maintains the lexical contour, so
+   that references to lexical variables aren't mistaken for references
+   to the built-in globals. */
 
 static void
-ellc_conv_ast(struct ellc_st *st, struct ellc_ast *ast);
+ellc_fold_ast(struct ellc_st *st, struct ellc_ast *ast);
 
 static bool
 ellc_defined_at_toplevel(struct ellc_st *st, struct ellc_id *id)
@@ -864,68 +1553,666 @@ ellc_defined_at_toplevel(struct ellc_st *st, struct ellc_id *id)
     return ell_util_list_contains(st->defined_globals, id, (dict_comp_t) &ellc_id_cmp);
 }
 
-static void
-ellc_env_add_ref(struct ellc_ast_lam *lam, struct ellc_id *id)
+/* Checks whether the AST is a reference to the built-in global
+   variable or function with the given name, i.e. one that's neither
+   lexically bound nor defined in the current unit. */
+static bool
+ellc_fold_is_builtin_ref(struct ellc_st *st, struct ellc_ast *ast,
+                         struct ell_obj *sym, enum ellc_ns ns)
 {
-    if (!dict_lookup(lam->env, id)) {
-        struct ellc_ast *ref = ellc_make_ast(ELLC_AST_REF);
-        ref->ref.id = id;
-        ell_util_dict_put(lam->env, id, ref);
+    if (ast->type != ELLC_AST_REF) return 0;
+    struct ellc_id *id = ast->ref.id;
+    return (id->sym == sym)
+        && (id->ns == ns)
+        && !ellc_contour_lookup(st->bottom_contour, id, NULL)
+        && !ellc_defined_at_toplevel(st, id);
+}
+
+/* Returns 1 or 0 if the AST is known to evaluate to a true or false
+   value without side effects, and -1 otherwise. */
+static int
+ellc_fold_truth(struct ellc_st *st, struct ellc_ast *ast)
+{
+    switch(ast->type) {
+    case ELLC_AST_LIT_SYM:
+    case ELLC_AST_LIT_STR:
+    case ELLC_AST_LIT_NUM:
+    case ELLC_AST_LIT_STX:
+    case ELLC_AST_LAM:
+        return 1;
+    case ELLC_AST_REF:
+        if (ellc_fold_is_builtin_ref(st, ast, ELL_SYM(prim_t), ELLC_NS_VAR)) return 1;
+        if (ellc_fold_is_builtin_ref(st, ast, ELL_SYM(prim_f), ELLC_NS_VAR)) return 0;
+        return -1;
+    default:
+        return -1;
     }
 }
 
-static void
-ellc_conv_ref(struct ellc_st *st, struct ellc_ast *ast)
+static bool
+ellc_fold_is_pure(struct ellc_st *st, struct ellc_ast *ast)
 {
-    struct ellc_param *p = NULL;
-    struct ellc_contour *c = ellc_contour_lookup(st->bottom_contour, ast->ref.id, &p);
-    if (!c) {
-        /* The identifier isn't lexically bound.  Now, we still need
-           to check whether it's defined at the top-level in the
-           current unit, before we follow the rule that all variables
-           are considered implicitly bound at the top-level.  For such
-           implicitly bound variables we need to ignore the hygiene
-           context. */
-        if (!ellc_defined_at_toplevel(st, ast->ref.id)) {
-            ast->ref.id->cx = NULL;
+    switch(ast->type) {
+    case ELLC_AST_LIT_SYM:
+    case ELLC_AST_LIT_STR:
+    case ELLC_AST_LIT_NUM:
+    case ELLC_AST_LIT_STX:
+    case ELLC_AST_LAM:
+    case ELLC_AST_DEFP:
+        return 1;
+    case ELLC_AST_LTV:
+        return ast->ltv.init == NULL;
+    case ELLC_AST_REF:
+        // References to globals may signal unbound variables
+        return (ellc_contour_lookup(st->bottom_contour, ast->ref.id, NULL) != NULL)
+            || (ellc_fold_truth(st, ast) != -1);
+    default:
+        return 0;
+    }
+}
+
+/* Folds a list of expressions that are evaluated in sequence.
+   Returns the new list. */
+static list_t *
+ellc_fold_exprs(struct ellc_st *st, list_t *exprs)
+{
+    list_t *flat = ell_util_make_list();
+    for (lnode_t *n = list_first(exprs); n; n = list_next(exprs, n)) {
+        struct ellc_ast *expr = (struct ellc_ast *) lnode_get(n);
+        ellc_fold_ast(st, expr);
+        if (expr->type == ELLC_AST_SEQ) {
+            for (lnode_t *sn = list_first(expr->seq.exprs); sn; sn = list_next(expr->seq.exprs, sn))
+                ell_util_list_add(flat, lnode_get(sn));
+        } else {
+            ell_util_list_add(flat, expr);
         }
-        struct ellc_id *tmp_id = ast->ref.id;
-        ast->type = ELLC_AST_GLO_REF;
-        ast->glo_ref.id = tmp_id;
-        ell_util_set_add(st->globals, tmp_id, (dict_comp_t) &ellc_id_cmp);
-    } else if (c == st->bottom_contour) {
-        ast->type = ELLC_AST_ARG_REF;
-        ast->arg_ref.param = p;
-    } else {
-        ast->type = ELLC_AST_ENV_REF;
-        ast->env_ref.param = p;
-        p->closed = 1;
-        ellc_env_add_ref(st->bottom_contour->lam, p->id);
     }
+    list_t *res = ell_util_make_list();
+    for (lnode_t *n = list_first(flat); n; n = list_next(flat, n)) {
+        struct ellc_ast *expr = (struct ellc_ast *) lnode_get(n);
+        if (!list_next(flat, n) || !ellc_fold_is_pure(st, expr))
+            ell_util_list_add(res, expr);
+    }
+    return res;
 }
 
 static void
-ellc_conv_def(struct ellc_st *st, struct ellc_ast *ast)
+ellc_fold_seq(struct ellc_st *st, struct ellc_ast *ast)
 {
-    ell_util_set_add(st->globals, ast->def.id, (dict_comp_t) &ellc_id_cmp);
-    ellc_conv_ast(st, ast->def.val);
+    ast->seq.exprs = ellc_fold_exprs(st, ast->seq.exprs);
+    if (list_count(ast->seq.exprs) == 1)
+        *ast = *((struct ellc_ast *) lnode_get(list_first(ast->seq.exprs)));
 }
 
 static void
-ellc_conv_defp(struct ellc_st *st, struct ellc_ast *ast)
+ellc_fold_cond(struct ellc_st *st, struct ellc_ast *ast)
 {
-    /* See comment in ellc_conv_ref. */
-    if (!ellc_defined_at_toplevel(st, ast->defp.id)) {
-        ast->defp.id->cx = NULL;
+    ellc_fold_ast(st, ast->cond.test);
+    switch(ellc_fold_truth(st, ast->cond.test)) {
+    case 1:
+        *ast = *ast->cond.consequent;
+        ellc_fold_ast(st, ast);
+        break;
+    case 0:
+        *ast = *ast->cond.alternative;
+        ellc_fold_ast(st, ast);
+        break;
+    default:
+        ellc_fold_ast(st, ast->cond.consequent);
+        ellc_fold_ast(st, ast->cond.alternative);
     }
-    ell_util_set_add(st->globals, ast->defp.id, (dict_comp_t) &ellc_id_cmp);
 }
 
+static struct ellc_ast *
+ellc_fold_make_bool(bool b)
+{
+    struct ellc_ast *ast = ellc_make_ast(ELLC_AST_REF);
+    ast->ref.id = ellc_make_id(b ? ELL_SYM(prim_t) : ELL_SYM(prim_f), ELLC_NS_VAR);
+    return ast;
+}
+
+/* Folds applications of the arithmetic and comparison primitives to
+   literal integers.  Overflowing operations are left to signal their
+   error at runtime. */
 static void
-ellc_conv_set(struct ellc_st *st, struct ellc_ast *ast)
+ellc_fold_prim_app(struct ellc_st *st, struct ellc_ast *ast)
 {
-    ellc_conv_ast(st, ast->set.val);
-    struct ellc_param *p;
+    struct ellc_args *args = ast->app.args;
+    if ((list_count(&args->pos) != 2) || (dict_count(&args->key) != 0)) return;
+    struct ellc_ast *a = (struct ellc_ast *) lnode_get(list_first(&args->pos));
+    struct ellc_ast *b = (struct ellc_ast *) lnode_get(list_last(&args->pos));
+    if ((a->type != ELLC_AST_LIT_NUM) || (b->type != ELLC_AST_LIT_NUM)) return;
+    int x = ell_num_int(a->lit_num.num);
+    int y = ell_num_int(b->lit_num.num);
+    int res;
+    struct ellc_ast *op = ast->app.op;
+    if (ellc_fold_is_builtin_ref(st, op, ELL_SYM(prim_lt), ELLC_NS_FUN)) {
+        *ast = *ellc_fold_make_bool(x < y);
+        return;
+    } else if (ellc_fold_is_builtin_ref(st, op, ELL_SYM(prim_add), ELLC_NS_FUN)) {
+        if (__builtin_add_overflow(x, y, &res)) return;
+    } else if (ellc_fold_is_builtin_ref(st, op, ELL_SYM(prim_sub), ELLC_NS_FUN)) {
+        if (__builtin_sub_overflow(x, y, &res)) return;
+    } else if (ellc_fold_is_builtin_ref(st, op, ELL_SYM(prim_mul), ELLC_NS_FUN)) {
+        if (__builtin_mul_overflow(x, y, &res)) return;
+    } else {
+        return;
+    }
+    ast->type = ELLC_AST_LIT_NUM;
+    ast->lit_num.num = ell_make_num_from_int(res);
+}
+
+/* C name of the unit's flag that tells whether the load-time check of
+   an inlined function succeeded (see `ELL_GEN_CHECK_INLINED'). */
+static char *
+ellc_inline_flag(struct ellc_inline *in)
+{
+    char *flag = (char *) ell_alloc(strlen(in->cell) + 4);
+    sprintf(flag, "%s_ok", in->cell);
+    return flag;
+}
+
+/* Wraps the lambda of a function of another unit so that it's only
+   used if the load-time check succeeded, and the function is called
+   through its global otherwise:
+
+       (ell-lam (arg1 ... argN)
+         (ell-cond (ell-snip "(flag ? ell_t : ell_f)")
+                   (ell-app lambda arg1 ... argN)
+                   (ell-app (ell-fref name) arg1 ... argN)))
+
+   The parameters get a fresh hygiene context, so they can't capture
+   references in the lambda or the function's name. */
+static struct ell_obj *
+ellc_inline_guarded_stx(struct ellc_inline *in)
+{
+    struct ell_cx *cx = ell_make_cx();
+    struct ell_obj *params_stx = ell_make_stx_lst();
+    struct ell_obj *inlined_stx = ellc_make_stx_lst_of(2, ell_make_stx_sym(ELL_SYM(core_app)), in->stx);
+    struct ell_obj *called_stx =
+        ellc_make_stx_lst_of(2, ell_make_stx_sym(ELL_SYM(core_app)),
+                             ellc_make_stx_lst_of(2, ell_make_stx_sym(ELL_SYM(core_fref)),
+                                                  ell_make_stx_sym(in->id->sym)));
+    for (unsigned i = 1; i <= ell_stx_lst_len(ELL_SEND(in->stx, second)); i++) {
+        char param[32];
+        snprintf(param, sizeof(param), "arg%u", i);
+        struct ell_obj *param_stx = ell_make_stx_sym_cx(ell_intern(ell_make_str(param)), cx);
+        ELL_SEND(params_stx, add, param_stx);
+        ELL_SEND(inlined_stx, add, param_stx);
+        ELL_SEND(called_stx, add, param_stx);
+    }
+    char *flag = ellc_inline_flag(in);
+    char *test = (char *) ell_alloc(strlen(flag) + 20);
+    sprintf(test, "(%s ? ell_t : ell_f)", flag);
+    struct ell_obj *test_stx = ellc_make_stx_lst_of(2, ell_make_stx_sym(ELL_SYM(core_snip)),
+                                                    ell_make_stx_str(ell_make_str(test)));
+    struct ell_obj *cond_stx = ellc_make_stx_lst_of(4, ell_make_stx_sym(ELL_SYM(core_cond)),
+                                                    test_stx, inlined_stx, called_stx);
+    return ellc_make_stx_lst_of(3, ell_make_stx_sym(ELL_SYM(core_lam)), params_stx, cond_stx);
+}
+
+/* Replaces the operator of a call to a function that a previously
+   compiled unit exported for inlining (see `ellc_inline_tab') with
+   the function's lambda, normalized anew, which closure conversion
+   then inlines like a LET.  Functions defined at the top-level of the
+   current unit shadow the exported ones, except for C functions
+   declared in it, which are inlined the same way (see
+   `ellc_norm_cfun').  Returns the inlined function, or NULL. */
+static struct ellc_inline *
+ellc_fold_inline(struct ellc_st *st, struct ellc_ast *ast)
+{
+    struct ellc_ast *op = ast->app.op;
+    if ((op->type != ELLC_AST_REF) || (op->ref.id->ns != ELLC_NS_FUN)) return NULL;
+    if (ellc_contour_lookup(st->bottom_contour, op->ref.id, NULL)) return NULL;
+    struct ellc_id *id = ellc_make_id(op->ref.id->sym, ELLC_NS_FUN);
+    dnode_t *dn = dict_lookup(st->c_functions, id->sym);
+    if (!dn) {
+        if (ellc_defined_at_toplevel(st, id)) return NULL;
+        dn = dict_lookup(&ellc_inline_tab, id->sym);
+    }
+    if (!dn) return NULL;
+    struct ellc_inline *in = (struct ellc_inline *) dnode_get(dn);
+    if (ell_util_list_contains(st->inlining, in, (dict_comp_t) &ell_ptr_cmp)
+        || (dict_count(&ast->app.args->key) != 0)
+        || (ell_stx_lst_len(ELL_SEND(in->stx, second)) != list_count(&ast->app.args->pos)))
+        return NULL;
+    struct ellc_contour *c = st->bottom_contour;
+    st->bottom_contour = NULL;
+    // no load-time check for the unit's own C functions
+    ast->app.op = ellc_norm_stx(st, in->cell ? ellc_inline_guarded_stx(in) : in->stx);
+    st->bottom_contour = c;
+    if (in->cell)
+        ell_util_set_add(st->inlined, in, (dict_comp_t) &ell_ptr_cmp);
+    return in;
+}
+
+static void
+ellc_fold_app(struct ellc_st *st, struct ellc_ast *ast)
+{
+    struct ellc_inline *in = ellc_fold_inline(st, ast);
+    if (in) {
+        ell_util_list_add(st->inlining, in);
+        ellc_fold_ast(st, ast->app.op);
+        list_del_last(st->inlining);
+    } else {
+        ellc_fold_ast(st, ast->app.op);
+    }
+    struct ellc_args *args = ast->app.args;
+    for (lnode_t *n = list_first(&args->pos); n; n = list_next(&args->pos, n))
+        ellc_fold_ast(st, (struct ellc_ast *) lnode_get(n));
+    for (dnode_t *n = dict_first(&args->key); n; n = dict_next(&args->key, n))
+        ellc_fold_ast(st, (struct ellc_ast *) dnode_get(n));
+    ellc_fold_prim_app(st, ast);
+}
+
+static void
+ellc_fold_params_list_inits(struct ellc_st *st, list_t *params)
+{
+    for (lnode_t *n = list_first(params); n; n = list_next(params, n)) {
+        struct ellc_param *p = (struct ellc_param *) lnode_get(n);
+        if (p->init)
+            ellc_fold_ast(st, p->init);
+    }
+}
+
+static void
+ellc_fold_lam(struct ellc_st *st, struct ellc_ast *ast)
+{
+    struct ellc_contour *c = (struct ellc_contour *) ell_alloc(sizeof(*c));
+    c->lam = &ast->lam;
+    c->up = st->bottom_contour;
+    st->bottom_contour = c;
+    ellc_fold_params_list_inits(st, ast->lam.params->opt);
+    ellc_fold_params_list_inits(st, ast->lam.params->key);
+    ellc_fold_ast(st, ast->lam.body);
+    st->bottom_contour = c->up;
+}
+
+/* The bodies of inline C contain strings that must not be dropped,
+   so only their elements are folded. */
+static void
+ellc_fold_c_body(struct ellc_st *st, struct ellc_ast *body)
+{
+    for (lnode_t *n = list_first(body->seq.exprs); n; n = list_next(body->seq.exprs, n))
+        ellc_fold_ast(st, (struct ellc_ast *) lnode_get(n));
+}
+
+static void
+ellc_fold_ast(struct ellc_st *st, struct ellc_ast *ast)
+{
+    switch(ast->type) {
+    case ELLC_AST_DEF: ellc_fold_ast(st, ast->def.val); break;
+    case ELLC_AST_SET: ellc_fold_ast(st, ast->set.val); break;
+    case ELLC_AST_COND: ellc_fold_cond(st, ast); break;
+    case ELLC_AST_SEQ: ellc_fold_seq(st, ast); break;
+    case ELLC_AST_APP: ellc_fold_app(st, ast); break;
+    case ELLC_AST_LAM: ellc_fold_lam(st, ast); break;
+    case ELLC_AST_LOOP:
+        if (ast->loop.test)
+            ellc_fold_ast(st, ast->loop.test);
+        ellc_fold_ast(st, ast->loop.body);
+        break;
+    case ELLC_AST_DLET:
+        ellc_fold_ast(st, ast->dlet.val);
+        ellc_fold_ast(st, ast->dlet.body);
+        break;
+    case ELLC_AST_CX: ellc_fold_ast(st, ast->cx.body); break;
+    case ELLC_AST_THE: ellc_fold_ast(st, ast->the.expr); break;
+    case ELLC_AST_LTV: if (ast->ltv.init) ellc_fold_ast(st, ast->ltv.init); break;
+    case ELLC_AST_CCALL:
+        for (lnode_t *n = list_first(ast->ccall.args); n; n = list_next(ast->ccall.args, n))
+            ellc_fold_ast(st, (struct ellc_ast *) lnode_get(n));
+        break;
+    case ELLC_AST_SNIP: ellc_fold_c_body(st, ast->snip.body); break;
+    case ELLC_AST_STMT: ellc_fold_c_body(st, ast->stmt.body); break;
+    default: break;
+    }
+}
+
+static void
+ellc_fold(struct ellc_st *st, struct ellc_ast_seq *ast_seq)
+{
+    ast_seq->exprs = ellc_fold_exprs(st, ast_seq->exprs);
+}
+
+/**** Export ****/
+
+/* Small, non-recursive top-level functions with only required
+   parameters that are declared inline are exported for inlining into
+   other units: the CFASL records their folded normal form AST, written
+   back as syntax (see `ellc_inline'). */
+
+#define ELLC_INLINE_MAX_SIZE 24
+
+static struct ell_obj *
+ellc_export_form(struct ell_obj *op_sym)
+{
+    struct ell_obj *stx = ell_make_stx_lst();
+    ELL_SEND(stx, add, ell_make_stx_sym(op_sym));
+    return stx;
+}
+
+/* All symbols of the exported syntax end up in the same hygiene
+   context when it's loaded, so references to globals that are
+   hygienically renamed, or that have the same name as a parameter,
+   can't be exported. */
+static struct ell_obj *
+ellc_export_id(struct ellc_inline *in, struct ellc_id *id)
+{
+    if (!ellc_params_lookup(in->lam->params, id)) {
+        if (id->cx) return NULL;
+        list_t *req = in->lam->params->req;
+        for (lnode_t *n = list_first(req); n; n = list_next(req, n))
+            if (((struct ellc_param *) lnode_get(n))->id->sym == id->sym) return NULL;
+    }
+    return ell_make_stx_sym(id->sym);
+}
+
+/* Returns the syntax of an expression in the body of an exported
+   function, or NULL if it can't be exported.  SIZE counts the nodes
+   of the body seen so far. */
+static struct ell_obj *
+ellc_export_ast(struct ellc_inline *in, struct ellc_ast *ast, unsigned *size);
+
+static bool
+ellc_export_add(struct ellc_inline *in, struct ell_obj *stx, struct ellc_ast *ast,
+                unsigned *size)
+{
+    struct ell_obj *sub = ellc_export_ast(in, ast, size);
+    if (!sub) return 0;
+    ELL_SEND(stx, add, sub);
+    return 1;
+}
+
+static struct ell_obj *
+ellc_export_app(struct ellc_inline *in, struct ellc_ast *ast, unsigned *size)
+{
+    struct ell_obj *stx = ellc_export_form(ELL_SYM(core_app));
+    if (!ellc_export_add(in, stx, ast->app.op, size)) return NULL;
+    struct ellc_args *args = ast->app.args;
+    for (lnode_t *n = list_first(&args->pos); n; n = list_next(&args->pos, n))
+        if (!ellc_export_add(in, stx, (struct ellc_ast *) lnode_get(n), size)) return NULL;
+    for (dnode_t *n = dict_first(&args->key); n; n = dict_next(&args->key, n)) {
+        char *name = ell_str_chars(ell_sym_name((struct ell_obj *) dnode_getkey(n)));
+        char *key = (char *) ell_alloc(strlen(name) + 2);
+        sprintf(key, "%s:", name);
+        ELL_SEND(stx, add, ell_make_stx_sym(ell_intern(ell_make_str(key))));
+        if (!ellc_export_add(in, stx, (struct ellc_ast *) dnode_get(n), size)) return NULL;
+    }
+    return stx;
+}
+
+static struct ell_obj *
+ellc_export_ast(struct ellc_inline *in, struct ellc_ast *ast, unsigned *size)
+{
+    if (++(*size) > ELLC_INLINE_MAX_SIZE) return NULL;
+    struct ell_obj *stx = NULL;
+    struct ell_obj *sym_stx;
+    switch(ast->type) {
+    case ELLC_AST_REF:
+        if (ellc_id_cmp(ast->ref.id, in->id) == 0) return NULL; // recursive
+        if (!(sym_stx = ellc_export_id(in, ast->ref.id))) return NULL;
+        if (ast->ref.id->ns == ELLC_NS_VAR) return sym_stx;
+        stx = ellc_export_form(ELL_SYM(core_fref));
+        ELL_SEND(stx, add, sym_stx);
+        return stx;
+    case ELLC_AST_SET:
+        if (!(sym_stx = ellc_export_id(in, ast->set.id))) return NULL;
+        stx = ellc_export_form(ast->set.id->ns == ELLC_NS_VAR ? ELL_SYM(core_set) : ELL_SYM(core_fset));
+        ELL_SEND(stx, add, sym_stx);
+        return ellc_export_add(in, stx, ast->set.val, size) ? stx : NULL;
+    case ELLC_AST_DEFP:
+        if (!(sym_stx = ellc_export_id(in, ast->defp.id))) return NULL;
+        stx = ellc_export_form(ast->defp.id->ns == ELLC_NS_VAR ? ELL_SYM(core_defp) : ELL_SYM(core_fdefp));
+        ELL_SEND(stx, add, sym_stx);
+        return stx;
+    case ELLC_AST_COND:
+        stx = ellc_export_form(ELL_SYM(core_cond));
+        return (ellc_export_add(in, stx, ast->cond.test, size)
+                && ellc_export_add(in, stx, ast->cond.consequent, size)
+                && ellc_export_add(in, stx, ast->cond.alternative, size)) ? stx : NULL;
+    case ELLC_AST_SEQ:
+        stx = ellc_export_form(ELL_SYM(core_seq));
+        for (lnode_t *n = list_first(ast->seq.exprs); n; n = list_next(ast->seq.exprs, n))
+            if (!ellc_export_add(in, stx, (struct ellc_ast *) lnode_get(n), size)) return NULL;
+        return stx;
+    case ELLC_AST_APP:
+        return ellc_export_app(in, ast, size);
+    case ELLC_AST_LIT_SYM:
+        stx = ellc_export_form(ELL_SYM(core_quote));
+        ELL_SEND(stx, add, ell_make_stx_sym(ast->lit_sym.sym));
+        return stx;
+    case ELLC_AST_LIT_STR:
+        return ell_make_stx_str(ast->lit_str.str);
+    case ELLC_AST_LIT_NUM:
+        return ell_make_stx_num(ast->lit_num.num);
+    case ELLC_AST_THE:
+        stx = ellc_export_form(ELL_SYM(core_the));
+        ELL_SEND(stx, add, ell_make_stx_sym(ast->the.type));
+        return ellc_export_add(in, stx, ast->the.expr, size) ? stx : NULL;
+    case ELLC_AST_CCALL: {
+        stx = ellc_export_form(ELL_SYM(core_ccall));
+        ELL_SEND(stx, add, ell_make_stx_str(ast->ccall.name));
+        struct ell_obj *types_stx = ell_make_stx_lst();
+        list_t *types = ast->ccall.param_types;
+        for (lnode_t *n = list_first(types); n; n = list_next(types, n))
+            ELL_SEND(types_stx, add, ell_make_stx_sym((struct ell_obj *) lnode_get(n)));
+        ELL_SEND(stx, add, types_stx);
+        ELL_SEND(stx, add, ell_make_stx_sym(ast->ccall.result_type));
+        for (lnode_t *n = list_first(ast->ccall.args); n; n = list_next(ast->ccall.args, n))
+            if (!ellc_export_add(in, stx, (struct ellc_ast *) lnode_get(n), size)) return NULL;
+        return stx;
+    }
+    default:
+        return NULL;
+    }
+}
+
+/* FNV-1a hash of exported syntax, for naming the cell. */
+static uint64_t
+ellc_stx_hash(struct ell_obj *stx, uint64_t h)
+{
+    char buf[32];
+    char *chars;
+    if (stx->wrapper == ELL_WRAPPER(stx_lst)) {
+        h = (h ^ '(') * 1099511628211ULL;
+        list_t *elts = ell_stx_lst_elts(stx);
+        for (lnode_t *n = list_first(elts); n; n = list_next(elts, n))
+            h = ellc_stx_hash((struct ell_obj *) lnode_get(n), h);
+        return (h ^ ')') * 1099511628211ULL;
+    } else if (stx->wrapper == ELL_WRAPPER(stx_sym)) {
+        chars = ell_str_chars(ell_sym_name(ell_stx_sym_sym(stx)));
+    } else if (stx->wrapper == ELL_WRAPPER(stx_str)) {
+        h = (h ^ '"') * 1099511628211ULL;
+        chars = ell_str_chars(ell_stx_str_str(stx));
+    } else {
+        snprintf(buf, sizeof(buf), "%d", ell_num_int(ell_stx_num_num(stx)));
+        chars = buf;
+    }
+    for (char *c = chars; *c; c++)
+        h = (h ^ (unsigned char) *c) * 1099511628211ULL;
+    return (h ^ ' ') * 1099511628211ULL;
+}
+
+static void
+ellc_export_inline(struct ellc_st *st, struct ellc_ast *ast)
+{
+    struct ellc_params *params = ast->def.val->lam.params;
+    if ((list_count(params->opt) != 0) || (list_count(params->key) != 0)
+        || params->rest || params->all_keys)
+        return;
+    struct ellc_inline *in = (struct ellc_inline *) ell_alloc(sizeof(*in));
+    in->id = ast->def.id;
+    in->lam = &ast->def.val->lam;
+    struct ell_obj *params_stx = ell_make_stx_lst();
+    bool distinct = 1;
+    for (lnode_t *pn = list_first(params->req); pn; pn = list_next(params->req, pn)) {
+        struct ellc_id *param_id = ((struct ellc_param *) lnode_get(pn))->id;
+        for (lnode_t *qn = list_first(params->req); qn != pn; qn = list_next(params->req, qn))
+            if (((struct ellc_param *) lnode_get(qn))->id->sym == param_id->sym) distinct = 0;
+        ELL_SEND(params_stx, add, ell_make_stx_sym(param_id->sym));
+    }
+    unsigned size = 0;
+    struct ell_obj *body_stx = distinct ? ellc_export_ast(in, in->lam->body, &size) : NULL;
+    if (!body_stx) return;
+    in->stx = ellc_export_form(ELL_SYM(core_lam));
+    ELL_SEND(in->stx, add, params_stx);
+    ELL_SEND(in->stx, add, body_stx);
+    char *prefix = ellc_mangle_id("d", in->id);
+    in->cell = (char *) ell_alloc(strlen(prefix) + 18);
+    sprintf(in->cell, "%s_%016llx", prefix,
+            (unsigned long long) ellc_stx_hash(in->stx, 14695981039346656037ULL));
+    ell_util_list_add(st->exported_inlines, in);
+}
+
+/* A function defined more than once in the unit has a single link,
+   which each definition sets. */
+static void
+ellc_export_link(struct ellc_st *st, struct ellc_ast *ast)
+{
+    list_t *links = st->exported_links;
+    for (lnode_t *n = list_first(links); n; n = list_next(links, n)) {
+        struct ellc_link *link = (struct ellc_link *) lnode_get(n);
+        if (ellc_id_cmp(link->id, ast->def.id) == 0) {
+            link->lam = &ast->def.val->lam;
+            return;
+        }
+    }
+    struct ellc_link *link = (struct ellc_link *) ell_alloc(sizeof(*link));
+    link->id = ast->def.id;
+    link->lam = &ast->def.val->lam;
+    link->cell = ellc_mangle_id("l", link->id);
+    ell_util_list_add(links, link);
+}
+
+/* Exports the top-level functions of the unit for direct calls, and
+   the ones declared inline that qualify for inlining. */
+static void
+ellc_export(struct ellc_st *st, struct ellc_ast_seq *ast_seq)
+{
+    for (lnode_t *n = list_first(ast_seq->exprs); n; n = list_next(ast_seq->exprs, n)) {
+        struct ellc_ast *ast = (struct ellc_ast *) lnode_get(n);
+        if ((ast->type != ELLC_AST_DEF) || (ast->def.id->ns != ELLC_NS_FUN)
+            || ast->def.id->cx || (ast->def.val->type != ELLC_AST_LAM))
+            continue;
+        ellc_export_link(st, ast);
+        if (ell_util_list_contains(st->inline_decls, ast->def.id->sym, (dict_comp_t) &ell_ptr_cmp))
+            ellc_export_inline(st, ast);
+    }
+}
+
+/**** Closure Conversion ****/
+
+static void
+ellc_conv_ast(struct ellc_st *st, struct ellc_ast *ast);
+
+/* Orders constants by type and value, so that equal literals share a
+   slot in the constant pool. */
+static int
+ellc_constant_cmp(struct ell_obj *a, struct ell_obj *b)
+{
+    if (a->wrapper != b->wrapper)
+        return ell_ptr_cmp(a->wrapper, b->wrapper);
+    if (a->wrapper == ELL_WRAPPER(str))
+        return strcmp(ell_str_chars(a), ell_str_chars(b));
+    if (a->wrapper == ELL_WRAPPER(num_int))
+        return (ell_num_int(a) > ell_num_int(b)) - (ell_num_int(a) < ell_num_int(b));
+    return ell_ptr_cmp(a, b);
+}
+
+static void
+ellc_add_constant(struct ellc_st *st, struct ell_obj *obj)
+{
+    if (!dict_lookup(st->constants, obj))
+        ell_util_dict_put(st->constants, obj, (void *) (uintptr_t) dict_count(st->constants));
+}
+
+static void
+ellc_env_add_ref(struct ellc_ast_lam *lam, struct ellc_id *id)
+{
+    if (!dict_lookup(lam->env, id)) {
+        struct ellc_ast *ref = ellc_make_ast(ELLC_AST_REF);
+        ref->ref.id = id;
+        ell_util_dict_put(lam->env, id, ref);
+    }
+}
+
+/* Notes the capture of the variable P of the contour C at the bottom
+   contour by the lambdas in between that may escape (see
+   `ellc_ast_lam').  Lambdas that get lifted don't, but they are only
+   marked after their bodies have been converted, so the variable's
+   escaping is determined at the end of closure conversion. */
+static void
+ellc_note_capture(struct ellc_st *st, struct ellc_contour *c, struct ellc_param *p)
+{
+    struct ellc_contour *fc = ellc_function_contour(c);
+    for (struct ellc_contour *k = st->bottom_contour; k != fc; k = k->up) {
+        if (!k->lam->inlined && !k->lam->stack) {
+            struct ellc_capture *cap = (struct ellc_capture *) ell_alloc(sizeof(*cap));
+            cap->param = p;
+            cap->lam = k->lam;
+            ell_util_list_add(st->captures, cap);
+        }
+    }
+}
+
+static void
+ellc_conv_ref(struct ellc_st *st, struct ellc_ast *ast)
+{
+    struct ellc_param *p = NULL;
+    struct ellc_contour *c = ellc_contour_lookup(st->bottom_contour, ast->ref.id, &p);
+    if (!c) {
+        /* The identifier isn't lexically bound.  Now, we still need
+           to check whether it's defined at the top-level in the
+           current unit, before we follow the rule that all variables
+           are considered implicitly bound at the top-level.  For such
+           implicitly bound variables we need to ignore the hygiene
+           context. */
+        if (!ellc_defined_at_toplevel(st, ast->ref.id)) {
+            ast->ref.id->cx = NULL;
+        }
+        struct ellc_id *tmp_id = ast->ref.id;
+        ast->type = ELLC_AST_GLO_REF;
+        ast->glo_ref.id = tmp_id;
+        ell_util_set_add(st->globals, tmp_id, (dict_comp_t) &ellc_id_cmp);
+    } else if (ellc_function_contour(c) == ellc_function_contour(st->bottom_contour)) {
+        ast->type = ELLC_AST_ARG_REF;
+        ast->arg_ref.param = p;
+        p->referenced = 1;
+        p->nrefs++;
+    } else {
+        ast->type = ELLC_AST_ENV_REF;
+        ast->env_ref.param = p;
+        p->closed = 1;
+        p->referenced = 1;
+        p->nrefs++;
+        ellc_note_capture(st, c, p);
+        ellc_env_add_ref(ellc_function_contour(st->bottom_contour)->lam, p->id);
+    }
+}
+
+static void
+ellc_conv_def(struct ellc_st *st, struct ellc_ast *ast)
+{
+    ell_util_set_add(st->globals, ast->def.id, (dict_comp_t) &ellc_id_cmp);
+    ellc_conv_ast(st, ast->def.val);
+}
+
+static void
+ellc_conv_defp(struct ellc_st *st, struct ellc_ast *ast)
+{
+    /* See comment in ellc_conv_ref. */
+    if (!ellc_defined_at_toplevel(st, ast->defp.id)) {
+        ast->defp.id->cx = NULL;
+    }
+    ell_util_set_add(st->globals, ast->defp.id, (dict_comp_t) &ellc_id_cmp);
+}
+
+static void
+ellc_conv_set(struct ellc_st *st, struct ellc_ast *ast)
+{
+    ellc_conv_ast(st, ast->set.val);
+    struct ellc_param *p;
     struct ellc_contour *c = ellc_contour_lookup(st->bottom_contour, ast->set.id, &p);
     if (!c) {
         /* See comment in ellc_conv_ref. */
@@ -936,7 +2223,7 @@ ellc_conv_set(struct ellc_st *st, struct ellc_ast *ast)
         ast->type = ELLC_AST_GLO_SET;
         ast->glo_set.id = tmp_id;
         ell_util_set_add(st->globals, tmp_id, (dict_comp_t) &ellc_id_cmp);
-    } else if (c == st->bottom_contour) {
+    } else if (ellc_function_contour(c) == ellc_function_contour(st->bottom_contour)) {
         struct ellc_ast *tmp_val = ast->set.val;
         ast->type = ELLC_AST_ARG_SET;
         ast->arg_set.param = p;
@@ -949,7 +2236,8 @@ ellc_conv_set(struct ellc_st *st, struct ellc_ast *ast)
         ast->env_set.val = tmp_val;
         p->closed = 1;
         p->mutable = 1;
-        ellc_env_add_ref(st->bottom_contour->lam, p->id);
+        ellc_note_capture(st, c, p);
+        ellc_env_add_ref(ellc_function_contour(st->bottom_contour)->lam, p->id);
     }
 }
 
@@ -973,15 +2261,130 @@ ellc_conv_args(struct ellc_st *st, struct ellc_args *args)
 {
     for (lnode_t *n = list_first(&args->pos); n; n = list_next(&args->pos, n))
         ellc_conv_ast(st, (struct ellc_ast *) lnode_get(n));
-    for (dnode_t *n = dict_first(&args->key); n; n = dict_next(&args->key, n))
+    for (dnode_t *n = dict_first(&args->key); n; n = dict_next(&args->key, n)) {
+        ellc_add_constant(st, (struct ell_obj *) dnode_getkey(n));
         ellc_conv_ast(st, (struct ellc_ast *) dnode_get(n));
+    }
+}
+
+/* A lambda that's directly applied to exactly as many positional
+   arguments as it has required parameters, and that has no other
+   parameters, can be inlined into the enclosing function. */
+static bool
+ellc_is_inlinable_app(struct ellc_ast_app *app)
+{
+    if (app->op->type != ELLC_AST_LAM) return 0;
+    struct ellc_params *params = app->op->lam.params;
+    return (list_count(params->opt) == 0)
+        && (list_count(params->key) == 0)
+        && !params->rest
+        && !params->all_keys
+        && (list_count(params->req) == list_count(&app->args->pos))
+        && (dict_count(&app->args->key) == 0);
+}
+
+static void
+ellc_conv_inlined_lam(struct ellc_st *st, struct ellc_ast *ast)
+{
+    struct ellc_contour *c = (struct ellc_contour *) ell_alloc(sizeof(*c));
+    ast->lam.inlined = 1;
+    c->lam = &ast->lam;
+    c->up = st->bottom_contour;
+    st->bottom_contour = c;
+    ellc_conv_ast(st, ast->lam.body);
+    st->bottom_contour = c->up;
+}
+
+/* Escape analysis: checks whether the positional argument at index
+   I of the application is only called during the extent of the
+   application, i.e. it's passed to a built-in function that doesn't
+   store it anywhere.  Like open-coded primitives, this assumes that
+   built-ins aren't redefined by other units. */
+static bool
+ellc_is_downward_funarg(struct ellc_st *st, struct ellc_ast_app *app, unsigned i)
+{
+    if (app->op->type != ELLC_AST_GLO_REF) return 0;
+    struct ellc_id *id = app->op->glo_ref.id;
+    if ((id->ns != ELLC_NS_FUN) || ellc_defined_at_toplevel(st, id)) return 0;
+    struct ell_obj *sym = id->sym;
+    return ((sym == ELL_SYM(prim_block)) && (i == 0))
+        || ((sym == ELL_SYM(prim_unwind_protect)) && (i <= 1))
+        || ((sym == ELL_SYM(prim_handler_bind)) && (i >= 1) && (i <= 2))
+        || ((sym == ELL_SYM(prim_with_restart)) && (i == 1))
+        || ((sym == ELL_SYM(prim_map_list)) && (i == 0))
+        || ((sym == ELL_SYM(prim_map_column)) && (i == 0));
+}
+
+/* Lambda lifting: notes the lambdas bound to the parameters of an
+   inlined lambda, before its body is converted, and afterwards marks
+   those that were only referenced in direct calls as lifted. */
+static void
+ellc_note_bound_lams(struct ellc_ast_app *app)
+{
+    lnode_t *an = list_first(&app->args->pos);
+    list_t *req = app->op->lam.params->req;
+    for (lnode_t *pn = list_first(req); pn; pn = list_next(req, pn)) {
+        struct ellc_param *p = (struct ellc_param *) lnode_get(pn);
+        struct ellc_ast *arg = (struct ellc_ast *) lnode_get(an);
+        if (arg->type == ELLC_AST_LAM) {
+            struct ellc_params *params = arg->lam.params;
+            if ((list_count(params->opt) == 0) && (list_count(params->key) == 0)
+                && !params->rest && !params->all_keys)
+                p->lam = &arg->lam;
+        }
+        an = list_next(&app->args->pos, an);
+    }
+}
+
+static void
+ellc_lift_bound_lams(struct ellc_ast_app *app)
+{
+    list_t *req = app->op->lam.params->req;
+    for (lnode_t *pn = list_first(req); pn; pn = list_next(req, pn)) {
+        struct ellc_param *p = (struct ellc_param *) lnode_get(pn);
+        if (p->lam && !p->mutable && !p->closed && (p->nrefs == p->ncalls))
+            p->lam->lifted = 1;
+    }
+}
+
+/* Returns the parameter an application's operator refers to, if it
+   is a direct call of a lifted lambda, or NULL. */
+static struct ellc_param *
+ellc_lifted_app_param(struct ellc_ast_app *app)
+{
+    if (app->op->type != ELLC_AST_ARG_REF) return NULL;
+    struct ellc_param *p = app->op->arg_ref.param;
+    return (p->lam && p->lam->lifted) ? p : NULL;
 }
 
 static void
 ellc_conv_app(struct ellc_st *st, struct ellc_ast *ast)
 {
-    ellc_conv_ast(st, ast->app.op);
-    ellc_conv_args(st, ast->app.args);
+    if (ellc_is_inlinable_app(&ast->app)) {
+        ellc_conv_args(st, ast->app.args);
+        ellc_note_bound_lams(&ast->app);
+        ellc_conv_inlined_lam(st, ast->app.op);
+        ellc_lift_bound_lams(&ast->app);
+    } else {
+        ellc_conv_ast(st, ast->app.op);
+        if (ast->app.op->type == ELLC_AST_ARG_REF) {
+            struct ellc_param *p = ast->app.op->arg_ref.param;
+            if (p->lam
+                && (list_count(&ast->app.args->pos) == list_count(p->lam->params->req))
+                && (dict_count(&ast->app.args->key) == 0))
+                p->ncalls++;
+        }
+        // mark lambdas before converting them, for `ellc_note_capture'
+        unsigned i = 0;
+        list_t *pos = &ast->app.args->pos;
+        for (lnode_t *n = list_first(pos); n; n = list_next(pos, n)) {
+            struct ellc_ast *arg = (struct ellc_ast *) lnode_get(n);
+            if ((arg->type == ELLC_AST_LAM) && ellc_is_downward_funarg(st, &ast->app, i))
+                arg->lam.stack = 1;
+            i++;
+        }
+        ellc_conv_args(st, ast->app.args);
+    }
 }
 
 static void
@@ -1009,6 +2412,8 @@ ellc_conv_lam(struct ellc_st *st, struct ellc_ast *ast)
     c->up = st->bottom_contour;
     st->bottom_contour = c;
     ellc_conv_param_inits(st, ast->lam.params);
+    for (lnode_t *n = list_first(ast->lam.params->key); n; n = list_next(ast->lam.params->key, n))
+        ellc_add_constant(st, ((struct ellc_param *) lnode_get(n))->id->sym);
     ellc_conv_ast(st, ast->lam.body);
     st->bottom_contour = c->up;
     for (dnode_t *n = dict_first(ast->lam.env); n; n = dict_next(ast->lam.env, n))
@@ -1020,25 +2425,68 @@ ellc_conv_lam(struct ellc_st *st, struct ellc_ast *ast)
 static void
 ellc_conv_loop(struct ellc_st *st, struct ellc_ast *ast)
 {
+    if (ast->loop.test)
+        ellc_conv_ast(st, ast->loop.test);
     ellc_conv_ast(st, ast->loop.body);
 }
 
+static void
+ellc_conv_dlet(struct ellc_st *st, struct ellc_ast *ast)
+{
+    /* Only global variables can be dynamically bound. */
+    if (ellc_contour_lookup(st->bottom_contour, ast->dlet.id, NULL)) {
+        ell_fail("cannot dynamically bind lexical variable: %s\n",
+                 ell_str_chars(ell_sym_name(ast->dlet.id->sym)));
+    }
+    /* See comment in ellc_conv_ref. */
+    if (!ellc_defined_at_toplevel(st, ast->dlet.id)) {
+        ast->dlet.id->cx = NULL;
+    }
+    ell_util_set_add(st->globals, ast->dlet.id, (dict_comp_t) &ellc_id_cmp);
+    ellc_conv_ast(st, ast->dlet.val);
+    ellc_conv_ast(st, ast->dlet.body);
+}
+
 static void
 ellc_conv_cx(struct ellc_st *st, struct ellc_ast *ast)
 {
     ellc_conv_ast(st, ast->cx.body);
 }
 
+/* The strings in the bodies of inline C are emitted directly, so
+   they don't go into the constant pool. */
+static void
+ellc_conv_c_body(struct ellc_st *st, struct ellc_ast *body)
+{
+    for (lnode_t *n = list_first(body->seq.exprs); n; n = list_next(body->seq.exprs, n)) {
+        struct ellc_ast *expr = (struct ellc_ast *) lnode_get(n);
+        if (expr->type != ELLC_AST_LIT_STR)
+            ellc_conv_ast(st, expr);
+    }
+}
+
+static void
+ellc_conv_lit_stx(struct ellc_st *st, struct ellc_ast *ast)
+{
+    struct ell_obj *stx = ast->lit_stx.stx;
+    if (stx->wrapper == ELL_WRAPPER(stx_sym))
+        ellc_add_constant(st, ell_stx_sym_sym(stx));
+    else if (stx->wrapper == ELL_WRAPPER(stx_str))
+        ellc_add_constant(st, ell_stx_str_str(stx));
+    else if (stx->wrapper == ELL_WRAPPER(stx_num))
+        ellc_add_constant(st, ell_stx_num_num(stx));
+}
+
 static void
 ellc_conv_snip(struct ellc_st *st, struct ellc_ast *ast)
 {
-    ellc_conv_ast(st, ast->snip.body);
+    ellc_conv_c_body(st, ast->snip.body);
 }
 
 static void
 ellc_conv_stmt(struct ellc_st *st, struct ellc_ast *ast)
 {
-    ellc_conv_ast(st, ast->stmt.body);
+    ellc_conv_c_body(st, ast->stmt.body);
     ell_util_list_add(st->stmts, ast);
 }
 
@@ -1055,13 +2503,20 @@ ellc_conv_ast(struct ellc_st *st, struct ellc_ast *ast)
     case ELLC_AST_APP: ellc_conv_app(st, ast); break;
     case ELLC_AST_LAM: ellc_conv_lam(st, ast); break;
     case ELLC_AST_LOOP: ellc_conv_loop(st, ast); break;
+    case ELLC_AST_DLET: ellc_conv_dlet(st, ast); break;
     case ELLC_AST_CX: ellc_conv_cx(st, ast); break;
+    case ELLC_AST_THE: ellc_conv_ast(st, ast->the.expr); break;
+    case ELLC_AST_LTV: if (ast->ltv.init) ellc_conv_ast(st, ast->ltv.init); break;
+    case ELLC_AST_CCALL:
+        for (lnode_t *n = list_first(ast->ccall.args); n; n = list_next(ast->ccall.args, n))
+            ellc_conv_ast(st, (struct ellc_ast *) lnode_get(n));
+        break;
     case ELLC_AST_SNIP: ellc_conv_snip(st, ast); break;
     case ELLC_AST_STMT: ellc_conv_stmt(st, ast); break;
-    case ELLC_AST_LIT_SYM: break;
-    case ELLC_AST_LIT_STR: break;
-    case ELLC_AST_LIT_NUM: break;
-    case ELLC_AST_LIT_STX: break;
+    case ELLC_AST_LIT_SYM: ellc_add_constant(st, ast->lit_sym.sym); break;
+    case ELLC_AST_LIT_STR: ellc_add_constant(st, ast->lit_str.str); break;
+    case ELLC_AST_LIT_NUM: ellc_add_constant(st, ast->lit_num.num); break;
+    case ELLC_AST_LIT_STX: ellc_conv_lit_stx(st, ast); break;
     default:
         ell_fail("conversion error: %d\n", ast->type);
     }
@@ -1075,12 +2530,536 @@ ellc_conv(struct ellc_st *st, struct ellc_ast_seq *ast_seq)
     }
     for (lnode_t *n = list_first(ast_seq->exprs); n; n = list_next(ast_seq->exprs, n))
         ellc_conv_ast(st, (struct ellc_ast *) lnode_get(n));
+    for (lnode_t *n = list_first(st->captures); n; n = list_next(st->captures, n)) {
+        struct ellc_capture *cap = (struct ellc_capture *) lnode_get(n);
+        if (!cap->lam->lifted)
+            cap->param->escaping = 1;
+    }
+    // inlined functions are checked when the unit is loaded
+    for (lnode_t *n = list_first(st->inlined); n; n = list_next(st->inlined, n))
+        ell_util_set_add(st->globals, ((struct ellc_inline *) lnode_get(n))->id,
+                         (dict_comp_t) &ellc_id_cmp);
 }
 
-/**** Emission ****/
+/**** Primitives ****/
+
+/* Checks whether an application calls a built-in primitive with the
+   given number of positional arguments.  The operator must be a
+   reference to the global function (i.e. not lexically shadowed),
+   that's not defined in the current unit. */
+static bool
+ellc_is_prim_app(struct ellc_st *st, struct ellc_ast_app *app, struct ell_obj *sym,
+                 listcount_t npos)
+{
+    if (app->op->type != ELLC_AST_GLO_REF) return 0;
+    struct ellc_id *id = app->op->glo_ref.id;
+    return (id->sym == sym)
+        && (id->ns == ELLC_NS_FUN)
+        && !ellc_defined_at_toplevel(st, id)
+        && (list_count(&app->args->pos) == npos)
+        && (dict_count(&app->args->key) == 0);
+}
+
+static bool
+ellc_is_prim_arith_app(struct ellc_st *st, struct ellc_ast_app *app)
+{
+    return ellc_is_prim_app(st, app, ELL_SYM(prim_add), 2)
+        || ellc_is_prim_app(st, app, ELL_SYM(prim_sub), 2)
+        || ellc_is_prim_app(st, app, ELL_SYM(prim_mul), 2);
+}
+
+/* Returns the name of the emitted code macro for an application of a
+   built-in primitive that gets open-coded, or NULL. */
+static char *
+ellc_open_coded_prim(struct ellc_st *st, struct ellc_ast_app *app)
+{
+    if (ellc_is_prim_app(st, app, ELL_SYM(prim_add), 2)) return "ELL_GEN_ADD";
+    if (ellc_is_prim_app(st, app, ELL_SYM(prim_sub), 2)) return "ELL_GEN_SUB";
+    if (ellc_is_prim_app(st, app, ELL_SYM(prim_mul), 2)) return "ELL_GEN_MUL";
+    if (ellc_is_prim_app(st, app, ELL_SYM(prim_lt), 2)) return "ELL_GEN_LT";
+    return NULL;
+}
+
+/* Checks whether the application is a SLOT-VALUE or SET-SLOT-VALUE
+   with a quoted slot name, which is open-coded with an inline cache
+   for the call site. */
+static bool
+ellc_is_slot_app(struct ellc_st *st, struct ellc_ast_app *app)
+{
+    if (!ellc_is_prim_app(st, app, ELL_SYM(prim_slot_value), 2)
+        && !ellc_is_prim_app(st, app, ELL_SYM(prim_set_slot_value), 3))
+        return 0;
+    lnode_t *name_node = list_next(&app->args->pos, list_first(&app->args->pos));
+    return ((struct ellc_ast *) lnode_get(name_node))->type == ELLC_AST_LIT_SYM;
+}
+
+/* Checks whether the application is a MAKE with keyword arguments,
+   which is open-coded with a cache of slot indexes for the call
+   site. */
+static bool
+ellc_is_make_app(struct ellc_st *st, struct ellc_ast_app *app)
+{
+    if (app->op->type != ELLC_AST_GLO_REF) return 0;
+    struct ellc_id *id = app->op->glo_ref.id;
+    return (id->sym == ELL_SYM(prim_make))
+        && (id->ns == ELLC_NS_FUN)
+        && !ellc_defined_at_toplevel(st, id)
+        && (list_count(&app->args->pos) == 1)
+        && (dict_count(&app->args->key) > 0);
+}
+
+/* Checks whether the application is a VALUES with at most
+   ELL_MAX_VALUES values, which is open-coded. */
+static bool
+ellc_is_values_app(struct ellc_st *st, struct ellc_ast_app *app)
+{
+    listcount_t npos = list_count(&app->args->pos);
+    return (npos >= 1) && (npos <= ELL_MAX_VALUES)
+        && ellc_is_prim_app(st, app, ELL_SYM(prim_values), npos);
+}
+
+/* Checks whether the application is a MULTIPLE-VALUE-REF with a
+   literal index of an extra value, which is open-coded. */
+static bool
+ellc_is_multiple_value_ref_app(struct ellc_st *st, struct ellc_ast_app *app)
+{
+    if (!ellc_is_prim_app(st, app, ELL_SYM(prim_multiple_value_ref), 2)) return 0;
+    struct ellc_ast *index = (struct ellc_ast *) lnode_get(list_last(&app->args->pos));
+    if (index->type != ELLC_AST_LIT_NUM) return 0;
+    int i = ell_num_int(index->lit_num.num);
+    return (i >= 1) && (i < ELL_MAX_VALUES);
+}
+
+/* Returns 1 or 0 if the AST is a reference to the (global, not
+   redefined) true or false object, and -1 otherwise. */
+static int
+ellc_lit_bool(struct ellc_st *st, struct ellc_ast *ast)
+{
+    if (ast->type != ELLC_AST_GLO_REF) return -1;
+    struct ellc_id *id = ast->glo_ref.id;
+    if ((id->ns != ELLC_NS_VAR) || ellc_defined_at_toplevel(st, id)) return -1;
+    if (id->sym == ELL_SYM(prim_t)) return 1;
+    if (id->sym == ELL_SYM(prim_f)) return 0;
+    return -1;
+}
+
+/* Returns the name of the emitted code macro for an arithmetic
+   primitive on unboxed integers. */
+static char *
+ellc_int_arith_prim(struct ellc_st *st, struct ellc_ast_app *app)
+{
+    if (ellc_is_prim_app(st, app, ELL_SYM(prim_add), 2)) return "ELL_GEN_ADD_INT";
+    if (ellc_is_prim_app(st, app, ELL_SYM(prim_sub), 2)) return "ELL_GEN_SUB_INT";
+    if (ellc_is_prim_app(st, app, ELL_SYM(prim_mul), 2)) return "ELL_GEN_MUL_INT";
+    return NULL;
+}
+
+static bool
+ellc_is_inlined_app(struct ellc_ast *ast)
+{
+    return (ast->type == ELLC_AST_APP)
+        && (ast->app.op->type == ELLC_AST_LAM)
+        && ast->app.op->lam.inlined;
+}
+
+/**** Type Inference ****/
+
+/* Infers types for the parameters of inlined lambdas that aren't
+   closed over, so that they can be kept in unboxed C locals.  The
+   analysis is flow-insensitive: a local gets a type if every value
+   assigned to it (its argument and all updates) has that type.
+   Candidates start out as ELLC_TYPE_NONE, and get widened until a
+   fixpoint is reached.  Values of unboxed locals are boxed only when
+   they escape, i.e. when they are used as ordinary objects.  Only
+   fixnums and booleans are inferred: strings and closures have no
+   unboxed representation that would save anything, so they stay
+   objects. */
+
+static enum ellc_type
+ellc_type_join(enum ellc_type a, enum ellc_type b)
+{
+    if (a == ELLC_TYPE_NONE) return b;
+    if (b == ELLC_TYPE_NONE) return a;
+    return (a == b) ? a : ELLC_TYPE_OBJ;
+}
+
+static enum ellc_type
+ellc_ast_type(struct ellc_st *st, struct ellc_ast *ast);
+
+/* Returns the join of the types of the positional arguments. */
+static enum ellc_type
+ellc_args_type(struct ellc_st *st, struct ellc_ast_app *app)
+{
+    enum ellc_type type = ELLC_TYPE_NONE;
+    for (lnode_t *n = list_first(&app->args->pos); n; n = list_next(&app->args->pos, n))
+        type = ellc_type_join(type, ellc_ast_type(st, (struct ellc_ast *) lnode_get(n)));
+    return type;
+}
+
+static enum ellc_type
+ellc_app_type(struct ellc_st *st, struct ellc_ast *ast)
+{
+    struct ellc_ast_app *app = &ast->app;
+    if (ellc_is_inlined_app(ast)) {
+        return ellc_ast_type(st, app->op->lam.body);
+    } else if (ellc_is_prim_arith_app(st, app)) {
+        enum ellc_type t = ellc_args_type(st, app);
+        return ((t == ELLC_TYPE_FIXNUM) || (t == ELLC_TYPE_NONE)) ? t : ELLC_TYPE_OBJ;
+    } else if (ellc_is_prim_app(st, app, ELL_SYM(prim_lt), 2)
+               || ellc_is_prim_app(st, app, ELL_SYM(prim_typeq), 2)) {
+        return ELLC_TYPE_BOOL;
+    } else {
+        return ELLC_TYPE_OBJ;
+    }
+}
+
+static enum ellc_type
+ellc_ast_type(struct ellc_st *st, struct ellc_ast *ast)
+{
+    switch(ast->type) {
+    case ELLC_AST_LIT_NUM:
+        return ELLC_TYPE_FIXNUM;
+    case ELLC_AST_GLO_REF:
+        return (ellc_lit_bool(st, ast) != -1) ? ELLC_TYPE_BOOL : ELLC_TYPE_OBJ;
+    case ELLC_AST_ARG_REF: {
+        struct ellc_param *p = ast->arg_ref.param;
+        return (p->type != ELLC_TYPE_OBJ) ? p->type : p->narrowed;
+    }
+    case ELLC_AST_DEFP:
+        return ELLC_TYPE_BOOL;
+    case ELLC_AST_COND:
+        return ellc_type_join(ellc_ast_type(st, ast->cond.consequent),
+                              ellc_ast_type(st, ast->cond.alternative));
+    case ELLC_AST_SEQ:
+        if (list_count(ast->seq.exprs) == 0)
+            return ELLC_TYPE_OBJ;
+        return ellc_ast_type(st, (struct ellc_ast *) lnode_get(list_last(ast->seq.exprs)));
+    case ELLC_AST_APP:
+        return ellc_app_type(st, ast);
+    case ELLC_AST_THE:
+        return ELLC_TYPE_FIXNUM;
+    case ELLC_AST_CCALL:
+        if (ast->ccall.result_type == ELL_SYM(prim_integer_class)) return ELLC_TYPE_FIXNUM;
+        if (ast->ccall.result_type == ELL_SYM(ctype_boolean)) return ELLC_TYPE_BOOL;
+        return ELLC_TYPE_OBJ;
+    default:
+        return ELLC_TYPE_OBJ;
+    }
+}
+
+static void
+ellc_infer_ast(struct ellc_st *st, struct ellc_ast *ast, dict_t *assigns);
+
+static void
+ellc_infer_list(struct ellc_st *st, list_t *asts, dict_t *assigns)
+{
+    for (lnode_t *n = list_first(asts); n; n = list_next(asts, n))
+        ellc_infer_ast(st, (struct ellc_ast *) lnode_get(n), assigns);
+}
+
+static void
+ellc_infer_candidate(struct ellc_param *p, struct ellc_ast *val, dict_t *assigns)
+{
+    dnode_t *n = dict_lookup(assigns, p);
+    if (n) {
+        ell_util_list_add((list_t *) dnode_get(n), val);
+    } else {
+        list_t *vals = ell_util_make_list();
+        ell_util_list_add(vals, val);
+        ell_util_dict_put(assigns, p, vals);
+        p->type = ELLC_TYPE_NONE;
+    }
+}
+
+static void
+ellc_infer_app(struct ellc_st *st, struct ellc_ast *ast, dict_t *assigns)
+{
+    struct ellc_ast_app *app = &ast->app;
+    ellc_infer_list(st, &app->args->pos, assigns);
+    for (dnode_t *n = dict_first(&app->args->key); n; n = dict_next(&app->args->key, n))
+        ellc_infer_ast(st, (struct ellc_ast *) dnode_get(n), assigns);
+    if (ellc_is_inlined_app(ast)) {
+        struct ellc_ast_lam *lam = &app->op->lam;
+        lnode_t *an = list_first(&app->args->pos);
+        for (lnode_t *pn = list_first(lam->params->req); pn; pn = list_next(lam->params->req, pn)) {
+            struct ellc_param *p = (struct ellc_param *) lnode_get(pn);
+            if (p->closed)
+                ;
+            else if (p->declared != ELLC_TYPE_OBJ)
+                p->type = p->declared;
+            else
+                ellc_infer_candidate(p, (struct ellc_ast *) lnode_get(an), assigns);
+            an = list_next(&app->args->pos, an);
+        }
+        ellc_infer_ast(st, lam->body, assigns);
+    } else {
+        ellc_infer_ast(st, app->op, assigns);
+    }
+}
+
+/* Required parameters declared to have a type get it, unless they're
+   closed over. */
+static void
+ellc_infer_declared(list_t *params)
+{
+    for (lnode_t *n = list_first(params); n; n = list_next(params, n)) {
+        struct ellc_param *p = (struct ellc_param *) lnode_get(n);
+        if (!p->closed && (p->declared != ELLC_TYPE_OBJ))
+            p->type = p->declared;
+    }
+}
+
+static void
+ellc_infer_params_list(struct ellc_st *st, list_t *params, dict_t *assigns)
+{
+    for (lnode_t *n = list_first(params); n; n = list_next(params, n)) {
+        struct ellc_param *p = (struct ellc_param *) lnode_get(n);
+        if (p->init)
+            ellc_infer_ast(st, p->init, assigns);
+    }
+}
+
+static void
+ellc_infer_ast(struct ellc_st *st, struct ellc_ast *ast, dict_t *assigns)
+{
+    switch(ast->type) {
+    case ELLC_AST_DEF: ellc_infer_ast(st, ast->def.val, assigns); break;
+    case ELLC_AST_GLO_SET: ellc_infer_ast(st, ast->glo_set.val, assigns); break;
+    case ELLC_AST_ENV_SET: ellc_infer_ast(st, ast->env_set.val, assigns); break;
+    case ELLC_AST_ARG_SET: {
+        ellc_infer_ast(st, ast->arg_set.val, assigns);
+        if (dict_lookup(assigns, ast->arg_set.param))
+            ellc_infer_candidate(ast->arg_set.param, ast->arg_set.val, assigns);
+        break;
+    }
+    case ELLC_AST_COND:
+        ellc_infer_ast(st, ast->cond.test, assigns);
+        ellc_infer_ast(st, ast->cond.consequent, assigns);
+        ellc_infer_ast(st, ast->cond.alternative, assigns);
+        break;
+    case ELLC_AST_SEQ: ellc_infer_list(st, ast->seq.exprs, assigns); break;
+    case ELLC_AST_APP: ellc_infer_app(st, ast, assigns); break;
+    case ELLC_AST_LAM:
+        if (!ast->lam.lifted)
+            ellc_infer_declared(ast->lam.params->req);
+        ellc_infer_params_list(st, ast->lam.params->opt, assigns);
+        ellc_infer_params_list(st, ast->lam.params->key, assigns);
+        ellc_infer_ast(st, ast->lam.body, assigns);
+        break;
+    case ELLC_AST_LOOP:
+        if (ast->loop.test)
+            ellc_infer_ast(st, ast->loop.test, assigns);
+        ellc_infer_ast(st, ast->loop.body, assigns);
+        break;
+    case ELLC_AST_DLET:
+        ellc_infer_ast(st, ast->dlet.val, assigns);
+        ellc_infer_ast(st, ast->dlet.body, assigns);
+        break;
+    case ELLC_AST_CX: ellc_infer_ast(st, ast->cx.body, assigns); break;
+    case ELLC_AST_THE: ellc_infer_ast(st, ast->the.expr, assigns); break;
+    case ELLC_AST_LTV: if (ast->ltv.init) ellc_infer_ast(st, ast->ltv.init, assigns); break;
+    case ELLC_AST_CCALL: ellc_infer_list(st, ast->ccall.args, assigns); break;
+    case ELLC_AST_SNIP: ellc_infer_ast(st, ast->snip.body, assigns); break;
+    case ELLC_AST_STMT: ellc_infer_ast(st, ast->stmt.body, assigns); break;
+    default: break;
+    }
+}
+
+static void
+ellc_infer(struct ellc_st *st, struct ellc_ast_seq *ast_seq)
+{
+    dict_t *assigns = ell_util_make_dict((dict_comp_t) &ell_ptr_cmp); // param -> list of ast
+    ellc_infer_list(st, ast_seq->exprs, assigns);
+    bool changed;
+    do {
+        changed = 0;
+        for (dnode_t *n = dict_first(assigns); n; n = dict_next(assigns, n)) {
+            struct ellc_param *p = (struct ellc_param *) dnode_getkey(n);
+            list_t *vals = (list_t *) dnode_get(n);
+            enum ellc_type type = ELLC_TYPE_NONE;
+            for (lnode_t *vn = list_first(vals); vn; vn = list_next(vals, vn))
+                type = ellc_type_join(type, ellc_ast_type(st, (struct ellc_ast *) lnode_get(vn)));
+            if (type != p->type) {
+                p->type = type;
+                changed = 1;
+            }
+        }
+    } while (changed);
+    for (dnode_t *n = dict_first(assigns); n; n = dict_next(assigns, n)) {
+        struct ellc_param *p = (struct ellc_param *) dnode_getkey(n);
+        if (p->type == ELLC_TYPE_NONE)
+            p->type = ELLC_TYPE_OBJ;
+    }
+}
+
+/**** Unbound Check Elision ****/
+
+/* Marks references and updates of global variables that are known to
+   be bound, so that they can be emitted without an unbound check.
+   There's no way to unbind a global variable, and a failed unbound
+   check exits.  So a global is known to be bound at a point of a
+   unit if it has been defined or checked on every path to that point,
+   or if it's bound before the unit is loaded.  The body of a lambda
+   can only run after the lambda has been created, so it starts out
+   with the globals known to be bound where the lambda is created.
+
+   Checks done in the first iteration of a loop are hoisted out of
+   the remaining iterations (see `ellc_ast_loop'). */
+
+static void
+ellc_elide_ast(struct ellc_st *st, struct ellc_ast *ast);
+
+/* Checks whether a global variable is bound before the current unit
+   is loaded: either it's bound by the runtime, or defined by a unit
+   whose CFASL has been loaded at compile-time (see
+   `ellc_defined_tab').  What happens to be bound in the compiler
+   process, e.g. by compile-time evaluation, doesn't count, because
+   the unit's FASL will be loaded into a different process. */
+static bool
+ellc_bound_before_unit(struct ellc_id *id)
+{
+    if (id->cx != NULL) return 0;
+    return dict_lookup(&ellc_defined_tab, id) != NULL;
+}
+
+/* Returns whether a global variable is known to be bound at the
+   current point, and records it as bound from now on. */
+static bool
+ellc_elide_check(struct ellc_st *st, struct ellc_id *id)
+{
+    if (ell_util_list_contains(st->bound_globals, id, (dict_comp_t) &ellc_id_cmp)
+        || ellc_bound_before_unit(id))
+        return 1;
+    ell_util_list_add(st->bound_globals, id);
+    return 0;
+}
+
+/* Forgets the globals recorded as bound after the first MARK ones,
+   when leaving code that may not be executed. */
+static void
+ellc_elide_forget(struct ellc_st *st, listcount_t mark)
+{
+    while (list_count(st->bound_globals) > mark)
+        list_del_last(st->bound_globals);
+}
+
+static void
+ellc_elide_list(struct ellc_st *st, list_t *asts)
+{
+    for (lnode_t *n = list_first(asts); n; n = list_next(asts, n))
+        ellc_elide_ast(st, (struct ellc_ast *) lnode_get(n));
+}
+
+static void
+ellc_elide_cond(struct ellc_st *st, struct ellc_ast *ast)
+{
+    ellc_elide_ast(st, ast->cond.test);
+    listcount_t mark = list_count(st->bound_globals);
+    ellc_elide_ast(st, ast->cond.consequent);
+    ellc_elide_forget(st, mark);
+    ellc_elide_ast(st, ast->cond.alternative);
+    ellc_elide_forget(st, mark);
+}
+
+/* Follows the evaluation order of the emitted code: arguments are
+   evaluated before the operator. */
+static void
+ellc_elide_app(struct ellc_st *st, struct ellc_ast *ast)
+{
+    struct ellc_ast_app *app = &ast->app;
+    ellc_elide_list(st, &app->args->pos);
+    for (dnode_t *n = dict_first(&app->args->key); n; n = dict_next(&app->args->key, n))
+        ellc_elide_ast(st, (struct ellc_ast *) dnode_get(n));
+    if (ellc_is_inlined_app(ast))
+        ellc_elide_ast(st, app->op->lam.body);
+    else
+        ellc_elide_ast(st, app->op);
+}
+
+static void
+ellc_elide_params_list_inits(struct ellc_st *st, list_t *params)
+{
+    for (lnode_t *n = list_first(params); n; n = list_next(params, n)) {
+        struct ellc_param *p = (struct ellc_param *) lnode_get(n);
+        if (p->init) {
+            listcount_t mark = list_count(st->bound_globals);
+            ellc_elide_ast(st, p->init);
+            ellc_elide_forget(st, mark);
+        }
+    }
+}
+
+static void
+ellc_elide_lam(struct ellc_st *st, struct ellc_ast *ast)
+{
+    listcount_t mark = list_count(st->bound_globals);
+    ellc_elide_params_list_inits(st, ast->lam.params->opt);
+    ellc_elide_params_list_inits(st, ast->lam.params->key);
+    ellc_elide_ast(st, ast->lam.body);
+    ellc_elide_forget(st, mark);
+}
+
+static void
+ellc_elide_loop(struct ellc_st *st, struct ellc_ast *ast)
+{
+    listcount_t mark = list_count(st->bound_globals);
+    if (ast->loop.test)
+        ellc_elide_ast(st, ast->loop.test);
+    listcount_t test_mark = list_count(st->bound_globals);
+    ellc_elide_ast(st, ast->loop.body);
+    if (list_count(st->bound_globals) > mark) {
+        ast->loop.hoisted = ell_util_sublist(st->bound_globals, mark);
+    }
+    // The body of a loop with a test may not be executed
+    if (ast->loop.test)
+        ellc_elide_forget(st, test_mark);
+}
+
+static void
+ellc_elide_ast(struct ellc_st *st, struct ellc_ast *ast)
+{
+    switch(ast->type) {
+    case ELLC_AST_GLO_REF:
+        ast->glo_ref.bound = ellc_elide_check(st, ast->glo_ref.id);
+        break;
+    case ELLC_AST_GLO_SET:
+        ellc_elide_ast(st, ast->glo_set.val);
+        ast->glo_set.bound = ellc_elide_check(st, ast->glo_set.id);
+        break;
+    case ELLC_AST_DEF:
+        ellc_elide_ast(st, ast->def.val);
+        ellc_elide_check(st, ast->def.id);
+        break;
+    case ELLC_AST_ARG_SET: ellc_elide_ast(st, ast->arg_set.val); break;
+    case ELLC_AST_ENV_SET: ellc_elide_ast(st, ast->env_set.val); break;
+    case ELLC_AST_COND: ellc_elide_cond(st, ast); break;
+    case ELLC_AST_SEQ: ellc_elide_list(st, ast->seq.exprs); break;
+    case ELLC_AST_APP: ellc_elide_app(st, ast); break;
+    case ELLC_AST_LAM: ellc_elide_lam(st, ast); break;
+    case ELLC_AST_LOOP: ellc_elide_loop(st, ast); break;
+    case ELLC_AST_DLET:
+        // The old value is read with an unbound check
+        ellc_elide_ast(st, ast->dlet.val);
+        ellc_elide_check(st, ast->dlet.id);
+        ellc_elide_ast(st, ast->dlet.body);
+        break;
+    case ELLC_AST_CX: ellc_elide_ast(st, ast->cx.body); break;
+    case ELLC_AST_THE: ellc_elide_ast(st, ast->the.expr); break;
+    case ELLC_AST_LTV: if (ast->ltv.init) ellc_elide_ast(st, ast->ltv.init); break;
+    case ELLC_AST_CCALL: ellc_elide_list(st, ast->ccall.args); break;
+    case ELLC_AST_SNIP: ellc_elide_ast(st, ast->snip.body); break;
+    case ELLC_AST_STMT: ellc_elide_ast(st, ast->stmt.body); break;
+    default: break;
+    }
+}
 
 static void
-ellc_emit_ast(struct ellc_st *st, struct ellc_ast *ast);
+ellc_elide(struct ellc_st *st, struct ellc_ast_seq *ast_seq)
+{
+    ellc_elide_list(st, ast_seq->exprs);
+}
+
+/**** Mangling ****/
 
 static char
 ellc_mangle_char(char c)
@@ -1097,6 +3076,7 @@ ellc_mangle_char(char c)
     case '*': return 'Z';
     case '+': return 'P';
     case '?': return 'Q';
+    case ':': return 'C';
     default: return c;
     }
 }
@@ -1109,557 +3089,2040 @@ ellc_mangle_str(char *s)
     for (int i = 0; i < len; i++) {
         out[i] = ellc_mangle_char(s[i]);
     }
-    out[len] = '\0';
-    return out;
+    out[len] = '\0';
+    return out;
+}
+
+static char *ELLC_NO_CX = "";
+
+static char *
+ellc_mangle_cx(struct ell_cx *cx)
+{
+    if (cx->uuid != NULL) {
+        char *out = (char *) ell_alloc(37);
+        uuid_unparse(cx->uuid, out);
+        return ellc_mangle_str(out);
+    } else {
+        return ELLC_NO_CX;
+    }
+}
+
+static char *
+ellc_mangle_id(char *prefix, struct ellc_id *id)
+{
+    char *std = "__ell";
+    char *name = ellc_mangle_str(ell_str_chars(ell_sym_name(id->sym)));
+    char *cx = ellc_mangle_cx(id->cx);
+    size_t prefix_len = strlen(prefix);
+    size_t std_len = strlen(std);
+    size_t name_len = strlen(name);
+    size_t cx_len = strlen(cx);
+    size_t len = std_len + prefix_len + name_len + cx_len
+        + 4  // separators
+        + 1  // ns (single digit, lest this become a Lisp-10)
+        + 1; // zero
+    char *out = (char *) ell_alloc(len);
+    snprintf(out, len, "%s_%s_%s_%u_%s", std, prefix, name, id->ns, cx);
+    return out;
+}
+
+static char *
+ellc_mangle_glo_id(struct ellc_id *id)
+{
+    return ellc_mangle_id("g", id);
+}
+
+static char *
+ellc_mangle_param_id(struct ellc_id *id)
+{
+    return ellc_mangle_id("p", id);
+}
+
+static char *
+ellc_mangle_env_id(struct ellc_id *id)
+{
+    return ellc_mangle_id("e", id);
+}
+
+/**** Lowering: Explicit Form AST -> IR ****/
+
+/* Lowering follows the evaluation order of the AST: arguments are
+   evaluated left to right, before the operator.  Depending on where
+   an expression appears, it's lowered to a temporary of a given type
+   (see `ellc_lower_typed()'): an object, an unboxed integer, a C
+   condition in test position, or nothing if the value is not used. */
+
+static struct ellc_ir_opnd *
+ellc_lower_ast(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast);
+
+static struct ellc_ir_opnd *
+ellc_lower_typed(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast,
+                 enum ellc_type type);
+
+static struct ellc_ir_fun *
+ellc_make_ir_fun(enum ellc_ir_fun_type type, struct ellc_ast_lam *lam)
+{
+    struct ellc_ir_fun *fun = (struct ellc_ir_fun *) ell_alloc(sizeof(*fun));
+    fun->type = type;
+    fun->lam = lam;
+    fun->blocks = ell_util_make_list();
+    fun->tmps = ell_util_make_list();
+    fun->locals = ell_util_make_dict((dict_comp_t) &ell_ptr_cmp);
+    fun->clos = ell_util_make_list();
+    fun->lifted = ell_util_make_list();
+    fun->cx = -1;
+    return fun;
+}
+
+static struct ellc_ir_opnd *
+ellc_ir_tmp(struct ellc_ir_fun *fun, enum ellc_type type)
+{
+    struct ellc_ir_opnd *opnd = (struct ellc_ir_opnd *) ell_alloc(sizeof(*opnd));
+    opnd->type = ELLC_IR_OPND_TMP;
+    opnd->tmp = list_count(fun->tmps);
+    ell_util_list_add(fun->tmps, (void *) (uintptr_t) type);
+    return opnd;
+}
+
+static struct ellc_ir_opnd *
+ellc_ir_const(struct ell_obj *obj)
+{
+    struct ellc_ir_opnd *opnd = (struct ellc_ir_opnd *) ell_alloc(sizeof(*opnd));
+    opnd->type = ELLC_IR_OPND_CONST;
+    opnd->obj = obj;
+    return opnd;
+}
+
+static struct ellc_ir_opnd *
+ellc_ir_c(char *c)
+{
+    struct ellc_ir_opnd *opnd = (struct ellc_ir_opnd *) ell_alloc(sizeof(*opnd));
+    opnd->type = ELLC_IR_OPND_C;
+    opnd->c = c;
+    return opnd;
+}
+
+static struct ellc_ir_opnd *
+ellc_ir_c_int(int i)
+{
+    char *c = (char *) ell_alloc(16);
+    snprintf(c, 16, "%d", i);
+    return ellc_ir_c(c);
+}
+
+/* Returns the C expression for the I-th argument of a closure's code
+   or of a lifted function. */
+static struct ellc_ir_opnd *
+ellc_ir_c_arg(struct ellc_ir_fun *fun, unsigned i)
+{
+    char *c = (char *) ell_alloc(32);
+    if (fun->type == ELLC_IR_FUN_LIFTED)
+        snprintf(c, 32, "__ell_arg_%u", i);
+    else
+        snprintf(c, 32, "__ell_args[%u]", i);
+    return ellc_ir_c(c);
+}
+
+/* Returns the C name of a local, see `ellc_ir_fun'. */
+static char *
+ellc_ir_local(struct ellc_ir_fun *fun, struct ellc_param *p)
+{
+    dnode_t *n = dict_lookup(fun->locals, p);
+    if (n) return (char *) dnode_get(n);
+    char *mid = ellc_mangle_param_id(p->id);
+    size_t len = strlen(mid) + 16;
+    char *name = (char *) ell_alloc(len);
+    snprintf(name, len, "%s%lu", mid, dict_count(fun->locals));
+    ell_util_dict_put(fun->locals, p, name);
+    return name;
+}
+
+static struct ellc_ir_block *
+ellc_ir_make_block(struct ellc_ir_fun *fun)
+{
+    struct ellc_ir_block *block = (struct ellc_ir_block *) ell_alloc(sizeof(*block));
+    block->id = fun->nblocks++;
+    block->insns = ell_util_make_list();
+    return block;
+}
+
+/* Appends a block to the function, and makes it the current block. */
+static void
+ellc_ir_start(struct ellc_ir_fun *fun, struct ellc_ir_block *block)
+{
+    ell_util_list_add(fun->blocks, block);
+    fun->cur = block;
+}
+
+/* Appends an instruction to the current block. */
+static struct ellc_ir_insn *
+ellc_ir_add(struct ellc_ir_fun *fun, enum ellc_ir_insn_type type, struct ellc_ir_opnd *dst)
+{
+    struct ellc_ir_insn *insn = (struct ellc_ir_insn *) ell_alloc(sizeof(*insn));
+    insn->type = type;
+    insn->dst = dst;
+    insn->args = ell_util_make_list();
+    ell_util_list_add(fun->cur->insns, insn);
+    return insn;
+}
+
+static void
+ellc_ir_add_arg(struct ellc_ir_insn *insn, struct ellc_ir_opnd *arg)
+{
+    ell_util_list_add(insn->args, arg);
+}
+
+static void
+ellc_ir_move(struct ellc_ir_fun *fun, struct ellc_ir_opnd *dst, struct ellc_ir_opnd *src)
+{
+    ellc_ir_add_arg(ellc_ir_add(fun, ELLC_IR_MOVE, dst), src);
+}
+
+static void
+ellc_ir_jump(struct ellc_ir_fun *fun, struct ellc_ir_block *block)
+{
+    ellc_ir_add(fun, ELLC_IR_JUMP, NULL)->br.then_block = block;
+}
+
+static void
+ellc_ir_branch(struct ellc_ir_fun *fun, struct ellc_ir_opnd *test,
+               struct ellc_ir_block *then_block, struct ellc_ir_block *else_block)
+{
+    struct ellc_ir_insn *insn = ellc_ir_add(fun, ELLC_IR_BRANCH, NULL);
+    ellc_ir_add_arg(insn, test);
+    insn->br.then_block = then_block;
+    insn->br.else_block = else_block;
+}
+
+/* Appends an instruction using a C function or emitted code macro
+   with NARGS arguments.  Returns the result temporary, or NULL for
+   ELLC_TYPE_NONE. */
+static struct ellc_ir_opnd *
+ellc_ir_prim(struct ellc_ir_fun *fun, enum ellc_type type, char *name, bool pure,
+             unsigned nargs, ...)
+{
+    struct ellc_ir_opnd *dst = (type == ELLC_TYPE_NONE) ? NULL : ellc_ir_tmp(fun, type);
+    struct ellc_ir_insn *insn = ellc_ir_add(fun, ELLC_IR_PRIM, dst);
+    insn->prim.name = name;
+    insn->prim.pure = pure;
+    va_list ap;
+    va_start(ap, nargs);
+    for (unsigned i = 0; i < nargs; i++)
+        ellc_ir_add_arg(insn, va_arg(ap, struct ellc_ir_opnd *));
+    va_end(ap);
+    return dst;
+}
+
+/* Converts an unboxed value to an object. */
+static struct ellc_ir_opnd *
+ellc_lower_to_obj(struct ellc_ir_fun *fun, struct ellc_ir_opnd *val, enum ellc_type type)
+{
+    switch(type) {
+    case ELLC_TYPE_FIXNUM: return ellc_ir_prim(fun, ELLC_TYPE_OBJ, "ell_make_num_from_int", 1, 1, val);
+    case ELLC_TYPE_BOOL: return ellc_ir_prim(fun, ELLC_TYPE_OBJ, "ell_truth", 1, 1, val);
+    default: return val;
+    }
+}
+
+/* At safety 0, globals are assumed to be bound. */
+static bool
+ellc_lower_glo_bound_p(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_id *id, bool bound)
+{
+    return bound || (fun->safety == 0)
+        || ell_util_list_contains(st->hoisted_globals, id, (dict_comp_t) &ellc_id_cmp);
+}
+
+static struct ellc_ir_opnd *
+ellc_lower_glo_ref(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast)
+{
+    struct ellc_ir_insn *insn = ellc_ir_add(fun, ELLC_IR_GLO_REF, ellc_ir_tmp(fun, ELLC_TYPE_OBJ));
+    insn->glo.id = ast->glo_ref.id;
+    insn->glo.bound = ellc_lower_glo_bound_p(st, fun, ast->glo_ref.id, ast->glo_ref.bound);
+    return insn->dst;
+}
+
+/* Returns the value of a local, unboxed if it has a type. */
+static struct ellc_ir_opnd *
+ellc_lower_var_ref(struct ellc_ir_fun *fun, struct ellc_param *p)
+{
+    ellc_ir_local(fun, p);
+    struct ellc_ir_insn *insn = ellc_ir_add(fun, ELLC_IR_VAR_REF, ellc_ir_tmp(fun, p->type));
+    insn->param = p;
+    return insn->dst;
+}
+
+static void
+ellc_lower_var_init(struct ellc_ir_fun *fun, struct ellc_param *p, struct ellc_ir_opnd *val)
+{
+    ellc_ir_local(fun, p);
+    struct ellc_ir_insn *insn = ellc_ir_add(fun, ELLC_IR_VAR_INIT, NULL);
+    insn->param = p;
+    ellc_ir_add_arg(insn, val);
+}
+
+static void
+ellc_lower_var_set(struct ellc_ir_fun *fun, struct ellc_param *p, struct ellc_ir_opnd *val)
+{
+    ellc_ir_local(fun, p);
+    struct ellc_ir_insn *insn = ellc_ir_add(fun, ELLC_IR_VAR_SET, NULL);
+    insn->param = p;
+    ellc_ir_add_arg(insn, val);
+}
+
+static struct ellc_ir_opnd *
+ellc_lower_arg_ref(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast)
+{
+    struct ellc_param *p = ast->arg_ref.param;
+    return ellc_lower_to_obj(fun, ellc_lower_var_ref(fun, p), p->type);
+}
+
+static struct ellc_ir_opnd *
+ellc_lower_env_ref(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast)
+{
+    struct ellc_ir_insn *insn = ellc_ir_add(fun, ELLC_IR_ENV_REF, ellc_ir_tmp(fun, ELLC_TYPE_OBJ));
+    insn->param = ast->env_ref.param;
+    return insn->dst;
+}
+
+static struct ellc_ir_opnd *
+ellc_lower_def(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast)
+{
+    struct ellc_ir_opnd *val = ellc_lower_ast(st, fun, ast->def.val);
+    struct ellc_ir_insn *insn = ellc_ir_add(fun, ELLC_IR_DEF, NULL);
+    insn->glo.id = ast->def.id;
+    ellc_ir_add_arg(insn, val);
+    if (ast->def.val->type != ELLC_AST_LAM) return val;
+    struct ellc_ast_lam *lam = &ast->def.val->lam;
+    list_t *inlines = st->exported_inlines;
+    for (lnode_t *n = list_first(inlines); n; n = list_next(inlines, n)) {
+        struct ellc_inline *in = (struct ellc_inline *) lnode_get(n);
+        if (in->lam == lam)
+            ellc_ir_prim(fun, ELLC_TYPE_NONE, "ELL_GEN_SET_CELL", 0, 2, ellc_ir_c(in->cell), val);
+    }
+    list_t *links = st->exported_links;
+    for (lnode_t *n = list_first(links); n; n = list_next(links, n)) {
+        struct ellc_link *link = (struct ellc_link *) lnode_get(n);
+        if (ellc_id_cmp(link->id, ast->def.id) == 0)
+            ellc_ir_prim(fun, ELLC_TYPE_NONE, "ELL_GEN_SET_LINK", 0, 2, ellc_ir_c(link->cell), val);
+    }
+    return val;
+}
+
+static struct ellc_ir_opnd *
+ellc_lower_defp(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast)
+{
+    return ellc_ir_prim(fun, ELLC_TYPE_OBJ, "ELL_GEN_DEFP", 1, 1,
+                        ellc_ir_c(ellc_mangle_glo_id(ast->defp.id)));
+}
+
+static struct ellc_ir_opnd *
+ellc_lower_glo_set(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast)
+{
+    struct ellc_ir_opnd *val = ellc_lower_ast(st, fun, ast->glo_set.val);
+    struct ellc_ir_insn *insn = ellc_ir_add(fun, ELLC_IR_GLO_SET, NULL);
+    insn->glo.id = ast->glo_set.id;
+    insn->glo.bound = ellc_lower_glo_bound_p(st, fun, ast->glo_set.id, ast->glo_set.bound);
+    ellc_ir_add_arg(insn, val);
+    return val;
+}
+
+/* Updates of boxed variables return unspecified. */
+static struct ellc_ir_opnd *
+ellc_lower_arg_set(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast)
+{
+    struct ellc_param *p = ast->arg_set.param;
+    struct ellc_ir_opnd *val = ellc_lower_typed(st, fun, ast->arg_set.val, p->type);
+    ellc_lower_var_set(fun, p, val);
+    if (ellc_param_boxed(p))
+        return ellc_ir_c("ell_unspecified");
+    return ellc_lower_to_obj(fun, val, p->type);
+}
+
+static struct ellc_ir_opnd *
+ellc_lower_env_set(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast)
+{
+    struct ellc_param *p = ast->env_set.param;
+    struct ellc_ir_opnd *val = ellc_lower_ast(st, fun, ast->env_set.val);
+    struct ellc_ir_insn *insn = ellc_ir_add(fun, ELLC_IR_ENV_SET, NULL);
+    insn->param = p;
+    ellc_ir_add_arg(insn, val);
+    return ellc_param_boxed(p) ? ellc_ir_c("ell_unspecified") : val;
+}
+
+/* Lowers an application of an open-coded primitive on objects. */
+static struct ellc_ir_opnd *
+ellc_lower_open_coded_app(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast_app *app,
+                          enum ellc_type type, char *prim, bool pure)
+{
+    struct ellc_ast *a = (struct ellc_ast *) lnode_get(list_first(&app->args->pos));
+    struct ellc_ast *b = (struct ellc_ast *) lnode_get(list_last(&app->args->pos));
+    struct ellc_ir_opnd *a_val = ellc_lower_ast(st, fun, a);
+    struct ellc_ir_opnd *b_val = ellc_lower_ast(st, fun, b);
+    return ellc_ir_prim(fun, type, prim, pure, 2, a_val, b_val);
+}
+
+/* Lowers a slot access with a quoted slot name, see `ellc_is_slot_app'. */
+static struct ellc_ir_opnd *
+ellc_lower_slot_app(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast_app *app)
+{
+    char *cache = (char *) ell_alloc(32);
+    snprintf(cache, 32, "__ell_slot_cache_%u", st->nslot_caches++);
+    lnode_t *n = list_first(&app->args->pos);
+    struct ellc_ir_opnd *obj = ellc_lower_ast(st, fun, (struct ellc_ast *) lnode_get(n));
+    n = list_next(&app->args->pos, n);
+    struct ellc_ir_opnd *sym = ellc_ir_const(((struct ellc_ast *) lnode_get(n))->lit_sym.sym);
+    n = list_next(&app->args->pos, n);
+    if (!n)
+        return ellc_ir_prim(fun, ELLC_TYPE_OBJ, "ELL_GEN_SLOT_VALUE", 0, 3,
+                            ellc_ir_c(cache), obj, sym);
+    struct ellc_ir_opnd *val = ellc_lower_ast(st, fun, (struct ellc_ast *) lnode_get(n));
+    return ellc_ir_prim(fun, ELLC_TYPE_OBJ, "ELL_GEN_SET_SLOT_VALUE", 0, 4,
+                        ellc_ir_c(cache), obj, sym, val);
+}
+
+/* Lowers a MAKE with keyword arguments, see `ellc_is_make_app'.  The
+   slot names and values are passed as alternating arguments. */
+static struct ellc_ir_opnd *
+ellc_lower_make_app(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast_app *app)
+{
+    char *cache = (char *) ell_alloc(32);
+    snprintf(cache, 32, "&__ell_make_cache_%u", (unsigned) list_count(st->make_caches));
+    dictcount_t nslots = dict_count(&app->args->key);
+    ell_util_list_add(st->make_caches, (void *) (uintptr_t) nslots);
+    struct ellc_ir_opnd *class =
+        ellc_lower_ast(st, fun, (struct ellc_ast *) lnode_get(list_first(&app->args->pos)));
+    list_t *vals = ell_util_make_list();
+    for (dnode_t *n = dict_first(&app->args->key); n; n = dict_next(&app->args->key, n))
+        ell_util_list_add(vals, ellc_lower_ast(st, fun, (struct ellc_ast *) dnode_get(n)));
+    struct ellc_ir_insn *insn = ellc_ir_add(fun, ELLC_IR_PRIM, ellc_ir_tmp(fun, ELLC_TYPE_OBJ));
+    insn->prim.name = "ell_make_with_slots";
+    insn->prim.pure = 0;
+    ellc_ir_add_arg(insn, ellc_ir_c(cache));
+    ellc_ir_add_arg(insn, class);
+    ellc_ir_add_arg(insn, ellc_ir_c_int(nslots));
+    lnode_t *vn = list_first(vals);
+    for (dnode_t *n = dict_first(&app->args->key); n; n = dict_next(&app->args->key, n)) {
+        ellc_ir_add_arg(insn, ellc_ir_const((struct ell_obj *) dnode_getkey(n)));
+        ellc_ir_add_arg(insn, (struct ellc_ir_opnd *) lnode_get(vn));
+        vn = list_next(vals, vn);
+    }
+    return insn->dst;
+}
+
+/* Lowers a VALUES, see `ellc_is_values_app'. */
+static struct ellc_ir_opnd *
+ellc_lower_values_app(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast_app *app)
+{
+    list_t *vals = ell_util_make_list();
+    for (lnode_t *n = list_first(&app->args->pos); n; n = list_next(&app->args->pos, n))
+        ell_util_list_add(vals, ellc_lower_ast(st, fun, (struct ellc_ast *) lnode_get(n)));
+    struct ellc_ir_insn *insn = ellc_ir_add(fun, ELLC_IR_PRIM, ellc_ir_tmp(fun, ELLC_TYPE_OBJ));
+    insn->prim.name = "ELL_GEN_VALUES";
+    insn->prim.pure = 0;
+    ellc_ir_add_arg(insn, ellc_ir_c_int(list_count(vals)));
+    for (lnode_t *n = list_first(vals); n; n = list_next(vals, n))
+        ellc_ir_add_arg(insn, (struct ellc_ir_opnd *) lnode_get(n));
+    return insn->dst;
+}
+
+/* Lowers a MULTIPLE-VALUE-REF, see `ellc_is_multiple_value_ref_app'. */
+static struct ellc_ir_opnd *
+ellc_lower_multiple_value_ref_app(struct ellc_st *st, struct ellc_ir_fun *fun,
+                                  struct ellc_ast_app *app)
+{
+    struct ellc_ast *primary = (struct ellc_ast *) lnode_get(list_first(&app->args->pos));
+    struct ellc_ast *index = (struct ellc_ast *) lnode_get(list_last(&app->args->pos));
+    return ellc_ir_prim(fun, ELLC_TYPE_OBJ, "ELL_GEN_MULTIPLE_VALUE_REF", 0, 2,
+                        ellc_lower_ast(st, fun, primary),
+                        ellc_ir_c_int(ell_num_int(index->lit_num.num)));
+}
+
+/* Lowers an application of an open-coded primitive on unboxed
+   integers. */
+static struct ellc_ir_opnd *
+ellc_lower_int_prim_app(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast_app *app,
+                        enum ellc_type type, char *prim, bool pure)
+{
+    struct ellc_ast *a = (struct ellc_ast *) lnode_get(list_first(&app->args->pos));
+    struct ellc_ast *b = (struct ellc_ast *) lnode_get(list_last(&app->args->pos));
+    struct ellc_ir_opnd *a_val = ellc_lower_typed(st, fun, a, ELLC_TYPE_FIXNUM);
+    struct ellc_ir_opnd *b_val = ellc_lower_typed(st, fun, b, ELLC_TYPE_FIXNUM);
+    return ellc_ir_prim(fun, type, prim, pure, 2, a_val, b_val);
+}
+
+/* Returns the parameter that's known to be a fixnum in the consequent
+   of a conditional with the given test, or NULL. */
+static struct ellc_param *
+ellc_narrowed_param(struct ellc_st *st, struct ellc_ast *test)
+{
+    if ((test->type != ELLC_AST_APP)
+        || !ellc_is_prim_app(st, &test->app, ELL_SYM(prim_typeq), 2))
+        return NULL;
+    struct ellc_ast *obj = (struct ellc_ast *) lnode_get(list_first(&test->app.args->pos));
+    struct ellc_ast *class = (struct ellc_ast *) lnode_get(list_last(&test->app.args->pos));
+    if ((obj->type != ELLC_AST_ARG_REF)
+        || obj->arg_ref.param->mutable
+        || (obj->arg_ref.param->type != ELLC_TYPE_OBJ)
+        || (class->type != ELLC_AST_GLO_REF)
+        || (class->glo_ref.id->sym != ELL_SYM(prim_integer_class))
+        || (class->glo_ref.id->ns != ELLC_NS_VAR)
+        || ellc_defined_at_toplevel(st, class->glo_ref.id))
+        return NULL;
+    return obj->arg_ref.param;
+}
+
+static struct ellc_ir_opnd *
+ellc_lower_test(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast);
+
+static struct ellc_ir_opnd *
+ellc_lower_ccall(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast);
+
+/* Lowers a conditional, with the branches lowered as the given type,
+   and assigned to the result temporary.  ELLC_TYPE_NONE means the
+   value is not used.  Inside the consequent of a (TYPE? X <INTEGER>)
+   test, X is treated as a fixnum. */
+static struct ellc_ir_opnd *
+ellc_lower_typed_cond(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast,
+                      enum ellc_type type)
+{
+    struct ellc_param *narrowed = ellc_narrowed_param(st, ast->cond.test);
+    struct ellc_ir_opnd *test = ellc_lower_test(st, fun, ast->cond.test);
+    struct ellc_ir_opnd *res = (type == ELLC_TYPE_NONE) ? NULL : ellc_ir_tmp(fun, type);
+    struct ellc_ir_block *then_block = ellc_ir_make_block(fun);
+    struct ellc_ir_block *else_block = ellc_ir_make_block(fun);
+    struct ellc_ir_block *join_block = ellc_ir_make_block(fun);
+    ellc_ir_branch(fun, test, then_block, else_block);
+
+    ellc_ir_start(fun, then_block);
+    if (narrowed) narrowed->narrowed = ELLC_TYPE_FIXNUM;
+    struct ellc_ir_opnd *val = ellc_lower_typed(st, fun, ast->cond.consequent, type);
+    if (narrowed) narrowed->narrowed = ELLC_TYPE_OBJ;
+    if (res) ellc_ir_move(fun, res, val);
+    ellc_ir_jump(fun, join_block);
+
+    ellc_ir_start(fun, else_block);
+    val = ellc_lower_typed(st, fun, ast->cond.alternative, type);
+    if (res) ellc_ir_move(fun, res, val);
+    ellc_ir_jump(fun, join_block);
+
+    ellc_ir_start(fun, join_block);
+    return res;
+}
+
+/* Lowers a comparison.  If only one operand is a fixnum, the other
+   one is unboxed when it's an integer, instead of boxing the fixnum. */
+static struct ellc_ir_opnd *
+ellc_lower_lt_test(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast_app *app)
+{
+    struct ellc_ast *a = (struct ellc_ast *) lnode_get(list_first(&app->args->pos));
+    struct ellc_ast *b = (struct ellc_ast *) lnode_get(list_last(&app->args->pos));
+    bool a_int = (ellc_ast_type(st, a) == ELLC_TYPE_FIXNUM);
+    bool b_int = (ellc_ast_type(st, b) == ELLC_TYPE_FIXNUM);
+    if (a_int && b_int)
+        return ellc_lower_int_prim_app(st, fun, app, ELLC_TYPE_BOOL, "ELL_GEN_LT_INT", 1);
+    else if (!a_int && !b_int)
+        return ellc_lower_open_coded_app(st, fun, app, ELLC_TYPE_BOOL, "ELL_GEN_LT_TEST", 0);
+    struct ellc_ir_opnd *a_val = ellc_lower_typed(st, fun, a, a_int ? ELLC_TYPE_FIXNUM : ELLC_TYPE_OBJ);
+    struct ellc_ir_opnd *b_val = ellc_lower_typed(st, fun, b, b_int ? ELLC_TYPE_FIXNUM : ELLC_TYPE_OBJ);
+    return ellc_ir_prim(fun, ELLC_TYPE_BOOL, a_int ? "ELL_GEN_LT_INT_OBJ" : "ELL_GEN_LT_OBJ_INT",
+                        0, 2, a_val, b_val);
+}
+
+/* Lowers an expression in test position to a C condition, so that
+   predicates don't need to produce boolean objects only to have them
+   tested right away. */
+static struct ellc_ir_opnd *
+ellc_lower_test(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast)
+{
+    int lit_bool = ellc_lit_bool(st, ast);
+    if (lit_bool != -1) {
+        return ellc_ir_c_int(lit_bool);
+    } else if ((ast->type == ELLC_AST_ARG_REF) && (ast->arg_ref.param->type == ELLC_TYPE_BOOL)) {
+        return ellc_lower_var_ref(fun, ast->arg_ref.param);
+    } else if ((ast->type == ELLC_AST_APP)
+               && ellc_is_prim_app(st, &ast->app, ELL_SYM(prim_lt), 2)) {
+        return ellc_lower_lt_test(st, fun, &ast->app);
+    } else if ((ast->type == ELLC_AST_APP)
+               && ellc_is_prim_app(st, &ast->app, ELL_SYM(prim_typeq), 2)) {
+        return ellc_lower_open_coded_app(st, fun, &ast->app, ELLC_TYPE_BOOL, "ELL_GEN_TYPEQ_TEST", 1);
+    } else if ((ast->type == ELLC_AST_CCALL) && (ellc_ast_type(st, ast) == ELLC_TYPE_BOOL)) {
+        return ellc_lower_ccall(st, fun, ast);
+    } else if (ast->type == ELLC_AST_DEFP) {
+        return ellc_ir_prim(fun, ELLC_TYPE_BOOL, "ELL_GEN_DEFP_TEST", 1, 1,
+                            ellc_ir_c(ellc_mangle_glo_id(ast->defp.id)));
+    } else if (ast->type == ELLC_AST_COND) {
+        // Covers NOT, which expands to (if x #f #t)
+        return ellc_lower_typed_cond(st, fun, ast, ELLC_TYPE_BOOL);
+    } else if (ellc_is_inlined_app(ast) || (ast->type == ELLC_AST_SEQ)) {
+        return ellc_lower_typed(st, fun, ast, ELLC_TYPE_BOOL);
+    } else {
+        return ellc_ir_prim(fun, ELLC_TYPE_BOOL, "ELL_GEN_TRUE", 1, 1,
+                            ellc_lower_ast(st, fun, ast));
+    }
+}
+
+/* Unboxes an integer object, without a type check at safety 0. */
+static struct ellc_ir_opnd *
+ellc_lower_unbox_int(struct ellc_ir_fun *fun, struct ellc_ir_opnd *val)
+{
+    if (fun->safety == 0)
+        return ellc_ir_prim(fun, ELLC_TYPE_FIXNUM, "ELL_GEN_NUM_INT", 1, 1, val);
+    return ellc_ir_prim(fun, ELLC_TYPE_FIXNUM, "ell_num_int", 0, 1, val);
+}
+
+/* Lowers an expression whose static type is fixnum to a C int. */
+static struct ellc_ir_opnd *
+ellc_lower_int(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast)
+{
+    if (ast->type == ELLC_AST_LIT_NUM) {
+        return ellc_ir_c_int(ell_num_int(ast->lit_num.num));
+    } else if ((ast->type == ELLC_AST_ARG_REF) && (ast->arg_ref.param->type == ELLC_TYPE_FIXNUM)) {
+        return ellc_lower_var_ref(fun, ast->arg_ref.param);
+    } else if ((ast->type == ELLC_AST_ARG_REF) && (ast->arg_ref.param->narrowed == ELLC_TYPE_FIXNUM)) {
+        return ellc_ir_prim(fun, ELLC_TYPE_FIXNUM, "ELL_GEN_NUM_INT", 1, 1,
+                            ellc_lower_var_ref(fun, ast->arg_ref.param));
+    } else if ((ast->type == ELLC_AST_APP) && ellc_is_prim_arith_app(st, &ast->app)
+               && (ellc_args_type(st, &ast->app) == ELLC_TYPE_FIXNUM)) {
+        return ellc_lower_int_prim_app(st, fun, &ast->app, ELLC_TYPE_FIXNUM,
+                                       ellc_int_arith_prim(st, &ast->app), 0);
+    } else if (ast->type == ELLC_AST_COND) {
+        return ellc_lower_typed_cond(st, fun, ast, ELLC_TYPE_FIXNUM);
+    } else if (ellc_is_inlined_app(ast) || (ast->type == ELLC_AST_SEQ)) {
+        return ellc_lower_typed(st, fun, ast, ELLC_TYPE_FIXNUM);
+    } else if ((ast->type == ELLC_AST_CCALL) && (ellc_ast_type(st, ast) == ELLC_TYPE_FIXNUM)) {
+        return ellc_lower_ccall(st, fun, ast);
+    } else if ((ast->type == ELLC_AST_THE)
+               && (ellc_ast_type(st, ast->the.expr) == ELLC_TYPE_FIXNUM)) {
+        return ellc_lower_int(st, fun, ast->the.expr);
+    } else if (ast->type == ELLC_AST_THE) {
+        return ellc_lower_unbox_int(fun, ellc_lower_ast(st, fun, ast->the.expr));
+    } else {
+        return ellc_lower_unbox_int(fun, ellc_lower_ast(st, fun, ast));
+    }
+}
+
+/* Lowers an expression whose value is not used. */
+static void
+ellc_lower_effect(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast)
+{
+    if ((ast->type == ELLC_AST_ARG_SET) && (ast->arg_set.param->type != ELLC_TYPE_OBJ)) {
+        struct ellc_param *p = ast->arg_set.param;
+        ellc_lower_var_set(fun, p, ellc_lower_typed(st, fun, ast->arg_set.val, p->type));
+    } else if (ast->type == ELLC_AST_COND) {
+        ellc_lower_typed_cond(st, fun, ast, ELLC_TYPE_NONE);
+    } else if (ellc_is_inlined_app(ast) || (ast->type == ELLC_AST_SEQ)) {
+        ellc_lower_typed(st, fun, ast, ELLC_TYPE_NONE);
+    } else {
+        ellc_lower_ast(st, fun, ast);
+    }
+}
+
+static struct ellc_ir_opnd *
+ellc_lower_typed_seq(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast,
+                     enum ellc_type type)
+{
+    if (list_isempty(ast->seq.exprs))
+        return (type == ELLC_TYPE_NONE) ? NULL : ellc_ir_c("ell_unspecified");
+    struct ellc_ir_opnd *res = NULL;
+    for (lnode_t *n = list_first(ast->seq.exprs); n; n = list_next(ast->seq.exprs, n)) {
+        struct ellc_ast *expr = (struct ellc_ast *) lnode_get(n);
+        if (list_next(ast->seq.exprs, n))
+            ellc_lower_effect(st, fun, expr);
+        else
+            res = ellc_lower_typed(st, fun, expr, type);
+    }
+    return res;
+}
+
+/* Instead of a closure, a lifted lambda's free variables are saved
+   in C locals where the lambda appears, to be passed to the lifted
+   function by direct calls. */
+static void
+ellc_lower_lift_env(struct ellc_ir_fun *fun, struct ellc_ast_lam *lam)
+{
+    ellc_ir_add(fun, ELLC_IR_LIFT_ENV, NULL)->lam = lam;
+    ell_util_set_add(fun->lifted, lam, (dict_comp_t) &ell_ptr_cmp);
+}
+
+static struct ellc_ir_opnd *
+ellc_lower_lifted_app(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast_app *app,
+                      struct ellc_ast_lam *lam)
+{
+    list_t *args = ell_util_make_list();
+    for (lnode_t *n = list_first(&app->args->pos); n; n = list_next(&app->args->pos, n))
+        ell_util_list_add(args, ellc_lower_ast(st, fun, (struct ellc_ast *) lnode_get(n)));
+    struct ellc_ir_insn *insn = ellc_ir_add(fun, ELLC_IR_LIFTED_CALL, ellc_ir_tmp(fun, ELLC_TYPE_OBJ));
+    insn->lam = lam;
+    insn->args = args;
+    return insn->dst;
+}
+
+/* Lowers the application of an inlined lambda.  The arguments are
+   evaluated first, then the parameters are bound to them as C
+   locals, which are unboxed if they have a type. */
+static struct ellc_ir_opnd *
+ellc_lower_inlined_app(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast,
+                       enum ellc_type type)
+{
+    struct ellc_ast_app *app = &ast->app;
+    struct ellc_ast_lam *lam = &app->op->lam;
+    list_t *vals = ell_util_make_list();
+    lnode_t *an = list_first(&app->args->pos);
+    for (lnode_t *pn = list_first(lam->params->req); pn; pn = list_next(lam->params->req, pn)) {
+        struct ellc_param *p = (struct ellc_param *) lnode_get(pn);
+        if (p->lam && p->lam->lifted) {
+            ellc_lower_lift_env(fun, p->lam);
+            ell_util_list_add(vals, NULL);
+        } else {
+            ell_util_list_add(vals, ellc_lower_typed(st, fun, (struct ellc_ast *) lnode_get(an),
+                                                     p->type));
+        }
+        an = list_next(&app->args->pos, an);
+    }
+    lnode_t *vn = list_first(vals);
+    for (lnode_t *pn = list_first(lam->params->req); pn; pn = list_next(lam->params->req, pn)) {
+        struct ellc_param *p = (struct ellc_param *) lnode_get(pn);
+        if (!(p->lam && p->lam->lifted))
+            ellc_lower_var_init(fun, p, (struct ellc_ir_opnd *) lnode_get(vn));
+        vn = list_next(vals, vn);
+    }
+    int safety = fun->safety;
+    fun->safety = lam->safety;
+    struct ellc_ir_opnd *res = ellc_lower_typed(st, fun, lam->body, type);
+    fun->safety = safety;
+    return res;
+}
+
+/* Returns the link of a global function that's called directly,
+   or NULL.  The last definition of a function at the top-level of the
+   current unit shadows exports of previously compiled units. */
+static struct ellc_link *
+ellc_lower_link(struct ellc_st *st, struct ellc_ast *op)
+{
+    if ((op->type != ELLC_AST_GLO_REF) || (op->glo_ref.id->ns != ELLC_NS_FUN)) return NULL;
+    struct ellc_id *id = op->glo_ref.id;
+    struct ellc_link *link = NULL;
+    if (ellc_defined_at_toplevel(st, id)) {
+        list_t *links = st->exported_links;
+        for (lnode_t *n = list_first(links); n; n = list_next(links, n))
+            if (ellc_id_cmp(((struct ellc_link *) lnode_get(n))->id, id) == 0)
+                link = (struct ellc_link *) lnode_get(n);
+    } else if (!id->cx) {
+        dnode_t *dn = dict_lookup(&ellc_link_tab, id->sym);
+        if (dn)
+            link = (struct ellc_link *) dnode_get(dn);
+    }
+    if (link)
+        ell_util_set_add(st->linked, link, (dict_comp_t) &ell_ptr_cmp);
+    return link;
+}
+
+static struct ellc_ir_opnd *
+ellc_lower_app(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast)
+{
+    struct ellc_ast_app *app = &ast->app;
+    if (ellc_is_inlined_app(ast))
+        return ellc_lower_inlined_app(st, fun, ast, ELLC_TYPE_OBJ);
+    struct ellc_param *lifted = ellc_lifted_app_param(app);
+    if (lifted)
+        return ellc_lower_lifted_app(st, fun, app, lifted->lam);
+    if (ellc_is_prim_arith_app(st, app) && (ellc_app_type(st, ast) == ELLC_TYPE_FIXNUM))
+        return ellc_lower_to_obj(fun, ellc_lower_int(st, fun, ast), ELLC_TYPE_FIXNUM);
+    if (ellc_is_prim_app(st, app, ELL_SYM(prim_lt), 2)
+        && (ellc_args_type(st, app) == ELLC_TYPE_FIXNUM))
+        return ellc_lower_to_obj(fun, ellc_lower_int_prim_app(st, fun, app, ELLC_TYPE_BOOL,
+                                                              "ELL_GEN_LT_INT", 1),
+                                 ELLC_TYPE_BOOL);
+    if (ellc_is_slot_app(st, app))
+        return ellc_lower_slot_app(st, fun, app);
+    if (ellc_is_make_app(st, app))
+        return ellc_lower_make_app(st, fun, app);
+    if (ellc_is_values_app(st, app))
+        return ellc_lower_values_app(st, fun, app);
+    if (ellc_is_multiple_value_ref_app(st, app))
+        return ellc_lower_multiple_value_ref_app(st, fun, app);
+    char *prim = ellc_open_coded_prim(st, app);
+    if (prim)
+        return ellc_lower_open_coded_app(st, fun, app, ELLC_TYPE_OBJ, prim, 0);
+    list_t *args = ell_util_make_list();
+    list_t *keys = ell_util_make_list();
+    for (lnode_t *n = list_first(&app->args->pos); n; n = list_next(&app->args->pos, n))
+        ell_util_list_add(args, ellc_lower_ast(st, fun, (struct ellc_ast *) lnode_get(n)));
+    for (dnode_t *n = dict_first(&app->args->key); n; n = dict_next(&app->args->key, n)) {
+        ell_util_list_add(keys, (void *) dnode_getkey(n));
+        ell_util_list_add(args, ellc_lower_ast(st, fun, (struct ellc_ast *) dnode_get(n)));
+    }
+    struct ellc_ir_opnd *op = ellc_lower_ast(st, fun, app->op);
+    struct ellc_ir_insn *insn = ellc_ir_add(fun, ELLC_IR_CALL, ellc_ir_tmp(fun, ELLC_TYPE_OBJ));
+    ellc_ir_add_arg(insn, op);
+    for (lnode_t *n = list_first(args); n; n = list_next(args, n))
+        ellc_ir_add_arg(insn, (struct ellc_ir_opnd *) lnode_get(n));
+    insn->call.keys = keys;
+    insn->call.link = ellc_lower_link(st, app->op);
+    insn->call.unchecked = (fun->safety == 0);
+    return insn->dst;
+}
+
+/* Lambdas with an environment need storage for it, declared at the
+   top of the function. */
+static struct ellc_ir_opnd *
+ellc_lower_lam(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast)
+{
+    struct ellc_ast_lam *lam = &ast->lam;
+    struct ellc_ir_insn *insn = ellc_ir_add(fun, ELLC_IR_CLO, ellc_ir_tmp(fun, ELLC_TYPE_OBJ));
+    insn->lam = lam;
+    if (dict_count(lam->env) > 0)
+        ell_util_set_add(fun->clos, lam, (dict_comp_t) &ell_ptr_cmp);
+    return insn->dst;
+}
+
+static void
+ellc_lower_loop_iteration(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast,
+                          struct ellc_ir_block *exit_block)
+{
+    if (ast->loop.test) {
+        struct ellc_ir_opnd *test = ellc_lower_test(st, fun, ast->loop.test);
+        struct ellc_ir_block *body_block = ellc_ir_make_block(fun);
+        ellc_ir_branch(fun, test, body_block, exit_block);
+        ellc_ir_start(fun, body_block);
+    }
+    ellc_lower_effect(st, fun, ast->loop.body);
+}
+
+/* A loop with hoisted unbound checks has its first iteration lowered
+   separately (see `ellc_ast_loop'). */
+static struct ellc_ir_opnd *
+ellc_lower_loop(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast)
+{
+    struct ellc_ir_block *head_block = ellc_ir_make_block(fun);
+    struct ellc_ir_block *exit_block = ellc_ir_make_block(fun);
+    listcount_t mark = list_count(st->hoisted_globals);
+    if (ast->loop.hoisted) {
+        ellc_lower_loop_iteration(st, fun, ast, exit_block);
+        for (lnode_t *n = list_first(ast->loop.hoisted); n; n = list_next(ast->loop.hoisted, n))
+            ell_util_list_add(st->hoisted_globals, lnode_get(n));
+    }
+    ellc_ir_jump(fun, head_block);
+    ellc_ir_start(fun, head_block);
+    ellc_lower_loop_iteration(st, fun, ast, exit_block);
+    ellc_ir_jump(fun, head_block);
+    while (list_count(st->hoisted_globals) > mark)
+        list_del_last(st->hoisted_globals);
+    ellc_ir_start(fun, exit_block);
+    return ellc_ir_c("ell_unspecified");
+}
+
+static struct ellc_ir_opnd *
+ellc_lower_dlet(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast)
+{
+    struct ellc_ir_opnd *val = ellc_lower_ast(st, fun, ast->dlet.val);
+    unsigned index = fun->ndlets++;
+    struct ellc_ir_insn *bind = ellc_ir_add(fun, ELLC_IR_DLET_BIND, NULL);
+    bind->dlet.id = ast->dlet.id;
+    bind->dlet.index = index;
+    ellc_ir_add_arg(bind, val);
+    struct ellc_ir_opnd *res = ellc_lower_ast(st, fun, ast->dlet.body);
+    struct ellc_ir_insn *unbind = ellc_ir_add(fun, ELLC_IR_DLET_UNBIND, NULL);
+    unbind->dlet.id = ast->dlet.id;
+    unbind->dlet.index = index;
+    return res;
+}
+
+/* Returns the C expression for the current hygiene context. */
+static struct ellc_ir_opnd *
+ellc_lower_cur_cx(struct ellc_ir_fun *fun)
+{
+    if (fun->cx == -1)
+        return ellc_ir_c("__ell_cur_cx");
+    char *c = (char *) ell_alloc(32);
+    snprintf(c, 32, "__ell_cx_%d", fun->cx);
+    return ellc_ir_c(c);
+}
+
+static struct ellc_ir_opnd *
+ellc_lower_lit_stx(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast)
+{
+    struct ell_obj *stx = ast->lit_stx.stx;
+    if (stx->wrapper == ELL_WRAPPER(stx_sym))
+        return ellc_ir_prim(fun, ELLC_TYPE_OBJ, "ell_make_stx_sym_cx", 1, 2,
+                            ellc_ir_const(ell_stx_sym_sym(stx)), ellc_lower_cur_cx(fun));
+    else if (stx->wrapper == ELL_WRAPPER(stx_str))
+        return ellc_ir_prim(fun, ELLC_TYPE_OBJ, "ell_make_stx_str", 1, 1,
+                            ellc_ir_const(ell_stx_str_str(stx)));
+    else if (stx->wrapper == ELL_WRAPPER(stx_num))
+        return ellc_ir_prim(fun, ELLC_TYPE_OBJ, "ell_make_stx_num", 1, 1,
+                            ellc_ir_const(ell_stx_num_num(stx)));
+    else
+        ell_fail("literal syntax error\n");
+}
+
+/* Instead of the global current hygiene context, which is always
+   NULL, syntax objects statically enclosed in this form pick up a new
+   context, that's held in a C local.  Inside a lambda, the enclosing
+   context is not visible, so a quasisyntax in the lambda's body gets
+   a new context, too. */
+static struct ellc_ir_opnd *
+ellc_lower_cx(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast)
+{
+    if (fun->cx != -1)
+        return ellc_lower_ast(st, fun, ast->cx.body);
+    struct ellc_ir_insn *insn = ellc_ir_add(fun, ELLC_IR_MAKE_CX, NULL);
+    insn->cx = fun->ncxs++;
+    fun->cx = insn->cx;
+    struct ellc_ir_opnd *res = ellc_lower_ast(st, fun, ast->cx.body);
+    fun->cx = -1;
+    return res;
+}
+
+/* The literal strings at the top-level of a snippet's body are
+   pasted as-is into the C output, the other expressions are lowered
+   to temporaries. */
+static struct ellc_ir_opnd *
+ellc_lower_snip(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast)
+{
+    struct ellc_ast *body_seq = ast->snip.body;
+    if (body_seq->type != ELLC_AST_SEQ)
+        ell_fail("C output error\n");
+    list_t *pieces = ell_util_make_list();
+    list_t *exprs = body_seq->seq.exprs;
+    for (lnode_t *n = list_first(exprs); n; n = list_next(exprs, n)) {
+        struct ellc_ast *expr = (struct ellc_ast *) lnode_get(n);
+        if (expr->type == ELLC_AST_LIT_STR)
+            ell_util_list_add(pieces, ellc_ir_c(ell_str_chars(expr->lit_str.str)));
+        else
+            ell_util_list_add(pieces, ellc_lower_ast(st, fun, expr));
+    }
+    struct ellc_ir_insn *insn = ellc_ir_add(fun, ELLC_IR_SNIP, ellc_ir_tmp(fun, ELLC_TYPE_OBJ));
+    insn->args = pieces;
+    return insn->dst;
+}
+
+/* A call of a C function is lowered to a snippet, with the arguments
+   converted to C in line: integers and booleans are unboxed like the
+   operands of open-coded arithmetic and tests, and strings yield their
+   characters.  The result is a C value of the type returned by
+   `ellc_ast_type', or an object.  A string result of NULL becomes #f. */
+static struct ellc_ir_opnd *
+ellc_lower_ccall(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast)
+{
+    struct ellc_ast_ccall *ccall = &ast->ccall;
+    bool declared = 0;
+    for (lnode_t *n = list_first(st->c_calls); n; n = list_next(st->c_calls, n))
+        if (!strcmp(ell_str_chars(((struct ellc_ast *) lnode_get(n))->ccall.name),
+                    ell_str_chars(ccall->name)))
+            declared = 1;
+    if (!declared)
+        ell_util_list_add(st->c_calls, ast);
+    list_t *pieces = ell_util_make_list();
+    struct ell_obj *result_type = ccall->result_type;
+    if (result_type == ELL_SYM(ctype_string))
+        ell_util_list_add(pieces, ellc_ir_c("ELL_GEN_C_STR("));
+    else if (result_type == ELL_SYM(ctype_unspecified))
+        ell_util_list_add(pieces, ellc_ir_c("("));
+    ell_util_list_add(pieces, ellc_ir_c(ell_str_chars(ccall->name)));
+    ell_util_list_add(pieces, ellc_ir_c("("));
+    lnode_t *tn = list_first(ccall->param_types);
+    for (lnode_t *n = list_first(ccall->args); n; n = list_next(ccall->args, n)) {
+        struct ell_obj *type = (struct ell_obj *) lnode_get(tn);
+        struct ellc_ast *arg = (struct ellc_ast *) lnode_get(n);
+        if (n != list_first(ccall->args))
+            ell_util_list_add(pieces, ellc_ir_c(", "));
+        if (type == ELL_SYM(prim_integer_class)) {
+            ell_util_list_add(pieces, ellc_lower_int(st, fun, arg));
+        } else if (type == ELL_SYM(ctype_boolean)) {
+            ell_util_list_add(pieces, ellc_lower_test(st, fun, arg));
+        } else if (type == ELL_SYM(ctype_string)) {
+            ell_util_list_add(pieces, ellc_ir_c(fun->safety == 0 ? "ELL_GEN_STR_CHARS("
+                                                                 : "ell_str_chars("));
+            ell_util_list_add(pieces, ellc_lower_ast(st, fun, arg));
+            ell_util_list_add(pieces, ellc_ir_c(")"));
+        } else {
+            ell_util_list_add(pieces, ellc_lower_ast(st, fun, arg));
+        }
+        tn = list_next(ccall->param_types, tn);
+    }
+    ell_util_list_add(pieces, ellc_ir_c(")"));
+    if (result_type == ELL_SYM(ctype_string))
+        ell_util_list_add(pieces, ellc_ir_c(")"));
+    else if (result_type == ELL_SYM(ctype_unspecified))
+        ell_util_list_add(pieces, ellc_ir_c(", ell_unspecified)"));
+    struct ellc_ir_insn *insn = ellc_ir_add(fun, ELLC_IR_SNIP,
+                                            ellc_ir_tmp(fun, ellc_ast_type(st, ast)));
+    insn->args = pieces;
+    return insn->dst;
+}
+
+/* Used as an object, a declared integer is only checked, unless it
+   is already known to be one. */
+static struct ellc_ir_opnd *
+ellc_lower_the(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast)
+{
+    if (ellc_ast_type(st, ast->the.expr) == ELLC_TYPE_FIXNUM)
+        return ellc_lower_to_obj(fun, ellc_lower_int(st, fun, ast->the.expr), ELLC_TYPE_FIXNUM);
+    struct ellc_ir_opnd *val = ellc_lower_ast(st, fun, ast->the.expr);
+    if (fun->safety == 0)
+        return val;
+    return ellc_ir_prim(fun, ELLC_TYPE_OBJ, "ELL_GEN_THE_INT", 0, 1, val);
+}
+
+static struct ellc_ir_opnd *
+ellc_lower_ltv(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast)
+{
+    char *var = (char *) ell_alloc(32);
+    snprintf(var, 32, "__ell_ltv_%u", ast->ltv.index);
+    if (!ast->ltv.init)
+        return ellc_ir_c(var);
+    return ellc_ir_prim(fun, ELLC_TYPE_OBJ, "ELL_GEN_DEF", 0, 2,
+                        ellc_ir_c(var), ellc_lower_ast(st, fun, ast->ltv.init));
+}
+
+static struct ellc_ir_opnd *
+ellc_lower_ast(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast)
+{
+    switch(ast->type) {
+    case ELLC_AST_GLO_REF: return ellc_lower_glo_ref(st, fun, ast);
+    case ELLC_AST_ARG_REF: return ellc_lower_arg_ref(st, fun, ast);
+    case ELLC_AST_ENV_REF: return ellc_lower_env_ref(st, fun, ast);
+    case ELLC_AST_DEF: return ellc_lower_def(st, fun, ast);
+    case ELLC_AST_DEFP: return ellc_lower_defp(st, fun, ast);
+    case ELLC_AST_GLO_SET: return ellc_lower_glo_set(st, fun, ast);
+    case ELLC_AST_ARG_SET: return ellc_lower_arg_set(st, fun, ast);
+    case ELLC_AST_ENV_SET: return ellc_lower_env_set(st, fun, ast);
+    case ELLC_AST_COND: return ellc_lower_typed_cond(st, fun, ast, ELLC_TYPE_OBJ);
+    case ELLC_AST_SEQ: return ellc_lower_typed_seq(st, fun, ast, ELLC_TYPE_OBJ);
+    case ELLC_AST_APP: return ellc_lower_app(st, fun, ast);
+    case ELLC_AST_LAM: return ellc_lower_lam(st, fun, ast);
+    case ELLC_AST_LOOP: return ellc_lower_loop(st, fun, ast);
+    case ELLC_AST_DLET: return ellc_lower_dlet(st, fun, ast);
+    case ELLC_AST_CX: return ellc_lower_cx(st, fun, ast);
+    case ELLC_AST_THE: return ellc_lower_the(st, fun, ast);
+    case ELLC_AST_LTV: return ellc_lower_ltv(st, fun, ast);
+    case ELLC_AST_CCALL:
+        return ellc_lower_to_obj(fun, ellc_lower_ccall(st, fun, ast), ellc_ast_type(st, ast));
+    case ELLC_AST_SNIP: return ellc_lower_snip(st, fun, ast);
+    // Statements get emitted before everything else
+    case ELLC_AST_STMT: return ellc_ir_c("ell_unspecified");
+    case ELLC_AST_LIT_SYM: return ellc_ir_const(ast->lit_sym.sym);
+    case ELLC_AST_LIT_STR: return ellc_ir_const(ast->lit_str.str);
+    case ELLC_AST_LIT_NUM: return ellc_ir_const(ast->lit_num.num);
+    case ELLC_AST_LIT_STX: return ellc_lower_lit_stx(st, fun, ast);
+    default:
+        ell_fail("lowering error\n");
+    }
+}
+
+static struct ellc_ir_opnd *
+ellc_lower_typed(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ast,
+                 enum ellc_type type)
+{
+    if (ellc_is_inlined_app(ast))
+        return ellc_lower_inlined_app(st, fun, ast, type);
+    if (ast->type == ELLC_AST_SEQ)
+        return ellc_lower_typed_seq(st, fun, ast, type);
+    switch(type) {
+    case ELLC_TYPE_NONE: ellc_lower_effect(st, fun, ast); return NULL;
+    case ELLC_TYPE_FIXNUM: return ellc_lower_int(st, fun, ast);
+    case ELLC_TYPE_BOOL: return ellc_lower_test(st, fun, ast);
+    default: return ellc_lower_ast(st, fun, ast);
+    }
+}
+
+/* Binds an optional or keyword parameter to VAL if it was supplied,
+   and to the value of its init form otherwise. */
+static void
+ellc_lower_param_default(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_param *p,
+                         struct ellc_ir_opnd *supplied, struct ellc_ir_opnd *val)
+{
+    struct ellc_ir_opnd *res = ellc_ir_tmp(fun, ELLC_TYPE_OBJ);
+    struct ellc_ir_block *supplied_block = ellc_ir_make_block(fun);
+    struct ellc_ir_block *default_block = ellc_ir_make_block(fun);
+    struct ellc_ir_block *join_block = ellc_ir_make_block(fun);
+    ellc_ir_branch(fun, supplied, supplied_block, default_block);
+    ellc_ir_start(fun, supplied_block);
+    ellc_ir_move(fun, res, val);
+    ellc_ir_jump(fun, join_block);
+    ellc_ir_start(fun, default_block);
+    ellc_ir_move(fun, res, p->init ? ellc_lower_ast(st, fun, p->init) : ellc_ir_c("ell_unbound"));
+    ellc_ir_jump(fun, join_block);
+    ellc_ir_start(fun, join_block);
+    ellc_lower_var_init(fun, p, res);
+}
+
+/* Lowers the prologue of a closure's code, which checks the number of
+   arguments (except at safety 0), and binds the parameters.  Typed
+   required parameters are unboxed. */
+static void
+ellc_lower_params(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast_lam *lam)
+{
+    struct ellc_params *params = lam->params;
+    listcount_t nreq = list_count(params->req);
+    listcount_t nopt = list_count(params->opt);
+    if ((nreq > 0) && (lam->safety > 0))
+        ellc_ir_prim(fun, ELLC_TYPE_NONE, "ELL_GEN_CHECK_ARITY_MIN", 0, 1, ellc_ir_c_int(nreq));
+    if (!params->rest && (lam->safety > 0))
+        ellc_ir_prim(fun, ELLC_TYPE_NONE, "ELL_GEN_CHECK_ARITY_MAX", 0, 1, ellc_ir_c_int(nreq + nopt));
+
+    unsigned i = 0;
+    for (lnode_t *n = list_first(params->req); n; n = list_next(params->req, n)) {
+        struct ellc_param *p = (struct ellc_param *) lnode_get(n);
+        struct ellc_ir_opnd *val = ellc_ir_c_arg(fun, i);
+        ellc_lower_var_init(fun, p, (p->type == ELLC_TYPE_FIXNUM) ? ellc_lower_unbox_int(fun, val) : val);
+        i++;
+    }
+    for (lnode_t *n = list_first(params->opt); n; n = list_next(params->opt, n)) {
+        struct ellc_ir_opnd *supplied =
+            ellc_ir_prim(fun, ELLC_TYPE_BOOL, "ELL_GEN_ARG_SUPPLIED", 1, 1, ellc_ir_c_int(i));
+        ellc_lower_param_default(st, fun, (struct ellc_param *) lnode_get(n), supplied,
+                                 ellc_ir_c_arg(fun, i));
+        i++;
+    }
+    // rest, only materialized if it's referenced
+    if (params->rest) {
+        struct ellc_ir_opnd *val = params->rest->referenced
+            ? ellc_ir_prim(fun, ELLC_TYPE_OBJ, "ell_make_rest_lst", 1, 3, ellc_ir_c_int(i),
+                           ellc_ir_c("__ell_npos"), ellc_ir_c("__ell_args"))
+            : ellc_ir_c("ell_unspecified");
+        ellc_lower_var_init(fun, params->rest, val);
+    }
+    for (lnode_t *n = list_first(params->key); n; n = list_next(params->key, n)) {
+        struct ellc_param *p = (struct ellc_param *) lnode_get(n);
+        struct ellc_ir_opnd *val =
+            ellc_ir_prim(fun, ELLC_TYPE_OBJ, "ell_lookup_key", 1, 4, ellc_ir_const(p->id->sym),
+                         ellc_ir_c("__ell_npos"), ellc_ir_c("__ell_nkey"), ellc_ir_c("__ell_args"));
+        struct ellc_ir_opnd *supplied =
+            ellc_ir_prim(fun, ELLC_TYPE_BOOL, "ELL_GEN_KEY_SUPPLIED", 1, 1, val);
+        ellc_lower_param_default(st, fun, p, supplied, val);
+    }
+    if (params->all_keys) {
+        ell_fail("all-keys parameters not yet supported\n");
+    }
+}
+
+/* A lifted lambda takes its required arguments directly. */
+static void
+ellc_lower_lifted_params(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast_lam *lam)
+{
+    unsigned i = 0;
+    for (lnode_t *n = list_first(lam->params->req); n; n = list_next(lam->params->req, n)) {
+        ellc_lower_var_init(fun, (struct ellc_param *) lnode_get(n), ellc_ir_c_arg(fun, i));
+        i++;
+    }
+}
+
+static void
+ellc_lower(struct ellc_st *st, struct ellc_ast_seq *ast_seq)
+{
+    for (lnode_t *n = list_first(st->lambdas); n; n = list_next(st->lambdas, n)) {
+        struct ellc_ast_lam *lam = (struct ellc_ast_lam *) lnode_get(n);
+        struct ellc_ir_fun *fun =
+            ellc_make_ir_fun(lam->lifted ? ELLC_IR_FUN_LIFTED : ELLC_IR_FUN_CODE, lam);
+        fun->safety = lam->safety;
+        ellc_ir_start(fun, ellc_ir_make_block(fun));
+        if (lam->lifted)
+            ellc_lower_lifted_params(st, fun, lam);
+        else
+            ellc_lower_params(st, fun, lam);
+        struct ellc_ir_opnd *res = ellc_lower_ast(st, fun, lam->body);
+        ellc_ir_add_arg(ellc_ir_add(fun, ELLC_IR_RETURN, NULL), res);
+        ell_util_list_add(st->funs, fun);
+    }
+    struct ellc_ir_fun *fun = ellc_make_ir_fun(ELLC_IR_FUN_INIT, NULL);
+    fun->safety = 1; // the top-level runs once, so it's always checked
+    ellc_ir_start(fun, ellc_ir_make_block(fun));
+    for (lnode_t *n = list_first(st->inlined); n; n = list_next(st->inlined, n)) {
+        struct ellc_inline *in = (struct ellc_inline *) lnode_get(n);
+        ellc_ir_prim(fun, ELLC_TYPE_NONE, "ELL_GEN_CHECK_INLINED", 0, 3,
+                     ellc_ir_c(ellc_mangle_glo_id(in->id)), ellc_ir_c(in->cell),
+                     ellc_ir_c(ellc_inline_flag(in)));
+    }
+    for (lnode_t *n = list_first(ast_seq->exprs); n; n = list_next(ast_seq->exprs, n)) {
+        struct ellc_ir_opnd *res = ellc_lower_ast(st, fun, (struct ellc_ast *) lnode_get(n));
+        ellc_ir_add_arg(ellc_ir_add(fun, ELLC_IR_RESULT, NULL), res);
+    }
+    st->init_fun = fun;
+}
+
+/**** IR Optimization ****/
+
+/* Removes pure instructions whose results are unused, until there are
+   none left.  Lowering leaves many of these behind, e.g. the values
+   of non-final expressions of sequences, or the result temporaries of
+   conditionals in test position. */
+
+static bool
+ellc_ir_pure(struct ellc_ir_insn *insn)
+{
+    switch(insn->type) {
+    case ELLC_IR_MOVE:
+    case ELLC_IR_VAR_REF:
+    case ELLC_IR_ENV_REF:
+    case ELLC_IR_CLO:
+        return 1;
+    case ELLC_IR_PRIM: return insn->prim.pure;
+    case ELLC_IR_GLO_REF: return insn->glo.bound;
+    default: return 0;
+    }
+}
+
+static void
+ellc_ir_count_uses(struct ellc_ir_fun *fun, unsigned *uses)
+{
+    memset(uses, 0, sizeof(unsigned) * list_count(fun->tmps));
+    for (lnode_t *bn = list_first(fun->blocks); bn; bn = list_next(fun->blocks, bn)) {
+        struct ellc_ir_block *block = (struct ellc_ir_block *) lnode_get(bn);
+        for (lnode_t *n = list_first(block->insns); n; n = list_next(block->insns, n)) {
+            struct ellc_ir_insn *insn = (struct ellc_ir_insn *) lnode_get(n);
+            for (lnode_t *an = list_first(insn->args); an; an = list_next(insn->args, an)) {
+                struct ellc_ir_opnd *arg = (struct ellc_ir_opnd *) lnode_get(an);
+                if (arg->type == ELLC_IR_OPND_TMP)
+                    uses[arg->tmp]++;
+            }
+        }
+    }
+}
+
+static void
+ellc_ir_dce(struct ellc_ir_fun *fun)
+{
+    unsigned *uses = (unsigned *) ell_alloc(sizeof(unsigned) * (list_count(fun->tmps) + 1));
+    bool changed;
+    do {
+        changed = 0;
+        ellc_ir_count_uses(fun, uses);
+        for (lnode_t *bn = list_first(fun->blocks); bn; bn = list_next(fun->blocks, bn)) {
+            struct ellc_ir_block *block = (struct ellc_ir_block *) lnode_get(bn);
+            lnode_t *next;
+            for (lnode_t *n = list_first(block->insns); n; n = next) {
+                next = list_next(block->insns, n);
+                struct ellc_ir_insn *insn = (struct ellc_ir_insn *) lnode_get(n);
+                if (insn->dst && !uses[insn->dst->tmp] && ellc_ir_pure(insn)) {
+                    list_delete(block->insns, n);
+                    changed = 1;
+                }
+            }
+        }
+    } while (changed);
+}
+
+/* The multiple values buffer holds the values of the last call to
+   VALUES, which are only the values of a call that returned the
+   result of that VALUES.  So the buffer is cleared wherever a
+   returned value, or the primary value read by MULTIPLE-VALUE-REF,
+   doesn't come from VALUES or a call: after the instruction producing
+   it, or, for a call, before it, since the callee may be a builtin
+   that returns a single value without touching the buffer (builtins
+   that call functions clear it themselves, see `ell_values_buf').
+   Through moves, the values of the branches of a conditional are
+   traced, and for MULTIPLE-VALUE-REF, the variable that `ell-mvb'
+   binds the primary value to. */
+
+struct ellc_ir_def {
+    struct ellc_ir_block *block;
+    lnode_t *node;
+};
+
+static struct ellc_ir_opnd *
+ellc_ir_first_arg(struct ellc_ir_insn *insn)
+{
+    return (struct ellc_ir_opnd *) lnode_get(list_first(insn->args));
+}
+
+static void
+ellc_ir_insert_clear_values(struct ellc_ir_block *block, lnode_t *node, bool before)
+{
+    struct ellc_ir_insn *insn = (struct ellc_ir_insn *) ell_alloc(sizeof(*insn));
+    insn->type = ELLC_IR_PRIM;
+    insn->args = ell_util_make_list();
+    insn->prim.name = "ELL_GEN_CLEAR_VALUES";
+    lnode_t *new = (lnode_t *) ell_alloc(sizeof(*new));
+    lnode_init(new, insn);
+    if (before)
+        list_ins_before(block->insns, new, node);
+    else
+        list_ins_after(block->insns, new, node);
+}
+
+static struct ellc_ir_def *
+ellc_ir_find_var_init(struct ellc_ir_fun *fun, struct ellc_param *p)
+{
+    for (lnode_t *bn = list_first(fun->blocks); bn; bn = list_next(fun->blocks, bn)) {
+        struct ellc_ir_block *block = (struct ellc_ir_block *) lnode_get(bn);
+        for (lnode_t *n = list_first(block->insns); n; n = list_next(block->insns, n)) {
+            struct ellc_ir_insn *insn = (struct ellc_ir_insn *) lnode_get(n);
+            if ((insn->type == ELLC_IR_VAR_INIT) && (insn->param == p)) {
+                struct ellc_ir_def *def = (struct ellc_ir_def *) ell_alloc(sizeof(*def));
+                def->block = block;
+                def->node = n;
+                return def;
+            }
+        }
+    }
+    return NULL;
+}
+
+/* Clears the buffer for the operand OPND of the instruction USE. */
+static void
+ellc_ir_clear_values_for(struct ellc_ir_fun *fun, list_t **defs, bool *seen,
+                         struct ellc_ir_block *block, lnode_t *use,
+                         struct ellc_ir_opnd *opnd, bool primary)
+{
+    if (opnd->type != ELLC_IR_OPND_TMP) {
+        ellc_ir_insert_clear_values(block, use, 1);
+        return;
+    }
+    if (seen[opnd->tmp]) return;
+    seen[opnd->tmp] = 1;
+    for (lnode_t *n = list_first(defs[opnd->tmp]); n; n = list_next(defs[opnd->tmp], n)) {
+        struct ellc_ir_def *def = (struct ellc_ir_def *) lnode_get(n);
+        struct ellc_ir_insn *insn = (struct ellc_ir_insn *) lnode_get(def->node);
+        struct ellc_ir_def *init;
+        switch(insn->type) {
+        case ELLC_IR_CALL:
+        case ELLC_IR_LIFTED_CALL:
+            ellc_ir_insert_clear_values(def->block, def->node, 1);
+            break;
+        case ELLC_IR_MOVE:
+            ellc_ir_clear_values_for(fun, defs, seen, def->block, def->node,
+                                     ellc_ir_first_arg(insn), primary);
+            break;
+        case ELLC_IR_VAR_REF:
+            if (primary && (init = ellc_ir_find_var_init(fun, insn->param))) {
+                struct ellc_ir_insn *init_insn = (struct ellc_ir_insn *) lnode_get(init->node);
+                ellc_ir_clear_values_for(fun, defs, seen, init->block, init->node,
+                                         ellc_ir_first_arg(init_insn), primary);
+                break;
+            }
+            ellc_ir_insert_clear_values(def->block, def->node, 0);
+            break;
+        case ELLC_IR_PRIM:
+            if (!strcmp(insn->prim.name, "ELL_GEN_VALUES"))
+                break;
+            // fall through
+        default:
+            ellc_ir_insert_clear_values(def->block, def->node, 0);
+        }
+    }
 }
 
-static char *ELLC_NO_CX = "";
-
-static char *
-ellc_mangle_cx(struct ell_cx *cx)
+static void
+ellc_ir_clear_values(struct ellc_ir_fun *fun)
 {
-    if (cx->uuid != NULL) {
-        char *out = (char *) ell_alloc(37);
-        uuid_unparse(cx->uuid, out);
-        return ellc_mangle_str(out);
-    } else {
-        return ELLC_NO_CX;
+    unsigned ntmps = list_count(fun->tmps);
+    list_t **defs = (list_t **) ell_alloc(sizeof(list_t *) * (ntmps + 1));
+    bool *seen = (bool *) ell_alloc(sizeof(bool) * (ntmps + 1));
+    list_t *uses = ell_util_make_list(); // def of consuming instruction
+    for (unsigned i = 0; i < ntmps; i++)
+        defs[i] = ell_util_make_list();
+    for (lnode_t *bn = list_first(fun->blocks); bn; bn = list_next(fun->blocks, bn)) {
+        struct ellc_ir_block *block = (struct ellc_ir_block *) lnode_get(bn);
+        for (lnode_t *n = list_first(block->insns); n; n = list_next(block->insns, n)) {
+            struct ellc_ir_insn *insn = (struct ellc_ir_insn *) lnode_get(n);
+            struct ellc_ir_def *def = (struct ellc_ir_def *) ell_alloc(sizeof(*def));
+            def->block = block;
+            def->node = n;
+            if (insn->dst)
+                ell_util_list_add(defs[insn->dst->tmp], def);
+            if ((insn->type == ELLC_IR_RETURN)
+                || ((insn->type == ELLC_IR_PRIM)
+                    && !strcmp(insn->prim.name, "ELL_GEN_MULTIPLE_VALUE_REF")))
+                ell_util_list_add(uses, def);
+        }
+    }
+    for (lnode_t *n = list_first(uses); n; n = list_next(uses, n)) {
+        struct ellc_ir_def *use = (struct ellc_ir_def *) lnode_get(n);
+        struct ellc_ir_insn *insn = (struct ellc_ir_insn *) lnode_get(use->node);
+        ellc_ir_clear_values_for(fun, defs, seen, use->block, use->node,
+                                 ellc_ir_first_arg(insn), insn->type != ELLC_IR_RETURN);
     }
 }
 
-static char *
-ellc_mangle_id(char *prefix, struct ellc_id *id)
+static void
+ellc_ir_opt(struct ellc_st *st)
 {
-    char *std = "__ell";
-    char *name = ellc_mangle_str(ell_str_chars(ell_sym_name(id->sym)));
-    char *cx = ellc_mangle_cx(id->cx);
-    size_t prefix_len = strlen(prefix);
-    size_t std_len = strlen(std);
-    size_t name_len = strlen(name);
-    size_t cx_len = strlen(cx);
-    size_t len = std_len + prefix_len + name_len + cx_len
-        + 4  // separators
-        + 1  // ns (single digit, lest this become a Lisp-10)
-        + 1; // zero
-    char *out = (char *) ell_alloc(len);
-    snprintf(out, len, "%s_%s_%s_%u_%s", std, prefix, name, id->ns, cx);
-    return out;
+    for (lnode_t *n = list_first(st->funs); n; n = list_next(st->funs, n)) {
+        ellc_ir_dce((struct ellc_ir_fun *) lnode_get(n));
+        ellc_ir_clear_values((struct ellc_ir_fun *) lnode_get(n));
+    }
+    ellc_ir_dce(st->init_fun);
+    ellc_ir_clear_values(st->init_fun);
 }
 
-static char *
-ellc_mangle_glo_id(struct ellc_id *id)
+/**** Emission ****/
+
+/* Constants are named by their index in the constant pool.  Strings
+   and numbers are static objects, whose wrappers get filled in when
+   the unit is loaded.  Symbols need to be interned, so their slots
+   get initialized when the unit is loaded. */
+
+static unsigned
+ellc_constant_index(struct ellc_st *st, struct ell_obj *obj)
 {
-    return ellc_mangle_id("g", id);
+    dnode_t *n = dict_lookup(st->constants, obj);
+    if (!n) ell_fail("constant not in pool\n");
+    return (unsigned) (uintptr_t) dnode_get(n);
 }
 
-static char *
-ellc_mangle_param_id(struct ellc_id *id)
+static void
+ellc_emit_constant(struct ellc_st *st, struct ell_obj *obj)
 {
-    return ellc_mangle_id("p", id);
+    if (obj->wrapper == ELL_WRAPPER(sym))
+        fprintf(st->f, "__ell_const_%u", ellc_constant_index(st, obj));
+    else
+        fprintf(st->f, "(&__ell_const_%u)", ellc_constant_index(st, obj));
 }
 
-static char *
-ellc_mangle_env_id(struct ellc_id *id)
+/* Writes the characters as a C string literal. */
+static void
+ellc_emit_c_str(struct ellc_st *st, char *chars)
 {
-    return ellc_mangle_id("e", id);
+    fputc('"', st->f);
+    for (unsigned char *c = (unsigned char *) chars; *c; c++) {
+        if ((*c == '"') || (*c == '\\'))
+            fprintf(st->f, "\\%c", *c);
+        else if ((*c < ' ') || (*c > '~'))
+            fprintf(st->f, "\\%03o", *c);
+        else
+            fputc(*c, st->f);
+    }
+    fputc('"', st->f);
 }
 
 static void
-ellc_emit_glo_ref(struct ellc_st *st, struct ellc_ast *ast)
+ellc_emit_constants_declarations(struct ellc_st *st)
 {
-    struct ellc_id *id = ast->glo_ref.id;
-    char *sid = ell_str_chars(ell_sym_name(id->sym));
-    char *mid = ellc_mangle_glo_id(id);
-    switch(id->ns) {
-    case ELLC_NS_VAR:
-        fprintf(st->f, "ELL_GEN_GLO_REF(%s, \"%s\")", mid, sid);
-        break;
-    case ELLC_NS_FUN:
-        fprintf(st->f, "ELL_GEN_GLO_FREF(%s, \"%s\")", mid, sid);
-        break;
-    default:
-        ell_fail("unknown namespace\n");
+    for (dnode_t *n = dict_first(st->constants); n; n = dict_next(st->constants, n)) {
+        struct ell_obj *obj = (struct ell_obj *) dnode_getkey(n);
+        unsigned i = (unsigned) (uintptr_t) dnode_get(n);
+        if (obj->wrapper == ELL_WRAPPER(sym)) {
+            fprintf(st->f, "static struct ell_obj *__ell_const_%u;\n", i);
+        } else if (obj->wrapper == ELL_WRAPPER(str)) {
+            fprintf(st->f, "static struct ell_str_data __ell_const_data_%u = { ", i);
+            ellc_emit_c_str(st, ell_str_chars(obj));
+            fprintf(st->f, " };\n");
+            fprintf(st->f, "static struct ell_obj __ell_const_%u = { NULL, &__ell_const_data_%u };\n", i, i);
+        } else if (obj->wrapper == ELL_WRAPPER(num_int)) {
+            fprintf(st->f, "static struct ell_num_int_data __ell_const_data_%u = { %d };\n",
+                    i, ell_num_int(obj));
+            fprintf(st->f, "static struct ell_obj __ell_const_%u = { NULL, &__ell_const_data_%u };\n", i, i);
+        } else {
+            ell_fail("bad constant\n");
+        }
     }
 }
 
 static void
-ellc_emit_arg_ref_plain(struct ellc_st *st, struct ellc_ast *ast)
+ellc_emit_ltvs_declarations(struct ellc_st *st)
 {
-    fprintf(st->f, "ELL_GEN_ARG_REF_PLAIN(%s)", ellc_mangle_param_id(ast->arg_ref.param->id));
+    for (unsigned i = 0; i < st->nltvs; i++)
+        fprintf(st->f, "static struct ell_obj *__ell_ltv_%u;\n", i);
 }
 
-static void
-ellc_emit_env_ref_plain(struct ellc_st *st, struct ellc_ast *ast)
+static char *
+ellc_ctype(struct ell_obj *type, bool result)
 {
-    fprintf(st->f, "ELL_GEN_ENV_REF_PLAIN(%s)", ellc_mangle_env_id(ast->env_ref.param->id));
+    if ((type == ELL_SYM(prim_integer_class)) || (type == ELL_SYM(ctype_boolean)))
+        return "int";
+    else if (type == ELL_SYM(ctype_string))
+        return result ? "char *" : "const char *";
+    else if (type == ELL_SYM(ctype_unspecified))
+        return "void";
+    else
+        return "struct ell_obj *";
 }
 
+/* Prototypes of the called C functions, which must be compatible
+   with the ones in the C headers included by the unit, and come after
+   its C statements, which may define the functions. */
 static void
-ellc_emit_arg_ref(struct ellc_st *st, struct ellc_ast *ast)
+ellc_emit_c_functions_declarations(struct ellc_st *st)
 {
-    if (ellc_param_boxed(ast->arg_ref.param)) {
-        fprintf(st->f, "ELL_GEN_ARG_REF_BOXED(%s)", ellc_mangle_param_id(ast->arg_ref.param->id));
-    } else {
-        ellc_emit_arg_ref_plain(st, ast);
+    for (lnode_t *n = list_first(st->c_calls); n; n = list_next(st->c_calls, n)) {
+        struct ellc_ast_ccall *ccall = &((struct ellc_ast *) lnode_get(n))->ccall;
+        fprintf(st->f, "%s %s(", ellc_ctype(ccall->result_type, 1), ell_str_chars(ccall->name));
+        if (list_isempty(ccall->param_types))
+            fprintf(st->f, "void");
+        list_t *types = ccall->param_types;
+        for (lnode_t *tn = list_first(types); tn; tn = list_next(types, tn))
+            fprintf(st->f, "%s%s", (tn == list_first(types)) ? "" : ", ",
+                    ellc_ctype((struct ell_obj *) lnode_get(tn), 0));
+        fprintf(st->f, ");\n");
     }
 }
 
 static void
-ellc_emit_env_ref(struct ellc_st *st, struct ellc_ast *ast)
+ellc_emit_slot_caches_declarations(struct ellc_st *st)
 {
-    if (ellc_param_boxed(ast->env_ref.param)) {
-        fprintf(st->f, "ELL_GEN_ENV_REF_BOXED(%s)", ellc_mangle_env_id(ast->env_ref.param->id));
-    } else {
-        ellc_emit_env_ref_plain(st, ast);
+    for (unsigned i = 0; i < st->nslot_caches; i++)
+        fprintf(st->f, "static struct ell_slot_cache __ell_slot_cache_%u;\n", i);
+    unsigned i = 0;
+    for (lnode_t *n = list_first(st->make_caches); n; n = list_next(st->make_caches, n)) {
+        fprintf(st->f, "static unsigned __ell_make_indexes_%u[%u];\n",
+                i, (unsigned) (uintptr_t) lnode_get(n));
+        fprintf(st->f, "static struct ell_make_cache __ell_make_cache_%u = { NULL, __ell_make_indexes_%u };\n",
+                i, i);
+        i++;
     }
 }
 
 static void
-ellc_emit_def(struct ellc_st *st, struct ellc_ast *ast)
+ellc_emit_constants_initializations(struct ellc_st *st)
 {
-    fprintf(st->f, "ELL_GEN_DEF(%s, ", ellc_mangle_glo_id(ast->def.id));
-    ellc_emit_ast(st, ast->def.val);
-    fprintf(st->f, ")");
+    for (dnode_t *n = dict_first(st->constants); n; n = dict_next(st->constants, n)) {
+        struct ell_obj *obj = (struct ell_obj *) dnode_getkey(n);
+        unsigned i = (unsigned) (uintptr_t) dnode_get(n);
+        if (obj->wrapper == ELL_WRAPPER(sym)) {
+            fprintf(st->f, "\t__ell_const_%u = ell_intern(ell_make_str(", i);
+            ellc_emit_c_str(st, ell_str_chars(ell_sym_name(obj)));
+            fprintf(st->f, "));\n");
+        } else if (obj->wrapper == ELL_WRAPPER(str)) {
+            fprintf(st->f, "\t__ell_const_%u.wrapper = ELL_WRAPPER(str);\n", i);
+        } else {
+            fprintf(st->f, "\t__ell_const_%u.wrapper = ELL_WRAPPER(num_int);\n", i);
+        }
+    }
 }
 
-static void
-ellc_emit_defp(struct ellc_st *st, struct ellc_ast *ast)
+static char *
+ellc_c_type(enum ellc_type type)
 {
-    fprintf(st->f, "ELL_GEN_DEFP(%s)", ellc_mangle_glo_id(ast->defp.id));
+    switch(type) {
+    case ELLC_TYPE_FIXNUM: return "int";
+    case ELLC_TYPE_BOOL: return "bool";
+    default: return "void *";
+    }
 }
 
 static void
-ellc_emit_glo_set(struct ellc_st *st, struct ellc_ast *ast)
+ellc_emit_opnd(struct ellc_st *st, struct ellc_ir_opnd *opnd)
 {
-    char *sid = ell_str_chars(ell_sym_name(ast->glo_set.id->sym));
-    char *mid = ellc_mangle_glo_id(ast->glo_set.id);
-    fprintf(st->f, "ELL_GEN_GLO_SET(%s, \"%s\", ", mid, sid);
-    ellc_emit_ast(st, ast->glo_set.val);
-    fprintf(st->f, ")");
+    switch(opnd->type) {
+    case ELLC_IR_OPND_TMP: fprintf(st->f, "__ell_t%u", opnd->tmp); break;
+    case ELLC_IR_OPND_CONST: ellc_emit_constant(st, opnd->obj); break;
+    case ELLC_IR_OPND_C: fprintf(st->f, "%s", opnd->c); break;
+    default: ell_fail("bad operand\n");
+    }
 }
 
-static void
-ellc_emit_arg_set(struct ellc_st *st, struct ellc_ast *ast)
+static struct ellc_ir_opnd *
+ellc_insn_arg(struct ellc_ir_insn *insn)
 {
-    struct ellc_ast_arg_set *arg_set = &ast->arg_set;
-    if (ellc_param_boxed(arg_set->param)) {
-        fprintf(st->f, "ELL_GEN_ARG_SET_BOXED(%s, ", ellc_mangle_param_id(arg_set->param->id));
-        ellc_emit_ast(st, arg_set->val);
-        fprintf(st->f, ")");
-    } else {
-        fprintf(st->f, "ELL_GEN_ARG_SET_PLAIN(%s, ", ellc_mangle_param_id(arg_set->param->id));
-        ellc_emit_ast(st, arg_set->val);
-        fprintf(st->f, ")");
-    }
+    return (struct ellc_ir_opnd *) lnode_get(list_first(insn->args));
 }
 
+/* Emits the arguments of an instruction, starting at node N, as a
+   comma-separated list. */
 static void
-ellc_emit_env_set(struct ellc_st *st, struct ellc_ast *ast)
+ellc_emit_insn_args(struct ellc_st *st, struct ellc_ir_insn *insn, lnode_t *n)
 {
-    struct ellc_ast_env_set *env_set = &ast->env_set;
-    if (ellc_param_boxed(env_set->param)) {
-        fprintf(st->f, "ELL_GEN_ENV_SET_BOXED(%s, ", ellc_mangle_env_id(env_set->param->id));
-        ellc_emit_ast(st, env_set->val);
-        fprintf(st->f, ")");
-    } else {
-        fprintf(st->f, "ELL_GEN_ENV_SET_PLAIN(%s, ", ellc_mangle_env_id(env_set->param->id));
-        ellc_emit_ast(st, env_set->val);
-        fprintf(st->f, ")");
+    for (; n; n = list_next(insn->args, n)) {
+        ellc_emit_opnd(st, (struct ellc_ir_opnd *) lnode_get(n));
+        if (list_next(insn->args, n))
+            fprintf(st->f, ", ");
     }
 }
 
 static void
-ellc_emit_cond(struct ellc_st *st, struct ellc_ast *ast)
+ellc_emit_dst(struct ellc_st *st, struct ellc_ir_insn *insn)
 {
-    fprintf(st->f, "ELL_GEN_COND(");
-    ellc_emit_ast(st, ast->cond.test);
-    fprintf(st->f, ", ");
-    ellc_emit_ast(st, ast->cond.consequent);
-    fprintf(st->f, ", ");
-    ellc_emit_ast(st, ast->cond.alternative);
-    fprintf(st->f, ")");
+    fprintf(st->f, "\t");
+    if (insn->dst) {
+        ellc_emit_opnd(st, insn->dst);
+        fprintf(st->f, " = ");
+    }
 }
 
+/* Tricky: if a variable is boxed, the closure environment needs to
+   contain the box, not the box's contents.  This means we need to
+   emit references specially here, so that they always act as if the
+   variable was unboxed, even for boxed ones. */
 static void
-ellc_emit_seq(struct ellc_st *st, struct ellc_ast *ast)
+ellc_emit_plain_ref(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ast *ref_ast)
 {
-    fprintf(st->f, "({ ");
-    for (lnode_t *n = list_first(ast->seq.exprs); n; n = list_next(ast->seq.exprs, n)) {
-        ellc_emit_ast(st, (struct ellc_ast *) lnode_get(n));
-        fprintf(st->f, "; ");
+    switch(ref_ast->type) {
+    case ELLC_AST_ENV_REF:
+        fprintf(st->f, "ELL_GEN_ENV_REF_PLAIN(%s)", ellc_mangle_env_id(ref_ast->env_ref.param->id));
+        break;
+    case ELLC_AST_ARG_REF:
+        fprintf(st->f, "ELL_GEN_ARG_REF_PLAIN(%s)", ellc_ir_local(fun, ref_ast->arg_ref.param));
+        break;
+    default:
+        ell_fail("bad closure environment reference\n");
     }
-    fprintf(st->f, " })");
 }
 
 static void
-ellc_emit_app(struct ellc_st *st, struct ellc_ast *ast)
+ellc_emit_glo_ref(struct ellc_st *st, struct ellc_ir_insn *insn)
 {
-    struct ellc_ast_app *app = &ast->app;
-    listcount_t npos = list_count(&app->args->pos);
-    dictcount_t nkey = dict_count(&app->args->key);
-    fprintf(st->f, "({");
-    if (npos || nkey) {
-        // evaluate arguments
-        unsigned ipos = 0;
-        for (lnode_t *n = list_first(&app->args->pos); n; n = list_next(&app->args->pos, n)) {
-            struct ellc_ast *arg_ast = (struct ellc_ast *) lnode_get(n);
-            fprintf(st->f, "struct ell_obj *__ell_pos_arg_%u = ", ipos);
-            ellc_emit_ast(st, arg_ast);
-            fprintf(st->f, "; ");
-            ipos++;
-        }
-        unsigned kpos = 0;
-        for (dnode_t *n = dict_first(&app->args->key); n; n = dict_next(&app->args->key, n)) {
-            struct ellc_ast *arg_ast = (struct ellc_ast *) dnode_get(n);
-            fprintf(st->f, "struct ell_obj *__ell_key_arg_%u = ", kpos);
-            ellc_emit_ast(st, arg_ast);
-            fprintf(st->f, "; ");
-            kpos++;
-        }
-        // fill arguments array
-        fprintf(st->f, "struct ell_obj *__ell_args[] = {");
-        ipos = 0;
-        for (lnode_t *n = list_first(&app->args->pos); n; n = list_next(&app->args->pos, n)) {
-            fprintf(st->f, "__ell_pos_arg_%u, ", ipos);
-            ipos++;
-        }
-        kpos = 0;
-        for (dnode_t *n = dict_first(&app->args->key); n; n = dict_next(&app->args->key, n)) {
-            struct ell_obj *arg_key_sym = (struct ell_obj *) dnode_getkey(n);
-            // enh: this can be done more efficiently (intern symbols
-            // used as keyword argument names at load-time)
-            fprintf(st->f, "ell_intern(ell_make_str(\"%s\")), ", ell_str_chars(ell_sym_name(arg_key_sym)));
-            fprintf(st->f, "__ell_key_arg_%u, ", kpos);
-            kpos++;
-        }
-        fprintf(st->f, "}; ");
+    struct ellc_id *id = insn->glo.id;
+    char *sid = ell_str_chars(ell_sym_name(id->sym));
+    char *mid = ellc_mangle_glo_id(id);
+    ellc_emit_dst(st, insn);
+    if (insn->glo.bound) {
+        fprintf(st->f, "ELL_GEN_GLO_REF_BOUND(%s);\n", mid);
+        return;
+    }
+    switch(id->ns) {
+    case ELLC_NS_VAR:
+        fprintf(st->f, "ELL_GEN_GLO_REF(%s, \"%s\");\n", mid, sid);
+        break;
+    case ELLC_NS_FUN:
+        fprintf(st->f, "ELL_GEN_GLO_FREF(%s, \"%s\");\n", mid, sid);
+        break;
+    default:
+        ell_fail("unknown namespace\n");
     }
-    fprintf(st->f, "ell_call(");
-    ellc_emit_ast(st, app->op);
-    fprintf(st->f, ", %lu, %lu, %s);", npos, nkey, ((npos || nkey) ? "__ell_args" : "NULL"));
-    fprintf(st->f, "})");
 }
 
 static void
-ellc_emit_lam(struct ellc_st *st, struct ellc_ast *ast)
+ellc_emit_glo_set(struct ellc_st *st, struct ellc_ir_insn *insn)
 {
-    /* Inside a lambda, the enclosing hygiene context is not visible,
-       because it's a C local variable.  Thus, setting it to off
-       inside the lambda's body is needed so that the code does the
-       right thing, namely, generate a new context when a new
-       quasisyntax is encountered. */
-    bool in_quasisyntax_tmp = st->in_quasisyntax;
-    st->in_quasisyntax = 0;
+    char *sid = ell_str_chars(ell_sym_name(insn->glo.id->sym));
+    char *mid = ellc_mangle_glo_id(insn->glo.id);
+    if (insn->glo.bound)
+        fprintf(st->f, "\tELL_GEN_GLO_SET_BOUND(%s, ", mid);
+    else
+        fprintf(st->f, "\tELL_GEN_GLO_SET(%s, \"%s\", ", mid, sid);
+    ellc_emit_opnd(st, ellc_insn_arg(insn));
+    fprintf(st->f, ");\n");
+}
 
-    struct ellc_ast_lam *lam = &ast->lam;
-    fprintf(st->f, "({ ");
-    // populate env
-    if (dict_count(lam->env) > 0) {
-        fprintf(st->f, "struct __ell_env_%u *__lam_env = ell_alloc(sizeof(struct __ell_env_%u));",
-               lam->code_id, lam->code_id);
-        for (dnode_t *n = dict_first(lam->env); n; n = dict_next(lam->env, n)) {
-            struct ellc_id *env_id = (struct ellc_id *) dnode_getkey(n);
-            fprintf(st->f, "__lam_env->%s = ", ellc_mangle_env_id(env_id));
-            struct ellc_ast *ref_ast = (struct ellc_ast *) dnode_get(n);
-            /* Tricky: if a variable is boxed, the closure environment
-               needs to contain the box, not the box's contents.  This
-               means we need to emit references specially here, so
-               that they always act as if the variable was unboxed,
-               even for boxed ones. */
-            switch(ref_ast->type) {
-            case ELLC_AST_ENV_REF:
-                ellc_emit_env_ref_plain(st, ref_ast); break;
-            case ELLC_AST_ARG_REF:
-                ellc_emit_arg_ref_plain(st, ref_ast); break;
-            default:
-                ell_fail("bad closure environment reference\n");
-            }
-            fprintf(st->f, "; ");
-        }
-    }
-    // create closure
-    if (dict_count(lam->env) > 0) {
-        fprintf(st->f, "ell_make_clo(&__ell_code_%u, __lam_env);",
-                lam->code_id);
+/* A parameter in a stack box has the box declared next to it, see
+   `ellc_emit_ir_decls()'. */
+static void
+ellc_emit_var_init(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ir_insn *insn)
+{
+    char *name = ellc_ir_local(fun, insn->param);
+    if (ellc_param_heap_boxed(insn->param)) {
+        fprintf(st->f, "\t%s = ell_make_box(", name);
+        ellc_emit_opnd(st, ellc_insn_arg(insn));
+        fprintf(st->f, ");\n");
+    } else if (ellc_param_stack_boxed(insn->param)) {
+        fprintf(st->f, "\t__ell_box_%s = ", name);
+        ellc_emit_opnd(st, ellc_insn_arg(insn));
+        fprintf(st->f, ";\n\t%s = &__ell_box_%s;\n", name, name);
     } else {
-        fprintf(st->f, "ell_make_clo(&__ell_code_%u, NULL);",
-                lam->code_id);
+        fprintf(st->f, "\t%s = ", name);
+        ellc_emit_opnd(st, ellc_insn_arg(insn));
+        fprintf(st->f, ";\n");
     }
-    fprintf(st->f, "})");
-
-    st->in_quasisyntax = in_quasisyntax_tmp;
 }
 
 static void
-ellc_emit_loop(struct ellc_st *st, struct ellc_ast *ast)
+ellc_emit_var_ref(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ir_insn *insn)
 {
-    fprintf(st->f, "ELL_GEN_LOOP(");
-    ellc_emit_ast(st, ast->loop.body);
-    fprintf(st->f, ")");
+    char *name = ellc_ir_local(fun, insn->param);
+    ellc_emit_dst(st, insn);
+    if (ellc_param_boxed(insn->param))
+        fprintf(st->f, "ELL_GEN_ARG_REF_BOXED(%s);\n", name);
+    else
+        fprintf(st->f, "ELL_GEN_ARG_REF_PLAIN(%s);\n", name);
 }
 
 static void
-ellc_emit_lit_sym(struct ellc_st *st, struct ellc_ast *ast)
+ellc_emit_var_set(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ir_insn *insn)
 {
-    // kludge
-    fprintf(st->f, "ell_intern(ell_make_str(\"%s\"))",
-            ell_str_chars(ell_sym_name(ast->lit_sym.sym)));
+    char *name = ellc_ir_local(fun, insn->param);
+    if (ellc_param_boxed(insn->param))
+        fprintf(st->f, "\tELL_GEN_ARG_SET_BOXED(%s, ", name);
+    else
+        fprintf(st->f, "\tELL_GEN_ARG_SET_PLAIN(%s, ", name);
+    ellc_emit_opnd(st, ellc_insn_arg(insn));
+    fprintf(st->f, ");\n");
 }
 
 static void
-ellc_emit_lit_str(struct ellc_st *st, struct ellc_ast *ast)
+ellc_emit_env_ref(struct ellc_st *st, struct ellc_ir_insn *insn)
 {
-    // kludge
-    fprintf(st->f, "ell_make_str(\"%s\")",
-            ell_str_chars(ast->lit_str.str));
+    char *mid = ellc_mangle_env_id(insn->param->id);
+    ellc_emit_dst(st, insn);
+    if (ellc_param_boxed(insn->param))
+        fprintf(st->f, "ELL_GEN_ENV_REF_BOXED(%s);\n", mid);
+    else
+        fprintf(st->f, "ELL_GEN_ENV_REF_PLAIN(%s);\n", mid);
 }
 
 static void
-ellc_emit_lit_num(struct ellc_st *st, struct ellc_ast *ast)
+ellc_emit_env_set(struct ellc_st *st, struct ellc_ir_insn *insn)
 {
-    // kludge
-    fprintf(st->f, "ell_make_num(\"%d\")",
-            ell_num_int(ast->lit_num.num));
+    char *mid = ellc_mangle_env_id(insn->param->id);
+    if (ellc_param_boxed(insn->param))
+        fprintf(st->f, "\tELL_GEN_ENV_SET_BOXED(%s, ", mid);
+    else
+        fprintf(st->f, "\tELL_GEN_ENV_SET_PLAIN(%s, ", mid);
+    ellc_emit_opnd(st, ellc_insn_arg(insn));
+    fprintf(st->f, ");\n");
 }
 
+/* The first argument is the function, followed by the positional
+   arguments, and the values of the keyword arguments. */
+/* The argument array is parenthesized, because calls of linked
+   functions pass it to a macro. */
 static void
-ellc_emit_lit_stx(struct ellc_st *st, struct ellc_ast *ast)
+ellc_emit_call(struct ellc_st *st, struct ellc_ir_insn *insn)
 {
-    struct ell_obj *stx = ast->lit_stx.stx;
-    if (stx->wrapper == ELL_WRAPPER(stx_sym)) {
-        fprintf(st->f, "ell_make_stx_sym_cx(ell_intern(ell_make_str(\"%s\")), __ell_cur_cx)",
-                ell_str_chars(ell_sym_name(ell_stx_sym_sym(stx))));
-    } else if (stx->wrapper == ELL_WRAPPER(stx_str)) {
-        fprintf(st->f, "ell_make_stx_str(ell_make_str(\"%s\"))", 
-                ell_str_chars(ell_stx_str_str(stx)));
+    listcount_t nkey = list_count(insn->call.keys);
+    listcount_t npos = list_count(insn->args) - 1 - nkey;
+    lnode_t *op = list_first(insn->args);
+    struct ellc_link *link = insn->call.link;
+    ellc_emit_dst(st, insn);
+    if (link)
+        fprintf(st->f, "ELL_GEN_LINKED_CALL(%s, ", link->cell);
+    else if (insn->call.unchecked)
+        fprintf(st->f, "ell_call_unchecked(");
+    else
+        fprintf(st->f, "ell_call(");
+    ellc_emit_opnd(st, (struct ellc_ir_opnd *) lnode_get(op));
+    fprintf(st->f, ", %lu, %lu, ", npos, nkey);
+    if (npos || nkey) {
+        fprintf(st->f, "((struct ell_obj *[]) { ");
+        lnode_t *an = list_next(insn->args, op);
+        for (listcount_t i = 0; i < npos; i++) {
+            ellc_emit_opnd(st, (struct ellc_ir_opnd *) lnode_get(an));
+            fprintf(st->f, ", ");
+            an = list_next(insn->args, an);
+        }
+        for (lnode_t *kn = list_first(insn->call.keys); kn; kn = list_next(insn->call.keys, kn)) {
+            ellc_emit_constant(st, (struct ell_obj *) lnode_get(kn));
+            fprintf(st->f, ", ");
+            ellc_emit_opnd(st, (struct ellc_ir_opnd *) lnode_get(an));
+            fprintf(st->f, ", ");
+            an = list_next(insn->args, an);
+        }
+        fprintf(st->f, "})");
     } else {
-        ell_fail("literal syntax error\n");
+        fprintf(st->f, "NULL");
     }
+    fprintf(st->f, ");\n");
 }
 
 static void
-ellc_emit_cx(struct ellc_st *st, struct ellc_ast *ast)
+ellc_emit_lifted_call(struct ellc_st *st, struct ellc_ir_insn *insn)
 {
-    if (st->in_quasisyntax) {
-        ellc_emit_ast(st, ast->cx.body);
-    } else {
-        /* Shadow the global current hygiene context, which is always
-           NULL.  The trick here is that only syntax forms that are
-           statically enclosed in this form will pick up this new
-           context, that's shadowing the global context, since the new
-           context is a C local variable. */
-        st->in_quasisyntax = 1;
-        fprintf(st->f, "({ struct ell_cx *__ell_cur_cx = ell_make_cx(); ");
-        ellc_emit_ast(st, ast->cx.body);
-        fprintf(st->f, "; })");
-        st->in_quasisyntax = 0;
+    struct ellc_ast_lam *lam = insn->lam;
+    ellc_emit_dst(st, insn);
+    fprintf(st->f, "__ell_lifted_%u(", lam->code_id);
+    ellc_emit_insn_args(st, insn, list_first(insn->args));
+    bool comma = !list_isempty(insn->args);
+    for (dnode_t *n = dict_first(lam->env); n; n = dict_next(lam->env, n)) {
+        struct ellc_id *env_id = (struct ellc_id *) dnode_getkey(n);
+        fprintf(st->f, "%s__ell_lift_%u_%s", (comma ? ", " : ""), lam->code_id,
+                ellc_mangle_env_id(env_id));
+        comma = 1;
     }
+    fprintf(st->f, ");\n");
 }
 
-/* Emits a body sequence containing literal strings and other
-   expressions by emitting the literal strings at the top-level of the
-   sequence as-is to the C output. */
 static void
-ellc_direct_emit_c_sequence(struct ellc_st *st, struct ellc_ast *body_seq)
+ellc_emit_lift_env(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ir_insn *insn)
 {
-    if(body_seq->type != ELLC_AST_SEQ) {
-        ell_fail("C output error\n");
+    struct ellc_ast_lam *lam = insn->lam;
+    for (dnode_t *n = dict_first(lam->env); n; n = dict_next(lam->env, n)) {
+        struct ellc_id *env_id = (struct ellc_id *) dnode_getkey(n);
+        fprintf(st->f, "\t__ell_lift_%u_%s = ", lam->code_id, ellc_mangle_env_id(env_id));
+        ellc_emit_plain_ref(st, fun, (struct ellc_ast *) dnode_get(n));
+        fprintf(st->f, ";\n");
     }
-    list_t *exprs = body_seq->seq.exprs;
-    for (lnode_t *n = list_first(exprs); n; n = list_next(exprs, n)) {
-        struct ellc_ast *expr = (struct ellc_ast *) lnode_get(n);
-        if (expr->type == ELLC_AST_LIT_STR) {
-            fprintf(st->f, "%s", ell_str_chars(expr->lit_str.str));
-        } else {
-            ellc_emit_ast(st, expr);
-        }
+}
+
+/* Populates the environment of a lambda, if any, and creates its
+   closure, or uses the static one if there's no environment. */
+static void
+ellc_emit_clo(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ir_insn *insn)
+{
+    struct ellc_ast_lam *lam = insn->lam;
+    if (dict_count(lam->env) == 0) {
+        ellc_emit_dst(st, insn);
+        fprintf(st->f, "&__ell_clo_%u;\n", lam->code_id);
+        return;
+    }
+    if (lam->stack)
+        fprintf(st->f, "\t__ell_lam_env_%u = ELL_GEN_STACK_ENV(__ell_stack_clo_%u);\n",
+                lam->code_id, lam->code_id);
+    else
+        fprintf(st->f, "\t__ell_lam_env_%u = ell_alloc(sizeof(struct __ell_env_%u));\n",
+                lam->code_id, lam->code_id);
+    for (dnode_t *n = dict_first(lam->env); n; n = dict_next(lam->env, n)) {
+        struct ellc_id *env_id = (struct ellc_id *) dnode_getkey(n);
+        fprintf(st->f, "\t__ell_lam_env_%u->%s = ", lam->code_id, ellc_mangle_env_id(env_id));
+        ellc_emit_plain_ref(st, fun, (struct ellc_ast *) dnode_get(n));
+        fprintf(st->f, ";\n");
     }
+    ellc_emit_dst(st, insn);
+    if (lam->stack)
+        fprintf(st->f, "ELL_GEN_STACK_CLO(__ell_stack_clo_%u, &__ell_code_%u);\n",
+                lam->code_id, lam->code_id);
+    else
+        fprintf(st->f, "ell_make_clo(&__ell_code_%u, __ell_lam_env_%u);\n",
+                lam->code_id, lam->code_id);
 }
 
 static void
-ellc_emit_snip(struct ellc_st *st, struct ellc_ast *ast)
+ellc_emit_snip(struct ellc_st *st, struct ellc_ir_insn *insn)
 {
-    struct ellc_ast *body_seq = ast->snip.body;
-    ellc_direct_emit_c_sequence(st, body_seq);
+    ellc_emit_dst(st, insn);
+    for (lnode_t *n = list_first(insn->args); n; n = list_next(insn->args, n))
+        ellc_emit_opnd(st, (struct ellc_ir_opnd *) lnode_get(n));
+    fprintf(st->f, ";\n");
 }
 
+/* Jumps and branches fall through to the next block where possible. */
 static void
-ellc_emit_stmt(struct ellc_st *st, struct ellc_ast *ast)
+ellc_emit_branch(struct ellc_st *st, struct ellc_ir_insn *insn, struct ellc_ir_block *next)
 {
-    /* Do nothing, statements get emitted specially before everything
-       else.  However return something so that REPL etc is happy. */
-    fprintf(st->f, "ell_unspecified");
+    struct ellc_ir_block *then_block = insn->br.then_block;
+    struct ellc_ir_block *else_block = insn->br.else_block;
+    if (insn->type == ELLC_IR_JUMP) {
+        if (then_block != next)
+            fprintf(st->f, "\tgoto __ell_b%u;\n", then_block->id);
+        return;
+    }
+    if (then_block == next) {
+        fprintf(st->f, "\tif (!(");
+        ellc_emit_opnd(st, ellc_insn_arg(insn));
+        fprintf(st->f, ")) goto __ell_b%u;\n", else_block->id);
+        return;
+    }
+    fprintf(st->f, "\tif (");
+    ellc_emit_opnd(st, ellc_insn_arg(insn));
+    fprintf(st->f, ") goto __ell_b%u;\n", then_block->id);
+    if (else_block != next)
+        fprintf(st->f, "\tgoto __ell_b%u;\n", else_block->id);
 }
 
 static void
-ellc_emit_ast(struct ellc_st *st, struct ellc_ast *ast)
+ellc_emit_insn(struct ellc_st *st, struct ellc_ir_fun *fun, struct ellc_ir_insn *insn,
+               struct ellc_ir_block *next)
 {
-    switch(ast->type) {
-    case ELLC_AST_GLO_REF: ellc_emit_glo_ref(st, ast); break;
-    case ELLC_AST_ARG_REF: ellc_emit_arg_ref(st, ast); break;
-    case ELLC_AST_ENV_REF: ellc_emit_env_ref(st, ast); break;
-    case ELLC_AST_DEF: ellc_emit_def(st, ast); break;
-    case ELLC_AST_DEFP: ellc_emit_defp(st, ast); break;
-    case ELLC_AST_GLO_SET: ellc_emit_glo_set(st, ast); break;
-    case ELLC_AST_ARG_SET: ellc_emit_arg_set(st, ast); break;
-    case ELLC_AST_ENV_SET: ellc_emit_env_set(st, ast); break;
-    case ELLC_AST_COND: ellc_emit_cond(st, ast); break;
-    case ELLC_AST_SEQ: ellc_emit_seq(st, ast); break;
-    case ELLC_AST_APP: ellc_emit_app(st, ast); break;
-    case ELLC_AST_LAM: ellc_emit_lam(st, ast); break;
-    case ELLC_AST_LOOP: ellc_emit_loop(st, ast); break;
-    case ELLC_AST_CX: ellc_emit_cx(st, ast); break;
-    case ELLC_AST_SNIP: ellc_emit_snip(st, ast); break;
-    case ELLC_AST_STMT: ellc_emit_stmt(st, ast); break;
-    case ELLC_AST_LIT_SYM: ellc_emit_lit_sym(st, ast); break;
-    case ELLC_AST_LIT_STR: ellc_emit_lit_str(st, ast); break;
-    case ELLC_AST_LIT_NUM: ellc_emit_lit_num(st, ast); break;
-    case ELLC_AST_LIT_STX: ellc_emit_lit_stx(st, ast); break;
+    switch(insn->type) {
+    case ELLC_IR_MOVE:
+        ellc_emit_dst(st, insn);
+        ellc_emit_opnd(st, ellc_insn_arg(insn));
+        fprintf(st->f, ";\n");
+        break;
+    case ELLC_IR_PRIM:
+        ellc_emit_dst(st, insn);
+        fprintf(st->f, "%s(", insn->prim.name);
+        ellc_emit_insn_args(st, insn, list_first(insn->args));
+        fprintf(st->f, ");\n");
+        break;
+    case ELLC_IR_GLO_REF: ellc_emit_glo_ref(st, insn); break;
+    case ELLC_IR_GLO_SET: ellc_emit_glo_set(st, insn); break;
+    case ELLC_IR_DEF:
+        fprintf(st->f, "\tELL_GEN_DEF(%s, ", ellc_mangle_glo_id(insn->glo.id));
+        ellc_emit_opnd(st, ellc_insn_arg(insn));
+        fprintf(st->f, ");\n");
+        break;
+    case ELLC_IR_VAR_INIT: ellc_emit_var_init(st, fun, insn); break;
+    case ELLC_IR_VAR_REF: ellc_emit_var_ref(st, fun, insn); break;
+    case ELLC_IR_VAR_SET: ellc_emit_var_set(st, fun, insn); break;
+    case ELLC_IR_ENV_REF: ellc_emit_env_ref(st, insn); break;
+    case ELLC_IR_ENV_SET: ellc_emit_env_set(st, insn); break;
+    case ELLC_IR_CALL: ellc_emit_call(st, insn); break;
+    case ELLC_IR_LIFTED_CALL: ellc_emit_lifted_call(st, insn); break;
+    case ELLC_IR_CLO: ellc_emit_clo(st, fun, insn); break;
+    case ELLC_IR_LIFT_ENV: ellc_emit_lift_env(st, fun, insn); break;
+    case ELLC_IR_DLET_BIND:
+        fprintf(st->f, "\tELL_GEN_DLET_BIND(__ell_dyn_%u, %s, \"%s\", ", insn->dlet.index,
+                ellc_mangle_glo_id(insn->dlet.id), ell_str_chars(ell_sym_name(insn->dlet.id->sym)));
+        ellc_emit_opnd(st, ellc_insn_arg(insn));
+        fprintf(st->f, ");\n");
+        break;
+    case ELLC_IR_DLET_UNBIND:
+        fprintf(st->f, "\tELL_GEN_DLET_UNBIND(__ell_dyn_%u, %s);\n", insn->dlet.index,
+                ellc_mangle_glo_id(insn->dlet.id));
+        break;
+    case ELLC_IR_MAKE_CX:
+        fprintf(st->f, "\t__ell_cx_%u = ell_make_cx();\n", insn->cx);
+        break;
+    case ELLC_IR_SNIP: ellc_emit_snip(st, insn); break;
+    case ELLC_IR_RESULT:
+        fprintf(st->f, "\tell_result = __ell_unit_result = ");
+        ellc_emit_opnd(st, ellc_insn_arg(insn));
+        fprintf(st->f, ";\n");
+        break;
+    case ELLC_IR_JUMP:
+    case ELLC_IR_BRANCH:
+        ellc_emit_branch(st, insn, next);
+        break;
+    case ELLC_IR_RETURN:
+        fprintf(st->f, "\treturn ");
+        ellc_emit_opnd(st, ellc_insn_arg(insn));
+        fprintf(st->f, ";\n");
+        break;
     default:
         ell_fail("emission error\n");
     }
 }
 
+/* All temporaries and locals of a function, and the storage for
+   environments, dynamic bindings and hygiene contexts, are declared
+   at its top. */
 static void
-ellc_emit_req_param_val(struct ellc_st *st, struct ellc_param *p, unsigned i)
+ellc_emit_ir_decls(struct ellc_st *st, struct ellc_ir_fun *fun)
 {
-    if (ellc_param_boxed(p))
-        fprintf(st->f, "ell_make_box(__ell_args[%u])", i);
-    else
-        fprintf(st->f, "__ell_args[%u]", i);
+    unsigned tmp = 0;
+    for (lnode_t *n = list_first(fun->tmps); n; n = list_next(fun->tmps, n)) {
+        enum ellc_type type = (enum ellc_type) (uintptr_t) lnode_get(n);
+        fprintf(st->f, "\t%s __ell_t%u;\n",
+                (type == ELLC_TYPE_OBJ) ? "struct ell_obj *" : ellc_c_type(type), tmp);
+        tmp++;
+    }
+    for (dnode_t *n = dict_first(fun->locals); n; n = dict_next(fun->locals, n)) {
+        struct ellc_param *p = (struct ellc_param *) dnode_getkey(n);
+        char *name = (char *) dnode_get(n);
+        if (ellc_param_stack_boxed(p))
+            fprintf(st->f, "\tstruct ell_obj *__ell_box_%s;\n", name);
+        fprintf(st->f, "\t%s %s;\n", ellc_c_type(p->type), name);
+    }
+    for (lnode_t *n = list_first(fun->clos); n; n = list_next(fun->clos, n)) {
+        struct ellc_ast_lam *lam = (struct ellc_ast_lam *) lnode_get(n);
+        if (lam->stack)
+            fprintf(st->f, "\tELL_GEN_STACK_CLO_DECL(struct __ell_env_%u, __ell_stack_clo_%u);\n",
+                    lam->code_id, lam->code_id);
+        fprintf(st->f, "\tstruct __ell_env_%u *__ell_lam_env_%u;\n", lam->code_id, lam->code_id);
+    }
+    for (lnode_t *n = list_first(fun->lifted); n; n = list_next(fun->lifted, n)) {
+        struct ellc_ast_lam *lam = (struct ellc_ast_lam *) lnode_get(n);
+        for (dnode_t *en = dict_first(lam->env); en; en = dict_next(lam->env, en)) {
+            struct ellc_id *env_id = (struct ellc_id *) dnode_getkey(en);
+            fprintf(st->f, "\tvoid *__ell_lift_%u_%s;\n", lam->code_id, ellc_mangle_env_id(env_id));
+        }
+    }
+    for (unsigned i = 0; i < fun->ndlets; i++)
+        fprintf(st->f, "\tstruct ell_dynamic_binding __ell_dyn_%u;\n", i);
+    for (unsigned i = 0; i < fun->ncxs; i++)
+        fprintf(st->f, "\tstruct ell_cx *__ell_cx_%u;\n", i);
 }
 
-static void
-ellc_emit_opt_param_val(struct ellc_st *st, struct ellc_param *p, unsigned i)
+static struct ellc_ir_block *
+ellc_ir_next_block(struct ellc_ir_fun *fun, lnode_t *bn)
 {
-    if (ellc_param_boxed(p))
-        fprintf(st->f, "__ell_npos > %u ? ell_make_box(__ell_args[%u]) : ", i, i);
-    else
-        fprintf(st->f, "__ell_npos > %u ? __ell_args[%u] : ", i, i);
-
-    if (p->init)
-        ellc_emit_ast(st, p->init);
-    else
-        fprintf(st->f, "ell_unbound");
+    lnode_t *next_bn = list_next(fun->blocks, bn);
+    return next_bn ? (struct ellc_ir_block *) lnode_get(next_bn) : NULL;
 }
 
+/* Only blocks that are jumped to get a label, see
+   `ellc_emit_branch()'. */
 static void
-ellc_emit_key_param_val(struct ellc_st *st, struct ellc_param *p)
+ellc_emit_ir_blocks(struct ellc_st *st, struct ellc_ir_fun *fun)
 {
-    // Construct a call to the lookup routine using the param's symbolic name
-    fprintf(st->f, "({ struct ell_obj *__ell_key_val = ell_lookup_key(");
-    fprintf(st->f, "ell_intern(ell_make_str(\"%s\"))", ell_str_chars(ell_sym_name(p->id->sym)));
-    fprintf(st->f, ", __ell_npos, __ell_nkey, __ell_args);");
-
-    if (ellc_param_boxed(p))
-        fprintf(st->f, "__ell_key_val ? ell_make_box(__ell_key_val) : ");
-    else
-        fprintf(st->f, "__ell_key_val ? __ell_key_val : ");
-
-    if (p->init)
-        ellc_emit_ast(st, p->init);
-    else
-        fprintf(st->f, "ell_unbound");
-
-    fprintf(st->f, "; })");
+    list_t *targets = ell_util_make_list();
+    for (lnode_t *bn = list_first(fun->blocks); bn; bn = list_next(fun->blocks, bn)) {
+        struct ellc_ir_block *block = (struct ellc_ir_block *) lnode_get(bn);
+        struct ellc_ir_block *next = ellc_ir_next_block(fun, bn);
+        lnode_t *last = list_last(block->insns);
+        if (!last) continue;
+        struct ellc_ir_insn *insn = (struct ellc_ir_insn *) lnode_get(last);
+        if ((insn->type != ELLC_IR_JUMP) && (insn->type != ELLC_IR_BRANCH)) continue;
+        if (insn->br.then_block != next)
+            ell_util_set_add(targets, insn->br.then_block, (dict_comp_t) &ell_ptr_cmp);
+        if ((insn->type == ELLC_IR_BRANCH)
+            && ((insn->br.then_block == next) || (insn->br.else_block != next)))
+            ell_util_set_add(targets, insn->br.else_block, (dict_comp_t) &ell_ptr_cmp);
+    }
+    for (lnode_t *bn = list_first(fun->blocks); bn; bn = list_next(fun->blocks, bn)) {
+        struct ellc_ir_block *block = (struct ellc_ir_block *) lnode_get(bn);
+        struct ellc_ir_block *next = ellc_ir_next_block(fun, bn);
+        if (ell_util_list_contains(targets, block, (dict_comp_t) &ell_ptr_cmp))
+            fprintf(st->f, "  __ell_b%u: ;\n", block->id);
+        for (lnode_t *n = list_first(block->insns); n; n = list_next(block->insns, n))
+            ellc_emit_insn(st, fun, (struct ellc_ir_insn *) lnode_get(n), next);
+    }
 }
 
 static void
-ellc_emit_params(struct ellc_st *st, struct ellc_ast_lam *lam)
+ellc_emit_code(struct ellc_st *st, struct ellc_ir_fun *fun)
 {
-    listcount_t nreq = list_count(lam->params->req);
-    listcount_t nopt = list_count(lam->params->opt);
-    if (nreq > 0) {
-        fprintf(st->f, "\tif (__ell_npos < %lu) { ell_arity_error(); }\n", nreq);
+    struct ellc_ast_lam *lam = fun->lam;
+    fprintf(st->f, "static struct ell_obj *");
+    fprintf(st->f,
+            "__ell_code_%u(struct ell_obj *__ell_clo, ell_arg_ct __ell_npos, "
+            "ell_arg_ct __ell_nkey, struct ell_obj **__ell_args) {\n", lam->code_id);
+    ellc_emit_ir_decls(st, fun);
+    if (dict_count(lam->env) > 0) {
+        fprintf(st->f, "\tstruct __ell_env_%u *__ell_env = (struct __ell_env_%u *)"
+                "((struct ell_clo_data *) __ell_clo->data)->env;\n", lam->code_id, lam->code_id);
     }
-    if (!lam->params->rest) {
-        fprintf(st->f, "\tif (__ell_npos > %lu) { ell_arity_error(); }\n", nreq + nopt);
+    ellc_emit_ir_blocks(st, fun);
+    fprintf(st->f, "}\n");
+    // static closure
+    if (dict_count(lam->env) == 0) {
+        fprintf(st->f, "static struct ell_clo_data __ell_clo_data_%u = { &__ell_code_%u, NULL };\n",
+                lam->code_id, lam->code_id);
+        fprintf(st->f, "static struct ell_obj __ell_clo_%u = { NULL, &__ell_clo_data_%u };\n",
+                lam->code_id, lam->code_id);
     }
-    
-    unsigned i = 0;
+}
 
-    // required
+/* A lifted lambda takes its required arguments, followed by its
+   free variables, which are put into a local environment, so that
+   they can be accessed as usual. */
+static void
+ellc_emit_lifted_code(struct ellc_st *st, struct ellc_ir_fun *fun)
+{
+    struct ellc_ast_lam *lam = fun->lam;
+    fprintf(st->f, "static struct ell_obj *__ell_lifted_%u(", lam->code_id);
+    unsigned i = 0;
     for (lnode_t *n = list_first(lam->params->req); n; n = list_next(lam->params->req, n)) {
-        struct ellc_param *p = (struct ellc_param *) lnode_get(n);
-        fprintf(st->f, "\tvoid *%s = ", ellc_mangle_param_id(p->id));
-        ellc_emit_req_param_val(st, p, i);
-        fprintf(st->f, ";\n");
+        fprintf(st->f, "%sstruct ell_obj *__ell_arg_%u", (i ? ", " : ""), i);
         i++;
     }
-
-    // optional
-    for (lnode_t *n = list_first(lam->params->opt); n; n = list_next(lam->params->opt, n)) {
-        struct ellc_param *p = (struct ellc_param *) lnode_get(n);
-        fprintf(st->f, "\tvoid *%s = ", ellc_mangle_param_id(p->id));
-        ellc_emit_opt_param_val(st, p, i);
-        fprintf(st->f, ";\n");
+    for (dnode_t *en = dict_first(lam->env); en; en = dict_next(lam->env, en)) {
+        struct ellc_id *env_id = (struct ellc_id *) dnode_getkey(en);
+        fprintf(st->f, "%svoid *%s", (i ? ", " : ""), ellc_mangle_env_id(env_id));
         i++;
     }
-
-    // rest
-    if (lam->params->rest) {
-        struct ellc_param *rest = lam->params->rest;
-        fprintf(st->f, "\tstruct ell_obj *__ell_rest_tmp = ell_make_lst();\n");;
-        fprintf(st->f, "\tfor (int __ell_rest_i = %lu; __ell_rest_i < __ell_npos; __ell_rest_i++)\n",
-                nreq + nopt);
-        fprintf(st->f, "\t\tELL_SEND(__ell_rest_tmp, add, __ell_args[__ell_rest_i]);\n");
-        char *mid = ellc_mangle_param_id(rest->id);
-        if (ellc_param_boxed(rest)){
-            fprintf(st->f, "\tvoid *%s = ell_make_box(__ell_rest_tmp);\n", mid);
-        } else {
-            fprintf(st->f, "\tvoid *%s = __ell_rest_tmp;\n", mid);
+    fprintf(st->f, "%s) {\n", (i ? "" : "void"));
+    ellc_emit_ir_decls(st, fun);
+    if (dict_count(lam->env) > 0) {
+        fprintf(st->f, "\tstruct __ell_env_%u __ell_env_data = { ", lam->code_id);
+        for (dnode_t *en = dict_first(lam->env); en; en = dict_next(lam->env, en)) {
+            char *mid = ellc_mangle_env_id((struct ellc_id *) dnode_getkey(en));
+            fprintf(st->f, ".%s = %s, ", mid, mid);
         }
+        fprintf(st->f, "};\n");
+        fprintf(st->f, "\tstruct __ell_env_%u *__ell_env = &__ell_env_data;\n", lam->code_id);
     }
-
-    // key
-    for (lnode_t *n = list_first(lam->params->key); n; n = list_next(lam->params->key, n)) {
-        struct ellc_param *p = (struct ellc_param *) lnode_get(n);
-        fprintf(st->f, "\tvoid *%s = ", ellc_mangle_param_id(p->id));
-        ellc_emit_key_param_val(st, p);
-        fprintf(st->f, ";\n");
-    }
-
-    if (lam->params->all_keys) {
-        ell_fail("all-keys parameters not yet supported\n");
-    }
+    ellc_emit_ir_blocks(st, fun);
+    fprintf(st->f, "}\n");
 }
 
 static void
 ellc_emit_codes(struct ellc_st *st)
 {
-    unsigned code_id = 0;
-    for (lnode_t *n = list_first(st->lambdas); n; n = list_next(st->lambdas, n)) {
-        struct ellc_ast_lam *lam = (struct ellc_ast_lam *) lnode_get(n);
-        fprintf(st->f, "// CODE %u\n", code_id);
+    for (lnode_t *n = list_first(st->funs); n; n = list_next(st->funs, n)) {
+        struct ellc_ir_fun *fun = (struct ellc_ir_fun *) lnode_get(n);
+        struct ellc_ast_lam *lam = fun->lam;
+        fprintf(st->f, "// CODE %u\n", lam->code_id);
         // env
         if (dict_count(lam->env) > 0) {
-            fprintf(st->f, "struct __ell_env_%u {\n", code_id);
+            fprintf(st->f, "struct __ell_env_%u {\n", lam->code_id);
             for (dnode_t *en = dict_first(lam->env); en; en = dict_next(lam->env, en)) {
                 struct ellc_id *env_id = (struct ellc_id *) dnode_getkey(en);
                 fprintf(st->f, "\tvoid *%s;\n", ellc_mangle_env_id(env_id));
             }
             fprintf(st->f, "};\n");
         }
-        // code
-        fprintf(st->f, "static struct ell_obj *");
-        fprintf(st->f,
-                "__ell_code_%u(struct ell_obj *__ell_clo, ell_arg_ct __ell_npos, "
-                "ell_arg_ct __ell_nkey, struct ell_obj **__ell_args) {\n", code_id);
-        ellc_emit_params(st, lam);
-        if (dict_count(lam->env) > 0) {
-            fprintf(st->f, "\tstruct __ell_env_%u *__ell_env = (struct __ell_env_%u *)"
-                    "((struct ell_clo_data *) __ell_clo->data)->env;\n", code_id, code_id);
-        }
-        fprintf(st->f, "\treturn ");
-        ellc_emit_ast(st, lam->body);
-        fprintf(st->f, ";");
-        fprintf(st->f, "\n}\n");
-
-        code_id++;
+        if (fun->type == ELLC_IR_FUN_LIFTED)
+            ellc_emit_lifted_code(st, fun);
+        else
+            ellc_emit_code(st, fun);
     }
     fprintf(st->f, "\n");
 }
 
+/* Lambdas without environment are emitted as static closures, whose
+   wrappers get filled in when the unit is loaded. */
+static void
+ellc_emit_static_closures_initializations(struct ellc_st *st)
+{
+    for (lnode_t *n = list_first(st->lambdas); n; n = list_next(st->lambdas, n)) {
+        struct ellc_ast_lam *lam = (struct ellc_ast_lam *) lnode_get(n);
+        if ((dict_count(lam->env) == 0) && !lam->lifted)
+            fprintf(st->f, "\t__ell_clo_%u.wrapper = ELL_WRAPPER(clo);\n", lam->code_id);
+    }
+}
+
 static void
 ellc_emit_globals_declarations(struct ellc_st *st)
 {
@@ -1669,6 +5132,34 @@ ellc_emit_globals_declarations(struct ellc_st *st)
     }
 }
 
+static void
+ellc_emit_inline_cells_declarations(struct ellc_st *st)
+{
+    for (lnode_t *n = list_first(st->exported_inlines); n; n = list_next(st->exported_inlines, n))
+        fprintf(st->f, "__attribute__((weak)) struct ell_obj *%s;\n",
+                ((struct ellc_inline *) lnode_get(n))->cell);
+    for (lnode_t *n = list_first(st->inlined); n; n = list_next(st->inlined, n)) {
+        struct ellc_inline *in = (struct ellc_inline *) lnode_get(n);
+        fprintf(st->f, "__attribute__((weak)) struct ell_obj *%s;\n", in->cell);
+        fprintf(st->f, "static bool %s;\n", ellc_inline_flag(in));
+    }
+}
+
+/* Links are weak, so that all units share the one of the unit that
+   is loaded first. */
+static void
+ellc_emit_links_declarations(struct ellc_st *st)
+{
+    for (lnode_t *n = list_first(st->exported_links); n; n = list_next(st->exported_links, n))
+        fprintf(st->f, "__attribute__((weak)) struct ell_link %s;\n",
+                ((struct ellc_link *) lnode_get(n))->cell);
+    for (lnode_t *n = list_first(st->linked); n; n = list_next(st->linked, n)) {
+        struct ellc_link *link = (struct ellc_link *) lnode_get(n);
+        if (link->lam) continue;
+        fprintf(st->f, "__attribute__((weak)) struct ell_link %s;\n", link->cell);
+    }
+}
+
 static void
 ellc_emit_globals_initializations(struct ellc_st *st)
 {
@@ -1679,6 +5170,8 @@ ellc_emit_globals_initializations(struct ellc_st *st)
     }
 }
 
+/* Top-level C statements may only consist of literal strings, which
+   are emitted as-is. */
 static void
 ellc_emit_stmts(struct ellc_st *st)
 {
@@ -1688,31 +5181,49 @@ ellc_emit_stmts(struct ellc_st *st)
             ell_fail("statement error\n");
         }
         struct ellc_ast *body_seq = ast->stmt.body;
-        ellc_direct_emit_c_sequence(st, body_seq);
+        if (body_seq->type != ELLC_AST_SEQ) {
+            ell_fail("C output error\n");
+        }
+        list_t *exprs = body_seq->seq.exprs;
+        for (lnode_t *en = list_first(exprs); en; en = list_next(exprs, en)) {
+            struct ellc_ast *expr = (struct ellc_ast *) lnode_get(en);
+            if (expr->type != ELLC_AST_LIT_STR) {
+                ell_fail("C output error\n");
+            }
+            fprintf(st->f, "%s", ell_str_chars(expr->lit_str.str));
+        }
         fprintf(st->f, "\n");
     }
 }
 
 static void
-ellc_emit(struct ellc_st *st, struct ellc_ast_seq *ast_seq)
+ellc_emit(struct ellc_st *st)
 {
     fprintf(st->f, "#include \"ellrt.h\"\n");
     fprintf(st->f, "// GLOBALS\n");
     ellc_emit_globals_declarations(st);
+    ellc_emit_inline_cells_declarations(st);
+    ellc_emit_links_declarations(st);
+    fprintf(st->f, "// CONSTANTS\n");
+    ellc_emit_constants_declarations(st);
+    ellc_emit_slot_caches_declarations(st);
+    ellc_emit_ltvs_declarations(st);
+    fprintf(st->f, "static struct ell_obj *__ell_unit_result;\n");
     fprintf(st->f, "// STATEMENTS\n");
     ellc_emit_stmts(st);
+    ellc_emit_c_functions_declarations(st);
     fprintf(st->f, "// CODES\n");
     ellc_emit_codes(st);
+    fprintf(st->f, "struct ell_obj *" ELLC_UNIT_RESULT_FUN "() { return __ell_unit_result; }\n");
     fprintf(st->f, "// CONSTRUCTOR\n");
     fprintf(st->f, "__attribute__((constructor(500))) static void ell_init() {\n");
+    ellc_emit_ir_decls(st, st->init_fun);
     fprintf(st->f, "\t// INITIALIZATIONS\n");
+    ellc_emit_constants_initializations(st);
+    ellc_emit_static_closures_initializations(st);
     ellc_emit_globals_initializations(st);
     fprintf(st->f, "\t// LOAD\n");
-    for (lnode_t *n = list_first(ast_seq->exprs); n; n = list_next(ast_seq->exprs, n)) {
-        fprintf(st->f, "\tell_result = ");
-        ellc_emit_ast(st, (struct ellc_ast *) lnode_get(n));
-        fprintf(st->f, ";\n");
-    }
+    ellc_emit_ir_blocks(st, st->init_fun);
     fprintf(st->f, "}\n");
 }
 
@@ -1724,11 +5235,27 @@ ellc_make_st(FILE *f)
     struct ellc_st *st = (struct ellc_st *) ell_alloc(sizeof(*st));
     st->f = f;
     st->stmts = ell_util_make_list();
+    st->bound_globals = ell_util_make_list();
+    st->hoisted_globals = ell_util_make_list();
     st->defined_globals = ell_util_make_list();
     st->defined_macros = ell_util_make_dict((dict_comp_t) &ell_sym_cmp);
     st->globals = ell_util_make_list();
     st->lambdas = ell_util_make_list();
+    st->funs = ell_util_make_list();
+    st->inline_decls = ell_util_make_list();
+    st->exported_inlines = ell_util_make_list();
+    st->inlined = ell_util_make_list();
+    st->inlining = ell_util_make_list();
+    st->exported_links = ell_util_make_list();
+    st->linked = ell_util_make_list();
+    st->make_caches = ell_util_make_list();
+    st->ltv_inits = ell_util_make_list();
+    st->c_functions = ell_util_make_dict((dict_comp_t) &ell_sym_cmp);
+    st->c_calls = ell_util_make_list();
+    st->constants = ell_util_make_dict((dict_comp_t) &ellc_constant_cmp);
+    st->safety = 1;
     st->bottom_contour = NULL;
+    st->captures = ell_util_make_list();
     return st;
 }
 
@@ -1757,8 +5284,14 @@ ellc_compile(struct ell_obj *stx_lst, struct ellc_st **st_out)
     
     struct ellc_st *st = ellc_make_st(f);
     struct ellc_ast_seq *ast_seq = ellc_norm(st, stx_lst);
+    ellc_fold(st, ast_seq);
+    ellc_export(st, ast_seq);
     ellc_conv(st, ast_seq);
-    ellc_emit(st, ast_seq);
+    ellc_infer(st, ast_seq);
+    ellc_elide(st, ast_seq);
+    ellc_lower(st, ast_seq);
+    ellc_ir_opt(st);
+    ellc_emit(st);
     
     if (fclose(f) != 0) {
         ell_fail("cannot close temp file\n");
@@ -1796,9 +5329,13 @@ int
 ellc_compile_file(char *infile, char *faslfile, char *cfaslfile)
 {
     freopen(infile, "r", stdin);
+    return ellc_compile_unit(ell_parse(), faslfile, cfaslfile);
+}
 
+int
+ellc_compile_unit(struct ell_obj *stx_lst, char *faslfile, char *cfaslfile)
+{
     struct ellc_st *st;
-    struct ell_obj* stx_lst = ell_parse();
     char *tmp_fasl_name = ellc_compile(stx_lst, &st);
 
     // CROOK AHEAD
@@ -1818,6 +5355,54 @@ ellc_compile_file(char *infile, char *faslfile, char *cfaslfile)
         ELL_SEND(macros_stx_lst, add, macro_stx);
     }
     
+    for (lnode_t *n = list_first(st->bound_globals); n; n = list_next(st->bound_globals, n)) {
+        struct ellc_id *id = (struct ellc_id *) lnode_get(n);
+        if (id->cx != NULL) continue;
+        struct ell_obj *note_stx = ell_make_stx_lst();
+        struct ell_obj *quote_stx = ell_make_stx_lst();
+        ELL_SEND(quote_stx, add, ell_make_stx_sym(ELL_SYM(core_quote)));
+        ELL_SEND(quote_stx, add, ell_make_stx_sym(id->sym));
+
+        ELL_SEND(note_stx, add,
+                 ell_make_stx_sym(ell_intern(ell_make_str("compiler-note-defined"))));
+        ELL_SEND(note_stx, add, quote_stx);
+        ELL_SEND(note_stx, add, ell_make_stx_num(ell_make_num_from_int(id->ns)));
+        ELL_SEND(macros_stx_lst, add, note_stx);
+    }
+
+    list_t *exported = st->exported_inlines;
+    for (lnode_t *n = list_first(exported); n; n = list_next(exported, n)) {
+        struct ellc_inline *in = (struct ellc_inline *) lnode_get(n);
+        struct ell_obj *inline_stx = ell_make_stx_lst();
+        struct ell_obj *quote_stx = ell_make_stx_lst();
+        ELL_SEND(quote_stx, add, ell_make_stx_sym(ELL_SYM(core_quote)));
+        ELL_SEND(quote_stx, add, ell_make_stx_sym(in->id->sym));
+        struct ell_obj *syntax_stx = ell_make_stx_lst();
+        ELL_SEND(syntax_stx, add, ell_make_stx_sym(ELL_SYM(core_quasisyntax)));
+        ELL_SEND(syntax_stx, add, in->stx);
+
+        ELL_SEND(inline_stx, add,
+                 ell_make_stx_sym(ell_intern(ell_make_str("compiler-put-inline"))));
+        ELL_SEND(inline_stx, add, quote_stx);
+        ELL_SEND(inline_stx, add, syntax_stx);
+        ELL_SEND(inline_stx, add, ell_make_stx_str(ell_make_str(in->cell)));
+        ELL_SEND(macros_stx_lst, add, inline_stx);
+    }
+
+    list_t *links = st->exported_links;
+    for (lnode_t *n = list_first(links); n; n = list_next(links, n)) {
+        struct ellc_link *link = (struct ellc_link *) lnode_get(n);
+        struct ell_obj *link_stx = ell_make_stx_lst();
+        struct ell_obj *quote_stx = ell_make_stx_lst();
+        ELL_SEND(quote_stx, add, ell_make_stx_sym(ELL_SYM(core_quote)));
+        ELL_SEND(quote_stx, add, ell_make_stx_sym(link->id->sym));
+
+        ELL_SEND(link_stx, add,
+                 ell_make_stx_sym(ell_intern(ell_make_str("compiler-put-link"))));
+        ELL_SEND(link_stx, add, quote_stx);
+        ELL_SEND(macros_stx_lst, add, link_stx);
+    }
+
     char *tmp_cfasl_name = ellc_compile(macros_stx_lst, NULL);
     
     if (rename(tmp_fasl_name, faslfile) != 0)
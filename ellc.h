@@ -15,12 +15,32 @@ Syntax object (only core forms)
     | Normalization (`ellc_norm_stx()')
     V
 Normal form AST
+    |
+    | Optimization (`ellc_fold()')
+    V
+Simplified normal form AST
     |
     | (Closure) Conversion (`ellc_conv_ast()')
     V
 Explicit form AST
     |
-    | Emission (`ellc_emit_ast')
+    | Type inference (`ellc_infer()')
+    V
+Explicit form AST, with unboxed locals
+    |
+    | Unbound check elision (`ellc_elide()')
+    V
+Explicit form AST, with bound globals marked
+    |
+    | Lowering (`ellc_lower()')
+    V
+IR: basic blocks of instructions on temporaries
+    |
+    | IR optimization (`ellc_ir_opt()')
+    V
+Simplified IR
+    |
+    | Emission (`ellc_emit()')
     V
 C text
 */
@@ -34,6 +54,8 @@ struct ellc_id;
 struct ellc_ast;
 struct ellc_params;
 struct ellc_args;
+struct ellc_ir_block;
+struct ellc_ir_fun;
 
 /**** Normal Form ****/
 
@@ -83,12 +105,34 @@ struct ellc_ast_app {
    .code_id: Sequence number of lambda in compilation unit, for
    linking the closure to its generated C function.  Corresponds to
    offset of lambda in compilation state's list of lambdas from the
-   current compilation unit. */
+   current compilation unit.
+   .inlined: Set during closure conversion for lambdas that are
+   directly applied to matching arguments, as in LET.  Such lambdas
+   don't get a C function, their parameters become C locals of the
+   enclosing function.
+   .stack: Set during closure conversion for lambdas that are passed
+   to a known function that doesn't let them escape, such as BLOCK/F.
+   Their closures and environments are allocated on the C stack of
+   the enclosing function.
+   .lifted: Set during closure conversion for lambdas that are bound
+   by an inlined lambda and only ever called directly, with matching
+   arguments.  Such lambdas don't get a closure, they become static C
+   functions that take their free variables as additional arguments.
+   .safety: Safety level from 0 to 3, set during normalization from
+   the enclosing lambda or the unit, unless the lambda's body declares
+   its own (see `ellc_norm_declare').  At safety 0, the code of the
+   lambda doesn't check its arity, the unbound checks of globals and
+   the function checks of calls are omitted, and values declared to be
+   integers are unboxed without a type check. */
 struct ellc_ast_lam {
     struct ellc_params *params;
     struct ellc_ast *body;
     dict_t *env;
     unsigned code_id;
+    bool inlined;
+    bool stack;
+    bool lifted;
+    int safety;
 };
 
 /* Checks whether identifier names a defined global variable.
@@ -97,11 +141,54 @@ struct ellc_ast_defp {
     struct ellc_id *id;
 };
 
-/* Infinite loop. */
+/* Loop, infinite unless there is a test.
+   .hoisted: Global variables whose unbound checks are done in the
+   first iteration, populated during unbound check elision.  If
+   non-NULL, the first iteration is lowered separately ("peeled"),
+   and the remaining iterations access these variables unchecked. */
 struct ellc_ast_loop {
+    struct ellc_ast *test; // maybe NULL
+    struct ellc_ast *body;
+    list_t *hoisted; // id, maybe NULL
+};
+
+/* Dynamic binding of a global variable for the extent of body.
+   During closure conversion, the identifier gets resolved to a
+   global variable (see `ELL_GEN_DLET_BIND' in `ellrt.h'). */
+struct ellc_ast_dlet {
+    struct ellc_id *id;
+    struct ellc_ast *val;
     struct ellc_ast *body;
 };
 
+/* Type declaration of an expression's value, produced by THE.  Only
+   <integer> is understood, other types are dropped during
+   normalization.  The value is checked, unless the safety level is 0. */
+struct ellc_ast_the {
+    struct ell_obj *type; // class symbol
+    struct ellc_ast *expr;
+};
+
+/* Load-time value: a static variable of the unit, set by the
+   initialization of the value with its expression, which gets
+   evaluated once when the unit is loaded, just before the top-level
+   form containing the LOAD-TIME-VALUE.  References have no .init. */
+struct ellc_ast_ltv {
+    unsigned index;
+    struct ellc_ast *init;
+};
+
+/* Direct call of a C function declared with DEFINE-C-FUNCTION.  The
+   types are class symbols: <integer> (int), <boolean> (int), <string>
+   (const char * parameter, char * result), <object> (struct ell_obj
+   *), and <unspecified> (void, as result only). */
+struct ellc_ast_ccall {
+    struct ell_obj *name; // str
+    list_t *param_types; // sym
+    struct ell_obj *result_type; // sym
+    list_t *args; // ast
+};
+
 /* Literal symbol, produced by QUOTE. */
 struct ellc_ast_lit_sym {
     struct ell_obj *sym;
@@ -148,13 +235,18 @@ struct ellc_ast_stmt {
    environment variables of superordinate functions.  Every reference
    or update gets transformed to one of the following AST nodes: */
 
+/* References and updates of global variables are checked for unbound
+   variables, unless unbound check elision finds that the variable is
+   known to be bound at that point (.bound). */
 struct ellc_ast_glo_ref {
     struct ellc_id *id;
+    bool bound;
 };
 
 struct ellc_ast_glo_set {
     struct ellc_id *id;
     struct ellc_ast *val;
+    bool bound;
 };
 
 struct ellc_ast_arg_ref {
@@ -190,6 +282,10 @@ enum ellc_ast_type {
     ELLC_AST_CX   = 10,
     ELLC_AST_SNIP = 11,
     ELLC_AST_STMT = 12,
+    ELLC_AST_DLET = 13,
+    ELLC_AST_THE  = 14,
+    ELLC_AST_LTV  = 15,
+    ELLC_AST_CCALL = 16,
 
     ELLC_AST_GLO_REF = 101,
     ELLC_AST_GLO_SET = 102,
@@ -219,6 +315,10 @@ struct ellc_ast {
         struct ellc_ast_cx cx;
         struct ellc_ast_snip snip;
         struct ellc_ast_stmt stmt;
+        struct ellc_ast_dlet dlet;
+        struct ellc_ast_the the;
+        struct ellc_ast_ltv ltv;
+        struct ellc_ast_ccall ccall;
 
         struct ellc_ast_glo_ref glo_ref;
         struct ellc_ast_glo_set glo_set;
@@ -268,17 +368,45 @@ struct ellc_params {
     struct ellc_param *all_keys; // maybe NULL
 };
 
+/* Static types of expressions and locals, see `ellc_infer()'. */
+enum ellc_type {
+    ELLC_TYPE_OBJ = 0,    // any object
+    ELLC_TYPE_NONE = 1,   // no value yet, only during inference
+    ELLC_TYPE_FIXNUM = 2, // integer, unboxed as C int
+    ELLC_TYPE_BOOL = 3,   // boolean, unboxed as C condition
+};
+
 /* A single parameter.  Optional and keyword parameters may have an
    initialization form that's used when the parameter is not supplied.
    During closure conversion, it is determined whether the parameter
    is potentially updated (mutable), and whether it is referenced or
    updated in subordinate lambdas (closed).  Parameters that are both
-   mutable and closed are put into heap allocated boxes. */
+   mutable and closed are put into boxes.  The box is allocated on
+   the heap if the parameter is captured by a lambda whose closure may
+   escape (escaping), otherwise on the C stack.  Parameters that are
+   never referenced are noted, so that &rest lists need not be
+   materialized for them.  Type inference may determine a type for
+   parameters of inlined lambdas that aren't closed, which are then
+   kept unboxed.  For parameters of inlined lambdas bound to a lambda
+   with only required parameters, .lam is that lambda, and references
+   and direct calls are counted to find lambdas that can be lifted.
+   Required parameters can also be declared to have a type (.declared),
+   which they then get unless they're closed over, or their lambda is
+   lifted.  During lowering, .narrowed is the type of an immutable
+   parameter within the consequent of a TYPE? test. */
 struct ellc_param {
     struct ellc_id *id;
     struct ellc_ast *init; // maybe NULL
     bool mutable;
     bool closed;
+    bool escaping;
+    bool referenced;
+    struct ellc_ast_lam *lam; // maybe NULL
+    unsigned nrefs;
+    unsigned ncalls;
+    enum ellc_type type;
+    enum ellc_type narrowed;
+    enum ellc_type declared;
 };
 
 /* The arguments to a function call. */
@@ -287,6 +415,135 @@ struct ellc_args {
     dict_t key; // sym -> ast
 };
 
+/**** Intermediate Representation ****/
+
+/* The explicit form AST is lowered into this representation, from
+   which C code is then emitted.  Every lambda that's not inlined, and
+   the top-level of the unit, becomes an IR function: a list of basic
+   blocks, each a list of instructions operating on temporaries, and
+   ending with a jump, branch, or return.  Every temporary is assigned
+   by a single instruction, except for the result of a conditional,
+   which is assigned at the end of each branch (where SSA would use a
+   phi function).
+
+   Lisp variables, boxes, closure environments and dynamic bindings
+   are accessed by explicit instructions.  Non-local exits are done by
+   the runtime (`block/f'), so they are just calls here. */
+
+enum ellc_ir_opnd_type {
+    ELLC_IR_OPND_TMP   = 1, // temporary
+    ELLC_IR_OPND_CONST = 2, // object from the constant pool
+    ELLC_IR_OPND_C     = 3, // C expression, e.g. ell_unspecified or 42
+};
+
+/* Operand of an instruction. */
+struct ellc_ir_opnd {
+    enum ellc_ir_opnd_type type;
+    __extension__ union {
+        unsigned tmp;
+        struct ell_obj *obj;
+        char *c;
+    };
+};
+
+enum ellc_ir_insn_type {
+    ELLC_IR_MOVE        = 1,  // dst = arg
+    ELLC_IR_PRIM        = 2,  // dst = name(args), or just name(args)
+    ELLC_IR_GLO_REF     = 3,  // dst = global
+    ELLC_IR_GLO_SET     = 4,  // global = arg
+    ELLC_IR_DEF         = 5,  // global = arg, without unbound check
+    ELLC_IR_VAR_INIT    = 6,  // binds local to arg, boxing it if needed
+    ELLC_IR_VAR_REF     = 7,  // dst = local
+    ELLC_IR_VAR_SET     = 8,  // local = arg
+    ELLC_IR_ENV_REF     = 9,  // dst = closed over variable
+    ELLC_IR_ENV_SET     = 10, // closed over variable = arg
+    ELLC_IR_CALL        = 11, // dst = function(args), function is first arg
+    ELLC_IR_LIFTED_CALL = 12, // dst = lifted function(args, free variables)
+    ELLC_IR_CLO         = 13, // dst = closure of lambda
+    ELLC_IR_LIFT_ENV    = 14, // saves free variables of lifted lambda
+    ELLC_IR_DLET_BIND   = 15, // dynamically binds global to arg
+    ELLC_IR_DLET_UNBIND = 16, // restores global
+    ELLC_IR_MAKE_CX     = 17, // creates new hygiene context
+    ELLC_IR_SNIP        = 18, // dst = C snippet, args are its pieces
+    ELLC_IR_RESULT      = 19, // sets result of loading unit to arg
+
+    ELLC_IR_JUMP        = 101,
+    ELLC_IR_BRANCH      = 102, // to then block if arg is true, else to else block
+    ELLC_IR_RETURN      = 103,
+};
+
+/* Instruction.  Pure instructions may be removed if their result is
+   not used. */
+struct ellc_ir_insn {
+    enum ellc_ir_insn_type type;
+    struct ellc_ir_opnd *dst; // tmp, maybe NULL
+    list_t *args; // opnd
+    __extension__ union {
+        struct {
+            char *name;
+            bool pure;
+        } prim;
+        struct {
+            struct ellc_id *id;
+            bool bound;
+        } glo;
+        struct {
+            struct ellc_id *id;
+            unsigned index;
+        } dlet;
+        struct ellc_param *param;
+        struct ellc_ast_lam *lam;
+        struct {
+            list_t *keys; // sym, for keyword arguments
+            struct ellc_link *link; // maybe NULL
+            bool unchecked; // function known to be a closure
+        } call;
+        unsigned cx;
+        struct {
+            struct ellc_ir_block *then_block;
+            struct ellc_ir_block *else_block; // NULL for jumps
+        } br;
+    };
+};
+
+struct ellc_ir_block {
+    unsigned id;
+    list_t *insns; // insn
+};
+
+enum ellc_ir_fun_type {
+    ELLC_IR_FUN_CODE   = 1, // code of closure
+    ELLC_IR_FUN_LIFTED = 2, // lifted lambda
+    ELLC_IR_FUN_INIT   = 3, // top-level of unit
+};
+
+/* Function.
+   .tmps: Type of each temporary.
+   .locals: C names of the parameters of the lambda and of its
+   inlined lambdas.  Since locals are declared at the top of the C
+   function, they get unique names, even if their IDs are shadowed.
+   .clos, .lifted: Lambdas whose environments are populated inside the
+   function, needing storage declared at the top of the C function.
+   .cx: Number of the current hygiene context, or -1 if outside a
+   quasisyntax, during lowering.
+   .safety: Safety level of the code currently being lowered, which
+   changes inside the bodies of inlined lambdas. */
+struct ellc_ir_fun {
+    enum ellc_ir_fun_type type;
+    struct ellc_ast_lam *lam; // NULL for top-level
+    list_t *blocks; // block, first is entry
+    list_t *tmps; // type
+    dict_t *locals; // param -> char *
+    list_t *clos; // lam
+    list_t *lifted; // lam
+    unsigned nblocks;
+    unsigned ndlets;
+    unsigned ncxs;
+    struct ellc_ir_block *cur;
+    int cx;
+    int safety;
+};
+
 /**** Compiler State ****/
 
 /* Compiler state, as opposed to compilation state, is maintained
@@ -307,6 +564,56 @@ struct ellc_args {
    the compiler process. */
 static dict_t ellc_mac_tab; // sym -> clo
 
+/* Table of global variables defined by previously compiled units.
+   The CFASL of a unit records the globals the unit defines at its
+   top-level, and loading the CFASL at compile-time populates this
+   table.  Like with macros, loading a unit's CFASL amounts to a
+   promise that the unit's FASL gets loaded before the units compiled
+   against it, so the globals are known to be bound, and their unbound
+   checks can be elided.  The table starts out with the globals that
+   the runtime binds at startup (see `ellc_builtin_globals'). */
+static dict_t ellc_defined_tab; // id -> id
+
+/* A small global function, declared inline, that can be inlined into
+   other units.
+   .stx: The function's lambda, with its folded normal form AST
+   written back as syntax consisting only of special forms, so that
+   normalizing it again in another unit doesn't depend on the macros
+   visible there.
+   .cell: C name of a cell that the defining unit sets to the
+   function's closure when it defines it.  The name includes a hash
+   of the syntax, so units that inline the function can check at
+   load-time that the global still holds a closure of exactly this
+   lambda, and call the function through the global if it doesn't. */
+struct ellc_inline {
+    struct ellc_id *id;
+    struct ell_obj *stx;
+    char *cell;
+    struct ellc_ast_lam *lam; // in defining unit only
+};
+
+/* Table of global functions exported for inlining by previously
+   compiled units.  Populated by loading their CFASLs. */
+static dict_t ellc_inline_tab; // sym -> inline
+
+/* A top-level function whose code other units can call directly.
+   .cell: C name of the function's link (see `ell_link'), which is
+   named after the function's ID, and which every unit defining the
+   function sets to the function's closure and code whenever it
+   defines the function.  Callers check that the global still holds
+   the link's closure before calling its code, and otherwise call the
+   global as usual.  Since a redefinition by another unit patches the
+   same link, calls linked to the old definition stay direct. */
+struct ellc_link {
+    struct ellc_id *id;
+    char *cell;
+    struct ellc_ast_lam *lam; // last definition, in defining unit only
+};
+
+/* Table of global functions exported for direct calls by previously
+   compiled units.  Populated by loading their CFASLs. */
+static dict_t ellc_link_tab; // sym -> link
+
 /**** Compilation State ****/
 
 /* Compilation state, as opposed to compiler state, is reset between
@@ -319,6 +626,14 @@ struct ellc_contour {
     struct ellc_contour *up; // maybe NULL
 };
 
+/* Capture of a variable by a lambda whose closure may escape, unless
+   the lambda turns out to be lifted, which is only known after its
+   body has been converted. */
+struct ellc_capture {
+    struct ellc_param *param;
+    struct ellc_ast_lam *lam;
+};
+
 /* Compilation state, maintained during the compilation of a unit. */
 struct ellc_st {
     /*** Static data extracted from unit by passes. ***/
@@ -334,21 +649,89 @@ struct ellc_st {
     /* Lambdas in the compilation unit.  Populated during closure
        conversion. */
     list_t *lambdas; // lam
+    /* Constant pool: literal symbols, strings, and numbers in the
+       compilation unit, mapped to their sequence numbers.  Populated
+       during closure conversion. */
+    dict_t *constants; // obj -> index
     /* Top-level C statements. */
     list_t *stmts; // ast
+    /* IR functions of the lambdas in the compilation unit (in the
+       same order as `lambdas'), and of the unit's top-level.
+       Populated during lowering. */
+    list_t *funs; // ir_fun
+    struct ellc_ir_fun *init_fun;
+    /* Global variables known to be bound at the current point during
+       unbound check elision.  Afterwards, the globals known to be
+       bound after the unit has been loaded. */
+    list_t *bound_globals; // id
+    /* Names of the functions declared inline at the top-level of the
+       compilation unit.  Populated during normalization. */
+    list_t *inline_decls; // sym
+    /* Top-level functions of the compilation unit that are declared
+       inline, and exported for inlining into other units.  Populated
+       after optimization. */
+    list_t *exported_inlines; // inline
+    /* Functions of other units that have been inlined into the
+       compilation unit, and need a load-time check.  Populated
+       during optimization. */
+    list_t *inlined; // inline
+    /* Top-level functions of the compilation unit that are exported
+       for direct calls.  Populated after optimization. */
+    list_t *exported_links; // link
+    /* Functions called directly by the compilation unit.  Populated
+       during lowering. */
+    list_t *linked; // link
+    /* Number of inline caches of open-coded slot accesses.
+       Populated during lowering. */
+    unsigned nslot_caches;
+    /* Number of slots initialized by each open-coded MAKE, in the
+       order of their caches.  Populated during lowering. */
+    list_t *make_caches; // unsigned
+    /* Number of load-time values.  Populated during normalization. */
+    unsigned nltvs;
+    /* C functions declared in the compilation unit, whose calls are
+       open-coded like those of inlined functions.  Populated during
+       normalization. */
+    dict_t *c_functions; // sym -> inline
+    /* C functions called directly by the compilation unit, one call
+       per function, whose prototypes get emitted.  Populated during
+       lowering. */
+    list_t *c_calls; // ast
     /*** Dynamic data used during passes. ***/
+    /* Safety level of top-level lambdas that don't declare their
+       own.  Set by top-level declarations during normalization, for
+       the lambdas that follow them. */
+    int safety;
     /* Lexical contour during normalization and closure conversion. */
     struct ellc_contour *bottom_contour; // maybe NULL
-    /* Whether we are inside a quasisyntax (during emission), for
-       hygiene condition. */
-    bool in_quasisyntax;
+    /* Captures of variables during closure conversion, from which
+       escaping variables are determined at its end. */
+    list_t *captures; // capture
+    /* Initializations of the load-time values in the top-level form
+       being normalized, which get placed before it. */
+    list_t *ltv_inits; // ast
+    /* Functions of other units whose bodies are currently being
+       inlined, to stop the inlining of mutually recursive ones. */
+    list_t *inlining; // inline
+    /* Global variables whose unbound checks have been hoisted out of
+       the loops currently being lowered. */
+    list_t *hoisted_globals; // id
     /* The output file for C code during emission. */
     FILE *f;
 };
 
 /**** API ****/
 
+/* Every unit exports a function with this name, which returns the
+   value of the unit's last top-level form. */
+#define ELLC_UNIT_RESULT_FUN "ell_unit_result"
+
 int
 ellc_compile_file(char *infile, char *faslfile, char *cfaslfile);
 
+/* Compiles the top-level forms in the syntax list as a unit, like
+   `ellc_compile_file' does with the forms parsed from a file. */
+int
+ellc_compile_unit(struct ell_obj *stx_lst, char *faslfile, char *cfaslfile);
+
 #endif
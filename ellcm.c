@@ -3,10 +3,164 @@
 #include <dlfcn.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #include "ellcm.h"
 
+/* Syntax is passed to the compilation process as a file of records,
+   one per syntax object, so that the hygiene contexts of syntax
+   symbols survive the trip:
+
+     ( count      syntax list, followed by its count elements
+     Y len chars cx   syntax symbol, cx is a context's UUID or -
+     S len chars  syntax string
+     N int        syntax number
+
+   Names and strings are written with their length, so they need no
+   escaping.  Symbols, strings, integers and booleans inserted into
+   syntax lists by unsyntax are written as syntax without context. */
+
+static bool
+ellcm_write_stx(FILE *f, struct ell_obj *stx)
+{
+    if (stx->wrapper == ELL_WRAPPER(stx_lst)) {
+        list_t *elts = ell_stx_lst_elts(stx);
+        fprintf(f, "( %lu\n", (unsigned long) list_count(elts));
+        for (lnode_t *n = list_first(elts); n; n = list_next(elts, n)) {
+            if (!ellcm_write_stx(f, (struct ell_obj *) lnode_get(n)))
+                return false;
+        }
+        return true;
+    } else if ((stx->wrapper == ELL_WRAPPER(stx_sym)) || (stx->wrapper == ELL_WRAPPER(sym))
+               || (stx == ell_t) || (stx == ell_f)) {
+        struct ell_obj *sym;
+        struct ell_cx *cx = NULL;
+        if (stx->wrapper == ELL_WRAPPER(stx_sym)) {
+            sym = ell_stx_sym_sym(stx);
+            cx = ell_stx_sym_cx(stx);
+        } else if (stx->wrapper == ELL_WRAPPER(sym)) {
+            sym = stx;
+        } else {
+            sym = (stx == ell_t) ? ELL_SYM(prim_t) : ELL_SYM(prim_f);
+        }
+        struct ell_obj *name = ell_sym_name(sym);
+        fprintf(f, "Y %lu ", (unsigned long) ell_str_len(name));
+        fwrite(ell_str_chars(name), 1, ell_str_len(name), f);
+        if (cx) {
+            char uuid[37];
+            uuid_unparse(cx->uuid, uuid);
+            fprintf(f, " %s\n", uuid);
+        } else {
+            fprintf(f, " -\n");
+        }
+        return true;
+    } else if ((stx->wrapper == ELL_WRAPPER(stx_str)) || (stx->wrapper == ELL_WRAPPER(str))) {
+        struct ell_obj *str = (stx->wrapper == ELL_WRAPPER(str)) ? stx : ell_stx_str_str(stx);
+        fprintf(f, "S %lu ", (unsigned long) ell_str_len(str));
+        fwrite(ell_str_chars(str), 1, ell_str_len(str), f);
+        fprintf(f, "\n");
+        return true;
+    } else if ((stx->wrapper == ELL_WRAPPER(stx_num)) || (stx->wrapper == ELL_WRAPPER(num_int))) {
+        struct ell_obj *num = (stx->wrapper == ELL_WRAPPER(num_int)) ? stx : ell_stx_num_num(stx);
+        fprintf(f, "N %d\n", ell_num_int(num));
+        return true;
+    } else {
+        return false;
+    }
+}
+
+static char *
+ellcm_read_chars(FILE *f, unsigned long len)
+{
+    char *chars = (char *) ell_alloc(len + 1);
+    if (fread(chars, 1, len, f) != len) {
+        ell_fail("syntax read error\n");
+    }
+    chars[len] = '\0';
+    return chars;
+}
+
+static struct ell_obj *
+ellcm_read_stx(FILE *f)
+{
+    char tag;
+    unsigned long len;
+    int i;
+    if (fscanf(f, " %c", &tag) != 1) {
+        ell_fail("syntax read error\n");
+    }
+    if (tag == '(') {
+        if (fscanf(f, "%lu", &len) != 1) {
+            ell_fail("syntax read error\n");
+        }
+        struct ell_obj *stx_lst = ell_make_stx_lst();
+        for (unsigned long j = 0; j < len; j++) {
+            ELL_SEND(stx_lst, add, ellcm_read_stx(f));
+        }
+        return stx_lst;
+    } else if ((tag == 'Y') || (tag == 'S')) {
+        if ((fscanf(f, "%lu", &len) != 1) || (fgetc(f) != ' ')) {
+            ell_fail("syntax read error\n");
+        }
+        char *chars = ellcm_read_chars(f, len);
+        if (tag == 'S') {
+            return ell_make_stx_str(ell_make_strn(chars, len));
+        }
+        char uuid[37];
+        if (fscanf(f, " %36s", uuid) != 1) {
+            ell_fail("syntax read error\n");
+        }
+        struct ell_cx *cx = NULL;
+        if (strcmp(uuid, "-") != 0) {
+            cx = (struct ell_cx *) ell_alloc(sizeof(*cx));
+            if (uuid_parse(uuid, cx->uuid) != 0) {
+                ell_fail("syntax read error\n");
+            }
+        }
+        return ell_make_stx_sym_cx(ell_intern(ell_make_strn(chars, len)), cx);
+    } else if (tag == 'N') {
+        if (fscanf(f, "%d", &i) != 1) {
+            ell_fail("syntax read error\n");
+        }
+        return ell_make_stx_num(ell_make_num_from_int(i));
+    } else {
+        ell_fail("syntax read error\n");
+    }
+}
+
+/* Compiles a form written by `ellcm_write_stx' in a child process,
+   so that an error while compiling it gets reported to the client
+   instead of taking down the server.  As a consequence, definitions
+   made while compiling the form don't outlive its compilation. */
+static int
+ellcm_server_compile_stx(struct ellcm_tx *tx)
+{
+    pid_t pid = fork();
+    if (pid < 0) {
+        ell_fail("fork error\n");
+    }
+    if (pid == 0) {
+        FILE *in = fopen(tx->data.compile.infile, "r");
+        if (!in) {
+            ell_fail("cannot open syntax file\n");
+        }
+        struct ell_obj *stx_lst = ell_make_stx_lst();
+        ELL_SEND(stx_lst, add, ellcm_read_stx(in));
+        fclose(in);
+        int status = ellc_compile_unit(stx_lst,
+                                       tx->data.compile.faslfile,
+                                       tx->data.compile.cfaslfile);
+        fflush(stdout);
+        _exit(status);
+    }
+    int status;
+    if (waitpid(pid, &status, 0) != pid) {
+        ell_fail("wait error\n");
+    }
+    return (WIFEXITED(status) && (WEXITSTATUS(status) == 0)) ? 0 : 1;
+}
+
 void
 ellcm_server_process(int sd, struct ellcm_tx *tx)
 {
@@ -16,6 +170,9 @@ ellcm_server_process(int sd, struct ellcm_tx *tx)
         rx.status = ellc_compile_file(tx->data.compile.infile,
                                       tx->data.compile.faslfile,
                                       tx->data.compile.cfaslfile);
+    } else if (tx->type == ELLCM_COMPILE_STX) {
+        fflush(stdout);
+        rx.status = ellcm_server_compile_stx(tx);
     } else if (tx->type == ELLCM_LOAD) {
         fflush(stdout);
         dlerror();
@@ -65,6 +222,81 @@ ellcm_server(int sd)
     }
 }
 
+static int
+ellcm_compile(struct ellcm *cm, int type, char *infile, char *faslfile, char *cfaslfile);
+
+/* Signals a <compile-error> about the form with the bootstrap's
+   `error', so that it can be handled like any other error. */
+
+struct ell_obj *__ell_g_LcompileDerrorG_1_;
+struct ell_obj *__ell_g_error_2_;
+
+static struct ell_obj *
+ellcm_compile_error(struct ell_obj *form)
+{
+    struct ell_obj *condition =
+        ell_make_instance(ell_class_wrapper(__ell_g_LcompileDerrorG_1_));
+    ell_set_slot_value(condition, ell_intern(ell_make_str("form")), form);
+    return ELL_CALL(__ell_g_error_2_, condition);
+}
+
+/* (compile form) -> function
+
+   Compiles the form, usually a lambda, in the compilation process,
+   loads the result, and returns the form's value, which must be a
+   function.  Macros are those known to the compilation process.
+   Signals a <compile-error> if the form contains objects other than
+   symbols, strings, integers and booleans, can't be compiled, or
+   doesn't evaluate to a function. */
+
+struct ell_obj *__ell_g_compile_2_;
+
+static struct ell_obj *
+ellcm_compile_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
+                   struct ell_obj **args)
+{
+    ell_check_npos(npos, 1);
+    struct ellcm *cm = (struct ellcm *) ((struct ell_clo_data *) clo->data)->env;
+    char *infile = ell_alloc(L_tmpnam);
+    char *faslfile = ell_alloc(L_tmpnam);
+    char *cfaslfile = ell_alloc(L_tmpnam);
+    tmpnam(infile);
+    tmpnam(faslfile);
+    tmpnam(cfaslfile);
+    FILE *in = fopen(infile, "w");
+    if (!in) {
+        ell_fail("cannot open temp file\n");
+    }
+    bool written = ellcm_write_stx(in, args[0]);
+    fclose(in);
+    if (!written) {
+        unlink(infile);
+        return ellcm_compile_error(args[0]);
+    }
+    int status = ellcm_compile(cm, ELLCM_COMPILE_STX, infile, faslfile, cfaslfile);
+    unlink(infile);
+    unlink(cfaslfile);
+    if (status != 0) {
+        unlink(faslfile);
+        return ellcm_compile_error(args[0]);
+    }
+    dlerror();
+    void *handle = dlopen(faslfile, RTLD_NOW | RTLD_GLOBAL);
+    unlink(faslfile);
+    if (!handle) {
+        ell_fail("can't load compiled form: %s\n", dlerror());
+    }
+    struct ell_obj *(*result)() = (struct ell_obj *(*)()) dlsym(handle, ELLC_UNIT_RESULT_FUN);
+    if (!result) {
+        ell_fail("can't load compiled form: %s\n", dlerror());
+    }
+    struct ell_obj *fun = result();
+    if (fun->wrapper != ELL_WRAPPER(clo)) {
+        return ellcm_compile_error(args[0]);
+    }
+    return fun;
+}
+
 struct ellcm *
 ellcm_init()
 {
@@ -82,15 +314,22 @@ ellcm_init()
     } else {
         struct ellcm *cm = (struct ellcm *) ell_alloc(sizeof(*cm));
         cm->sd = sv[0];
+        __ell_g_compile_2_ = ell_make_clo(&ellcm_compile_code, cm);
         return cm;
     }
 }
 
 int
 ellcm_compile_file(struct ellcm *cm, char *infile, char *faslfile, char *cfaslfile)
+{
+    return ellcm_compile(cm, ELLCM_COMPILE, infile, faslfile, cfaslfile);
+}
+
+static int
+ellcm_compile(struct ellcm *cm, int type, char *infile, char *faslfile, char *cfaslfile)
 {
     struct ellcm_tx tx;
-    tx.type = ELLCM_COMPILE;
+    tx.type = type;
     strcpy(tx.data.compile.infile, infile);
     strcpy(tx.data.compile.faslfile, faslfile);
     strcpy(tx.data.compile.cfaslfile, cfaslfile);
@@ -12,7 +12,7 @@
 #define ELLCM_MSG_LEN 256
 
 struct ellcm_tx {
-    enum { ELLCM_COMPILE, ELLCM_LOAD } type;
+    enum { ELLCM_COMPILE, ELLCM_COMPILE_STX, ELLCM_LOAD } type;
     union {
         struct {
             char infile[ELLCM_PATH_LEN];
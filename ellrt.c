@@ -2,6 +2,7 @@
 
 #define _GNU_SOURCE
 #include <dlfcn.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <readline/readline.h>
 
@@ -97,6 +98,7 @@ ell_make_wrapper(struct ell_obj *class)
 {
     struct ell_wrapper *wrapper = (struct ell_wrapper *) ell_alloc(sizeof(*wrapper));
     wrapper->class = class;
+    wrapper->slots = ell_util_make_list();
     return wrapper;
 }
 
@@ -126,12 +128,17 @@ ell_make_class(struct ell_obj *name)
     return class;
 }
 
+/* Bumped whenever the class hierarchy changes, invalidating the
+   flattened superclass vectors of all classes. */
+static unsigned ell_class_hierarchy_epoch = 1;
+
 void
 ell_add_superclass(struct ell_obj *class, struct ell_obj *superclass)
 {
     ell_assert_wrapper(class, ELL_WRAPPER(class));
     ell_assert_wrapper(superclass, ELL_WRAPPER(class));
     ell_util_set_add(ell_class_superclasses(class), superclass, (dict_comp_t) &ell_ptr_cmp);
+    ell_class_hierarchy_epoch++;
 }
 
 struct ell_obj *
@@ -185,13 +192,107 @@ ell_assert_wrapper(struct ell_obj *obj, struct ell_wrapper *wrapper)
     }
 }
 
+/* Returns the column of the slot with index I, adding columns for
+   slots that were added to the layout since the last call. */
+static struct ell_obj **
+ell_pool_column(struct ell_pool *pool, unsigned i)
+{
+    if (i >= pool->columns_ct) {
+        struct ell_obj ***columns = (struct ell_obj ***)
+            ell_alloc((i + 1) * sizeof(struct ell_obj **));
+        memcpy(columns, pool->columns, pool->columns_ct * sizeof(struct ell_obj **));
+        for (unsigned j = pool->columns_ct; j <= i; j++)
+            columns[j] = (struct ell_obj **) ell_alloc(pool->capacity * sizeof(struct ell_obj *));
+        pool->columns = columns;
+        pool->columns_ct = i + 1;
+    }
+    return pool->columns[i];
+}
+
+static struct ell_obj *
+ell_pool_add(struct ell_pool *pool, struct ell_wrapper *wrapper)
+{
+    if (pool->ct == pool->capacity) {
+        unsigned capacity = pool->capacity ? (pool->capacity * 2) : 64;
+        for (unsigned i = 0; i < pool->columns_ct; i++) {
+            struct ell_obj **column = (struct ell_obj **)
+                ell_alloc(capacity * sizeof(struct ell_obj *));
+            memcpy(column, pool->columns[i], pool->ct * sizeof(struct ell_obj *));
+            pool->columns[i] = column;
+        }
+        pool->capacity = capacity;
+    }
+    return ell_make_obj(wrapper, (void *) (uintptr_t) pool->ct++);
+}
+
+/* Class options must be put before the first instance is made, and
+   before any slot is added to the layout, since they change the
+   representation of instances, which existing instances and the slot
+   caches of call sites depend on. */
+void
+ell_put_class_option(struct ell_obj *class, struct ell_obj *option)
+{
+    struct ell_wrapper *wrapper = ell_class_wrapper(class);
+    if (wrapper->instantiated || !list_isempty(wrapper->slots))
+        ell_fail("class already has instances: %s\n",
+                 ell_str_chars(ell_sym_name(ell_class_name(class))));
+    if (option == ELL_SYM(class_option_pooled)) {
+        if (!wrapper->pool)
+            wrapper->pool = (struct ell_pool *) ell_alloc(sizeof(struct ell_pool));
+    } else {
+        ell_fail("unknown class option: %s\n", ell_str_chars(ell_sym_name(option)));
+    }
+}
+
+/* The instance and its slot vector, sized for the current layout,
+   are allocated together. */
+struct ell_obj *
+ell_make_instance(struct ell_wrapper *wrapper)
+{
+    wrapper->instantiated = 1;
+    if (wrapper->pool) return ell_pool_add(wrapper->pool, wrapper);
+    unsigned slots_ct = list_count(wrapper->slots);
+    struct ell_obj *obj = (struct ell_obj *)
+        ell_alloc(sizeof(struct ell_obj) + sizeof(struct ell_instance_data)
+                  + (slots_ct * sizeof(struct ell_obj *)));
+    struct ell_instance_data *data = (struct ell_instance_data *) (obj + 1);
+    data->slots_ct = slots_ct;
+    data->slots = (struct ell_obj **) (data + 1);
+    obj->wrapper = wrapper;
+    obj->data = data;
+    return obj;
+}
+
+/* Returns the index of a slot in the layout, or -1 if it isn't in
+   the layout.  If ADD is true, adds missing slots to the layout. */
+int
+ell_slot_index(struct ell_wrapper *wrapper, struct ell_obj *slot_sym, bool add)
+{
+    int i = 0;
+    for (lnode_t *n = list_first(wrapper->slots); n; n = list_next(wrapper->slots, n)) {
+        if (lnode_get(n) == slot_sym) return i;
+        i++;
+    }
+    if (!add) return -1;
+    ell_util_list_add(wrapper->slots, slot_sym);
+    return i;
+}
+
 struct ell_obj *
 ell_slot_value(struct ell_obj *obj, struct ell_obj *slot_sym)
 {
     ell_assert_wrapper(slot_sym, ELL_WRAPPER(sym));
-    dnode_t *n = dict_lookup((dict_t *) obj->data, slot_sym);
-    if (n) {
-        return (struct ell_obj *) dnode_get(n);
+    int i = ell_slot_index(obj->wrapper, slot_sym, 0);
+    struct ell_pool *pool = obj->wrapper->pool;
+    if (pool) {
+        if ((i != -1) && ((unsigned) i < pool->columns_ct)
+            && pool->columns[i][ELL_POOL_INDEX(obj)])
+            return pool->columns[i][ELL_POOL_INDEX(obj)];
+        ell_fail("unbound slot: %s\n", ell_str_chars(ell_sym_name(slot_sym)));
+    }
+    struct ell_instance_data *data = (struct ell_instance_data *) obj->data;
+    if ((i != -1) && ((unsigned) i < data->slots_ct) && data->slots[i]) {
+        return data->slots[i];
     } else {
         ell_fail("unbound slot: %s\n", ell_str_chars(ell_sym_name(slot_sym)));
         return NULL;
@@ -202,17 +303,60 @@ struct ell_obj *
 ell_set_slot_value(struct ell_obj *obj, struct ell_obj *slot_sym, struct ell_obj *val)
 {
     ell_assert_wrapper(slot_sym, ELL_WRAPPER(sym));
-    ell_util_dict_put((dict_t *) obj->data, slot_sym, val);
+    unsigned i = ell_slot_index(obj->wrapper, slot_sym, 1);
+    if (obj->wrapper->pool)
+        return ell_pool_column(obj->wrapper->pool, i)[ELL_POOL_INDEX(obj)] = val;
+    struct ell_instance_data *data = (struct ell_instance_data *) obj->data;
+    if (i >= data->slots_ct) {
+        unsigned slots_ct = list_count(obj->wrapper->slots);
+        struct ell_obj **slots = (struct ell_obj **) ell_alloc(slots_ct * sizeof(struct ell_obj *));
+        memcpy(slots, data->slots, data->slots_ct * sizeof(struct ell_obj *));
+        data->slots = slots;
+        data->slots_ct = slots_ct;
+    }
+    data->slots[i] = val;
     return val;
 }
 
-bool
-ell_is_subclass(struct ell_obj *class, struct ell_obj *superclass)
+static void
+ell_collect_all_superclasses(struct ell_obj *class, list_t *all_superclasses)
 {
     list_t *superclasses = ell_class_superclasses(class);
     for (lnode_t *n = list_first(superclasses); n; n = list_next(superclasses, n)) {
         struct ell_obj *c = (struct ell_obj *) lnode_get(n);
-        if ((c == superclass) || ell_is_subclass(c, superclass))
+        if (!ell_util_list_contains(all_superclasses, c, (dict_comp_t) &ell_ptr_cmp)) {
+            ell_util_list_add(all_superclasses, c);
+            ell_collect_all_superclasses(c, all_superclasses);
+        }
+    }
+}
+
+static void
+ell_update_all_superclasses(struct ell_obj *class)
+{
+    struct ell_class_data *data = (struct ell_class_data *) class->data;
+    list_t *all_superclasses = ell_util_make_list();
+    ell_collect_all_superclasses(class, all_superclasses);
+    data->all_superclasses_ct = list_count(all_superclasses);
+    data->all_superclasses = (struct ell_obj **)
+        ell_alloc(data->all_superclasses_ct * sizeof(struct ell_obj *));
+    unsigned i = 0;
+    for (lnode_t *n = list_first(all_superclasses); n; n = list_next(all_superclasses, n)) {
+        data->all_superclasses[i++] = (struct ell_obj *) lnode_get(n);
+    }
+    data->all_superclasses_epoch = ell_class_hierarchy_epoch;
+}
+
+bool
+ell_is_subclass(struct ell_obj *class, struct ell_obj *superclass)
+{
+    ell_assert_wrapper(class, ELL_WRAPPER(class));
+    struct ell_class_data *data = (struct ell_class_data *) class->data;
+    if (data->all_superclasses_epoch != ell_class_hierarchy_epoch) {
+        ell_update_all_superclasses(class);
+    }
+    for (unsigned i = 0; i < data->all_superclasses_ct; i++) {
+        if (data->all_superclasses[i] == superclass)
             return true;
     }
     return false;
@@ -579,32 +723,70 @@ ell_send(struct ell_obj *rcv, struct ell_obj *gf,
 
 /**** Control Flow ****/
 
-struct ell_obj *
-ell_return_from_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
-                     struct ell_obj **args)
+void
+ell_unwind_dynamic_bindings(struct ell_dynamic_binding *dynamic_binding)
+{
+    while(ell_current_dynamic_binding != dynamic_binding) {
+        struct ell_dynamic_binding *binding = ell_current_dynamic_binding;
+        *binding->cell = binding->old_value;
+        ell_current_dynamic_binding = binding->parent;
+    }
+}
+
+/* Records the current dynamic state in a block that is about to be
+   established.  The caller still needs to call setjmp. */
+void
+ell_init_block(struct ell_block *block)
+{
+    block->parent = ell_current_unwind_protect;
+    block->dynamic_binding = ell_current_dynamic_binding;
+    block->handler = ell_current_handler;
+    block->restart = ell_current_restart;
+}
+
+/* Performs a non-local exit to the block, running the cleanups of
+   intervening unwind-protects, each with the dynamic state that was
+   in effect when the unwind-protect was established. */
+void
+ell_return_from(struct ell_block *block, struct ell_obj *val)
 {
-    struct ell_clo_data *clo_data = (struct ell_clo_data *) clo->data;
-    struct ell_block *block = (struct ell_block *) clo_data->env; // See comment in ell_block
-    struct ell_obj *val = args[0];
     while(ell_current_unwind_protect != block->parent) {
         struct ell_unwind_protect *unwind_protect = ell_current_unwind_protect;
         ell_current_unwind_protect = ell_current_unwind_protect->parent;
+        ell_unwind_dynamic_bindings(unwind_protect->dynamic_binding);
+        ell_current_handler = unwind_protect->handler;
+        ell_current_restart = unwind_protect->restart;
         ELL_CALL(unwind_protect->cleanup);
     }
+    ell_unwind_dynamic_bindings(block->dynamic_binding);
+    ell_current_handler = block->handler;
+    ell_current_restart = block->restart;
     block->val = val;
     longjmp(block->dest, 1);
+}
+
+struct ell_obj *
+ell_return_from_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
+                     struct ell_obj **args)
+{
+    struct ell_clo_data *clo_data = (struct ell_clo_data *) clo->data;
+    struct ell_block *block = (struct ell_block *) clo_data->env; // See comment in ell_block
+    ell_return_from(block, args[0]);
     return NULL;
 }
 
+/* The escape function of a block has dynamic extent, like the block
+   itself, so it is allocated on the stack. */
 struct ell_obj *
 ell_block(struct ell_obj *fun)
 {
     struct ell_block block;
-    block.parent = ell_current_unwind_protect;
+    ell_init_block(&block);
     if (!setjmp(block.dest)) {
         // Faked closure with block as "environment"
-        struct ell_obj *escape = ell_make_clo(&ell_return_from_code, &block);
-        return ELL_CALL(fun, escape);
+        struct ell_clo_data escape_data = { &ell_return_from_code, &block };
+        struct ell_obj escape = { ELL_WRAPPER(clo), &escape_data };
+        return ELL_CALL(fun, &escape);
     } else {
         return block.val;
     }
@@ -615,13 +797,22 @@ ell_unwind_protect(struct ell_obj *protected, struct ell_obj *cleanup)
 {
     struct ell_unwind_protect unwind_protect;
     unwind_protect.parent = ell_current_unwind_protect;
+    unwind_protect.dynamic_binding = ell_current_dynamic_binding;
+    unwind_protect.handler = ell_current_handler;
+    unwind_protect.restart = ell_current_restart;
     unwind_protect.cleanup = cleanup;
 
     ell_current_unwind_protect = &unwind_protect;
     struct ell_obj *val = ELL_CALL(protected);
     ell_current_unwind_protect = ell_current_unwind_protect->parent;
 
+    // The values of the protected function are the result.
+    unsigned values_ct = ell_values_ct;
+    struct ell_obj *values[ELL_MAX_VALUES];
+    memcpy(values, ell_values_buf, values_ct * sizeof(struct ell_obj *));
     ELL_CALL(cleanup);
+    memcpy(ell_values_buf, values, values_ct * sizeof(struct ell_obj *));
+    ell_values_ct = values_ct;
     return val;
 }
 
@@ -642,6 +833,146 @@ ell_unwind_protect_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
 struct ell_obj *__ell_g_blockFf_2_;
 struct ell_obj *__ell_g_unwindDprotectFf_2_;
 
+/**** Multiple Values ****/
+
+struct ell_obj *ell_values_buf[ELL_MAX_VALUES];
+unsigned ell_values_ct;
+
+/* Returns the value with index I stored by the call to VALUES that
+   returned PRIMARY, or unspecified if there's no such value. */
+struct ell_obj *
+ell_multiple_value_ref(struct ell_obj *primary, unsigned i)
+{
+    if (i == 0) return primary;
+    return ELL_GEN_MULTIPLE_VALUE_REF(primary, i);
+}
+
+/**** Conditions ****/
+
+struct ell_obj *
+ell_handler_bind(struct ell_obj *class, struct ell_obj *function, struct ell_obj *body)
+{
+    ell_assert_wrapper(class, ELL_WRAPPER(class));
+    ell_assert_wrapper(function, ELL_WRAPPER(clo));
+    struct ell_handler handler;
+    handler.parent = ell_current_handler;
+    handler.class = class;
+    handler.function = function;
+
+    ell_current_handler = &handler;
+    struct ell_obj *val = ELL_CALL(body);
+    ell_current_handler = handler.parent;
+
+    return val;
+}
+
+/* Calls the function of an applicable handler, with the handler's
+   parent handlers in effect.  Returns true, and stores the value in
+   val, if the handler resumed, or false if it declined. */
+static bool
+ell_invoke_handler(struct ell_handler *handler, struct ell_obj *condition,
+                   struct ell_obj **val)
+{
+    struct ell_block resume;
+    ell_init_block(&resume);
+    if (!setjmp(resume.dest)) {
+        // Faked closure with block as "environment", see ell_block
+        struct ell_clo_data resume_data = { &ell_return_from_code, &resume };
+        struct ell_obj resume_fun = { ELL_WRAPPER(clo), &resume_data };
+        ell_current_handler = handler->parent;
+        ELL_CALL(handler->function, condition, &resume_fun);
+        ell_current_handler = resume.handler;
+        return false;
+    } else {
+        *val = resume.val;
+        return true;
+    }
+}
+
+struct ell_obj *
+ell_signal(struct ell_obj *condition)
+{
+    struct ell_obj *class = ell_obj_class(condition);
+    for (struct ell_handler *h = ell_current_handler; h; h = h->parent) {
+        if ((class == h->class) || ell_is_subclass(class, h->class)) {
+            struct ell_obj *val;
+            if (ell_invoke_handler(h, condition, &val))
+                return val;
+        }
+    }
+    return ell_unspecified;
+}
+
+struct ell_obj *
+ell_handler_bind_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
+                      struct ell_obj **args)
+{
+    ell_check_npos(npos, 3);
+    return ell_handler_bind(args[0], args[1], args[2]);
+}
+
+struct ell_obj *
+ell_signal_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
+                struct ell_obj **args)
+{
+    ell_check_npos(npos, 1);
+    return ell_signal(args[0]);
+}
+
+struct ell_obj *
+ell_with_restart(struct ell_obj *class, struct ell_obj *body)
+{
+    ell_assert_wrapper(class, ELL_WRAPPER(class));
+    struct ell_block block;
+    ell_init_block(&block);
+    struct ell_restart restart;
+    restart.parent = ell_current_restart;
+    restart.class = class;
+    restart.block = &block;
+    if (!setjmp(block.dest)) {
+        ell_current_restart = &restart;
+        struct ell_obj *val = ELL_CALL(body);
+        ell_current_restart = restart.parent;
+        return val;
+    } else {
+        return block.val;
+    }
+}
+
+void
+ell_invoke_restart(struct ell_obj *class, struct ell_obj *val)
+{
+    for (struct ell_restart *r = ell_current_restart; r; r = r->parent) {
+        if ((class == r->class) || ell_is_subclass(class, r->class)) {
+            ell_return_from(r->block, val);
+        }
+    }
+    ell_fail("no restart: %s\n", ell_str_chars(ell_sym_name(ell_class_name(class))));
+}
+
+struct ell_obj *
+ell_with_restart_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
+                      struct ell_obj **args)
+{
+    ell_check_npos(npos, 2);
+    return ell_with_restart(args[0], args[1]);
+}
+
+struct ell_obj *
+ell_invoke_restart_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
+                        struct ell_obj **args)
+{
+    ell_check_npos(npos, 2);
+    ell_assert_wrapper(args[0], ELL_WRAPPER(class));
+    ell_invoke_restart(args[0], args[1]);
+    return NULL;
+}
+
+struct ell_obj *__ell_g_handlerDbindFf_2_;
+struct ell_obj *__ell_g_signal_2_;
+struct ell_obj *__ell_g_withDrestartFf_2_;
+struct ell_obj *__ell_g_invokeDrestart_2_;
+
 /**** Strings ****/
 
 struct ell_obj *
@@ -721,6 +1052,48 @@ ell_num_int(struct ell_obj *num)
     return ((struct ell_num_int_data *) num->data)->int_value;
 }
 
+/* These are also the out-of-line slow paths of the open-coded
+   arithmetic in generated code. */
+
+void
+ell_num_overflow()
+{
+    ell_fail("integer overflow\n");
+}
+
+struct ell_obj *
+ell_num_add(struct ell_obj *num1, struct ell_obj *num2)
+{
+    int res;
+    if (__builtin_add_overflow(ell_num_int(num1), ell_num_int(num2), &res))
+        ell_num_overflow();
+    return ell_make_num_from_int(res);
+}
+
+struct ell_obj *
+ell_num_sub(struct ell_obj *num1, struct ell_obj *num2)
+{
+    int res;
+    if (__builtin_sub_overflow(ell_num_int(num1), ell_num_int(num2), &res))
+        ell_num_overflow();
+    return ell_make_num_from_int(res);
+}
+
+struct ell_obj *
+ell_num_mul(struct ell_obj *num1, struct ell_obj *num2)
+{
+    int res;
+    if (__builtin_mul_overflow(ell_num_int(num1), ell_num_int(num2), &res))
+        ell_num_overflow();
+    return ell_make_num_from_int(res);
+}
+
+struct ell_obj *
+ell_num_lt(struct ell_obj *num1, struct ell_obj *num2)
+{
+    return ell_truth(ell_num_int(num1) < ell_num_int(num2));
+}
+
 /**** Symbols ****/
 
 static struct ell_obj *
@@ -892,20 +1265,6 @@ ell_assert_stx_lst_len_min(struct ell_obj *stx_lst, listcount_t len)
     ell_util_assert_list_len_min(ell_stx_lst_elts(stx_lst), len);
 }
 
-/**** Booleans ****/
-
-bool
-ell_is_true(struct ell_obj *obj)
-{
-    return obj != ell_f;
-}
-
-struct ell_obj *
-ell_truth(bool b)
-{
-    return b ? ell_t : ell_f;
-}
-
 /**** Ranges ****/
 
 struct ell_obj *
@@ -1148,6 +1507,68 @@ ell_unbound_fun(char *name)
     return ell_unspecified;
 }
 
+/* Open-coded MAKE with keyword arguments, whose slot names and values
+   are passed as alternating varargs.  The slots are added to the
+   class's layout before the instance is allocated, so it's allocated
+   once, with all slots in place. */
+struct ell_obj *
+ell_make_with_slots(struct ell_make_cache *cache, struct ell_obj *class, unsigned nslots, ...)
+{
+    struct ell_wrapper *wrapper = ell_class_wrapper(class);
+    va_list ap;
+    if (ELL_UNLIKELY(cache->wrapper != wrapper)) {
+        va_start(ap, nslots);
+        for (unsigned i = 0; i < nslots; i++) {
+            struct ell_obj *slot_sym = va_arg(ap, struct ell_obj *);
+            va_arg(ap, struct ell_obj *);
+            ell_assert_wrapper(slot_sym, ELL_WRAPPER(sym));
+            cache->indexes[i] = ell_slot_index(wrapper, slot_sym, 1);
+        }
+        va_end(ap);
+        cache->wrapper = wrapper;
+    }
+    struct ell_obj *obj = ell_make_instance(wrapper);
+    va_start(ap, nslots);
+    if (wrapper->pool) {
+        for (unsigned i = 0; i < nslots; i++) {
+            va_arg(ap, struct ell_obj *);
+            ell_pool_column(wrapper->pool, cache->indexes[i])[ELL_POOL_INDEX(obj)] =
+                va_arg(ap, struct ell_obj *);
+        }
+    } else {
+        struct ell_obj **slots = ((struct ell_instance_data *) obj->data)->slots;
+        for (unsigned i = 0; i < nslots; i++) {
+            va_arg(ap, struct ell_obj *);
+            slots[cache->indexes[i]] = va_arg(ap, struct ell_obj *);
+        }
+    }
+    va_end(ap);
+    return obj;
+}
+
+struct ell_obj *
+ell_slot_value_miss(struct ell_slot_cache *cache, struct ell_obj *obj, struct ell_obj *slot_sym)
+{
+    struct ell_obj *val = ell_slot_value(obj, slot_sym);
+    if (!obj->wrapper->pool) {
+        cache->wrapper = obj->wrapper;
+        cache->index = ell_slot_index(obj->wrapper, slot_sym, 0);
+    }
+    return val;
+}
+
+struct ell_obj *
+ell_set_slot_value_miss(struct ell_slot_cache *cache, struct ell_obj *obj,
+                        struct ell_obj *slot_sym, struct ell_obj *val)
+{
+    ell_set_slot_value(obj, slot_sym, val);
+    if (!obj->wrapper->pool) {
+        cache->wrapper = obj->wrapper;
+        cache->index = ell_slot_index(obj->wrapper, slot_sym, 0);
+    }
+    return val;
+}
+
 struct ell_obj **
 ell_make_box(struct ell_obj *value)
 {
@@ -1184,6 +1605,17 @@ ell_lookup_key(struct ell_obj *key_sym, ell_arg_ct npos, ell_arg_ct nkey,
     return NULL;
 }
 
+/* Collects the positional arguments from START on into a list, for a
+   rest parameter. */
+struct ell_obj *
+ell_make_rest_lst(ell_arg_ct start, ell_arg_ct npos, struct ell_obj **args)
+{
+    struct ell_obj *lst = ell_make_lst();
+    for (ell_arg_ct i = start; i < npos; i++)
+        ELL_SEND(lst, add, args[i]);
+    return lst;
+}
+
 /**** Data Structure Utilities ****/
 
 list_t *
@@ -1356,6 +1788,34 @@ ell_send_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
     return ell_send(rcv, gf, npos - 1, 0, args);
 }
 
+/* (values &rest values) -> first-value */
+
+struct ell_obj *__ell_g_values_2_;
+
+struct ell_obj *
+ell_values_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
+                struct ell_obj **args)
+{
+    if (npos > ELL_MAX_VALUES) {
+        ell_fail("too many values\n");
+    }
+    memcpy(ell_values_buf, args, npos * sizeof(struct ell_obj *));
+    ell_values_ct = npos;
+    return (npos > 0) ? args[0] : ell_unspecified;
+}
+
+/* (multiple-value-ref primary index) -> value */
+
+struct ell_obj *__ell_g_multipleDvalueDref_2_;
+
+struct ell_obj *
+ell_multiple_value_ref_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
+                            struct ell_obj **args)
+{
+    ell_check_npos(2, npos);
+    return ell_multiple_value_ref(args[0], ell_num_int(args[1]));
+}
+
 /* (syntax-list &rest syntax-objects) -> syntax-list */
 
 struct ell_obj *__ell_g_syntaxDlist_2_;
@@ -1390,6 +1850,145 @@ ell_syntax_list_rest_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
     return res;
 }
 
+/* Destructuring of macro calls, see `ellc_norm_mbind'.  The indexes
+   are those of the elements of the whole call form, whose first
+   element is the macro name. */
+
+/* (syntax-list-length syntax-list) -> integer */
+
+struct ell_obj *__ell_g_syntaxDlistDlength_2_;
+
+struct ell_obj *
+ell_syntax_list_length_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
+                            struct ell_obj **args)
+{
+    ell_check_npos(1, npos);
+    ell_assert_wrapper(args[0], ELL_WRAPPER(stx_lst));
+    return ell_make_num_from_int(list_count(ell_stx_lst_elts(args[0])));
+}
+
+static lnode_t *
+ell_syntax_list_node(struct ell_obj *stx_lst, struct ell_obj *index)
+{
+    ell_assert_wrapper(stx_lst, ELL_WRAPPER(stx_lst));
+    list_t *elts = ell_stx_lst_elts(stx_lst);
+    lnode_t *n = list_first(elts);
+    for (int i = ell_num_int(index); n && (i > 0); i--)
+        n = list_next(elts, n);
+    return n;
+}
+
+/* (syntax-list-ref syntax-list index) -> syntax-object */
+
+struct ell_obj *__ell_g_syntaxDlistDref_2_;
+
+struct ell_obj *
+ell_syntax_list_ref_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
+                         struct ell_obj **args)
+{
+    ell_check_npos(2, npos);
+    lnode_t *n = ell_syntax_list_node(args[0], args[1]);
+    if (!n)
+        ell_fail("syntax list index out of range\n");
+    return (struct ell_obj *) lnode_get(n);
+}
+
+/* Returns whether the node holds one of the keywords and is followed
+   by a value. */
+static bool
+ell_syntax_list_keyword_node_p(list_t *elts, lnode_t *n, ell_arg_ct nkeywords,
+                               struct ell_obj **keywords)
+{
+    struct ell_obj *stx = (struct ell_obj *) lnode_get(n);
+    if ((stx->wrapper != ELL_WRAPPER(stx_sym)) || !list_next(elts, n))
+        return 0;
+    for (ell_arg_ct i = 0; i < nkeywords; i++)
+        if (ell_stx_sym_sym(stx) == keywords[i])
+            return 1;
+    return 0;
+}
+
+/* Returns the node of the value following the keyword, from the
+   index on, or NULL. */
+static lnode_t *
+ell_syntax_list_key_node(struct ell_obj *stx_lst, struct ell_obj *index, struct ell_obj *keyword)
+{
+    list_t *elts = ell_stx_lst_elts(stx_lst);
+    for (lnode_t *n = ell_syntax_list_node(stx_lst, index); n; n = list_next(elts, n))
+        if (ell_syntax_list_keyword_node_p(elts, n, 1, &keyword))
+            return list_next(elts, n);
+    return NULL;
+}
+
+/* (syntax-list-key-p syntax-list index keyword) -> boolean */
+
+struct ell_obj *__ell_g_syntaxDlistDkeyDp_2_;
+
+struct ell_obj *
+ell_syntax_list_key_p_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
+                           struct ell_obj **args)
+{
+    ell_check_npos(3, npos);
+    return ell_truth(ell_syntax_list_key_node(args[0], args[1], args[2]) != NULL);
+}
+
+/* (syntax-list-key syntax-list index keyword) -> syntax-object */
+
+struct ell_obj *__ell_g_syntaxDlistDkey_2_;
+
+struct ell_obj *
+ell_syntax_list_key_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
+                         struct ell_obj **args)
+{
+    ell_check_npos(3, npos);
+    lnode_t *n = ell_syntax_list_key_node(args[0], args[1], args[2]);
+    if (!n)
+        ell_fail("missing keyword: %s\n", ell_str_chars(ell_sym_name(args[2])));
+    return (struct ell_obj *) lnode_get(n);
+}
+
+/* (syntax-list-tail syntax-list index &rest keywords) -> syntax-list
+
+   The keywords and their values are left out. */
+
+struct ell_obj *__ell_g_syntaxDlistDtail_2_;
+
+struct ell_obj *
+ell_syntax_list_tail_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
+                          struct ell_obj **args)
+{
+    if (npos < 2)
+        ell_arity_error();
+    struct ell_obj *res = ell_make_stx_lst();
+    list_t *elts = ell_stx_lst_elts(args[0]);
+    for (lnode_t *n = ell_syntax_list_node(args[0], args[1]); n; n = list_next(elts, n)) {
+        if (ell_syntax_list_keyword_node_p(elts, n, npos - 2, args + 2))
+            n = list_next(elts, n);
+        else
+            ELL_SEND(res, add, (struct ell_obj *) lnode_get(n));
+    }
+    return res;
+}
+
+/* (check-syntax-list-length syntax-list min max) -> unspecified
+
+   Signals an arity error unless the syntax list has between min and
+   max elements, or at least min if max is #f. */
+
+struct ell_obj *__ell_g_checkDsyntaxDlistDlength_2_;
+
+struct ell_obj *
+ell_check_syntax_list_length_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
+                                  struct ell_obj **args)
+{
+    ell_check_npos(3, npos);
+    ell_assert_wrapper(args[0], ELL_WRAPPER(stx_lst));
+    int len = list_count(ell_stx_lst_elts(args[0]));
+    if ((len < ell_num_int(args[1])) || ((args[2] != ell_f) && (len > ell_num_int(args[2]))))
+        ell_arity_error();
+    return ell_unspecified;
+}
+
 /* (append-syntax-lists &rest syntax-lists) -> syntax-list */
 
 struct ell_obj *__ell_g_appendDsyntaxDlists_2_;
@@ -1488,6 +2087,7 @@ ell_map_list_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
         ELL_SEND(res, add, ELL_CALL(fun, elt));
         ELL_SEND(range, popDfront);
     }
+    ell_values_ct = 0;
     return res;
 }
 
@@ -1503,6 +2103,21 @@ ell_make_class_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
     return ell_make_class(args[0]);
 }
 
+/* (put-class-option class option) -> unspecified
+   The only option is `pooled', which stores instances column-wise.
+   DEFCLASS puts the options given with its `options:' keyword. */
+
+struct ell_obj *__ell_g_putDclassDoption_2_;
+
+struct ell_obj *
+ell_put_class_option_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
+                          struct ell_obj **args)
+{
+    ell_check_npos(npos, 2);
+    ell_put_class_option(args[0], args[1]);
+    return ell_unspecified;
+}
+
 /* (add-superclass class superclass) -> unspecified */
 
 struct ell_obj *__ell_g_addDsuperclass_2_;
@@ -1577,7 +2192,8 @@ ell_put_method_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
     return ell_unspecified;
 }
 
-/* (make class) -> instance */
+/* (make class &all-keys slot-values) -> instance
+   The keyword arguments initialize the slots they name. */
 
 struct ell_obj *__ell_g_make_2_;
 
@@ -1586,8 +2202,10 @@ ell_make_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
               struct ell_obj **args)
 {
     ell_check_npos(npos, 1);
-    return ell_make_obj(ell_class_wrapper(args[0]),
-                        ell_util_make_dict((dict_comp_t) &ell_sym_cmp));
+    struct ell_obj *obj = ell_make_instance(ell_class_wrapper(args[0]));
+    for (int i = 0; i < (nkey * 2); i += 2)
+        ell_set_slot_value(obj, args[npos + i], args[npos + i + 1]);
+    return obj;
 }
 
 /* (slot-value object slot-name) -> value */
@@ -1614,6 +2232,67 @@ ell_set_slot_value_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
     return ell_set_slot_value(args[0], args[1], args[2]);
 }
 
+/* Returns the column of a slot of a pooled class, or NULL if the
+   slot isn't in the layout. */
+static struct ell_obj **
+ell_pool_column_named(struct ell_obj *class, struct ell_obj *slot_sym)
+{
+    struct ell_wrapper *wrapper = ell_class_wrapper(class);
+    ell_assert_wrapper(slot_sym, ELL_WRAPPER(sym));
+    if (!wrapper->pool)
+        ell_fail("class is not pooled: %s\n", ell_str_chars(ell_sym_name(ell_class_name(class))));
+    int i = ell_slot_index(wrapper, slot_sym, 0);
+    return (i != -1) ? ell_pool_column(wrapper->pool, i) : NULL;
+}
+
+/* (map-column function class slot-name) -> unspecified
+   Calls the function with the slot's value of every instance of a
+   pooled class, in the order the instances were made. */
+
+struct ell_obj *__ell_g_mapDcolumn_2_;
+
+struct ell_obj *
+ell_map_column_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
+                    struct ell_obj **args)
+{
+    ell_check_npos(npos, 3);
+    struct ell_obj *fun = args[0];
+    ell_assert_wrapper(fun, ELL_WRAPPER(clo));
+    struct ell_obj **column = ell_pool_column_named(args[1], args[2]);
+    unsigned ct = ell_class_wrapper(args[1])->pool->ct;
+    for (unsigned j = 0; j < ct; j++) {
+        if (!column || !column[j])
+            ell_fail("unbound slot: %s\n", ell_str_chars(ell_sym_name(args[2])));
+        ELL_CALL(fun, column[j]);
+        // The function may have made instances, growing the column.
+        column = ell_pool_column_named(args[1], args[2]);
+    }
+    ell_values_ct = 0;
+    return ell_unspecified;
+}
+
+/* (sum-column class slot-name) -> integer
+   Sums the integer slot values of all instances of a pooled class. */
+
+struct ell_obj *__ell_g_sumDcolumn_2_;
+
+struct ell_obj *
+ell_sum_column_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
+                    struct ell_obj **args)
+{
+    ell_check_npos(npos, 2);
+    struct ell_obj **column = ell_pool_column_named(args[0], args[1]);
+    struct ell_pool *pool = ell_class_wrapper(args[0])->pool;
+    int sum = 0;
+    for (unsigned j = 0; j < pool->ct; j++) {
+        if (!column || !column[j])
+            ell_fail("unbound slot: %s\n", ell_str_chars(ell_sym_name(args[1])));
+        if (__builtin_add_overflow(sum, ell_num_int(column[j]), &sum))
+            ell_num_overflow();
+    }
+    return ell_make_num_from_int(sum);
+}
+
 /* (type? object class) -> boolean */
 
 struct ell_obj *__ell_g_typeQ_2_;
@@ -1666,11 +2345,7 @@ ell_less_than_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
                    struct ell_obj **args)
 {
     ell_check_npos(2, npos);
-    struct ell_obj *num1 = args[0];
-    struct ell_obj *num2 = args[1];
-    ell_assert_wrapper(num1, ELL_WRAPPER(num_int));
-    ell_assert_wrapper(num2, ELL_WRAPPER(num_int));
-    return ell_truth(ell_num_int(num1) < ell_num_int(num2));
+    return ell_num_lt(args[0], args[1]);
 }
 
 /* (+ num1 num2) -> num */
@@ -1682,11 +2357,7 @@ ell_plus_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
               struct ell_obj **args)
 {
     ell_check_npos(2, npos);
-    struct ell_obj *num1 = args[0];
-    struct ell_obj *num2 = args[1];
-    ell_assert_wrapper(num1, ELL_WRAPPER(num_int));
-    ell_assert_wrapper(num2, ELL_WRAPPER(num_int));
-    return ell_make_num_from_int(ell_num_int(num1) + ell_num_int(num2));
+    return ell_num_add(args[0], args[1]);
 }
 
 /* (- num1 num2) -> num */
@@ -1698,11 +2369,7 @@ ell_minus_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
                struct ell_obj **args)
 {
     ell_check_npos(2, npos);
-    struct ell_obj *num1 = args[0];
-    struct ell_obj *num2 = args[1];
-    ell_assert_wrapper(num1, ELL_WRAPPER(num_int));
-    ell_assert_wrapper(num2, ELL_WRAPPER(num_int));
-    return ell_make_num_from_int(ell_num_int(num1) - ell_num_int(num2));
+    return ell_num_sub(args[0], args[1]);
 }
 
 /* (* num1 num2) -> num */
@@ -1714,11 +2381,7 @@ ell_mult_code(struct ell_obj *clo, ell_arg_ct npos, ell_arg_ct nkey,
               struct ell_obj **args)
 {
     ell_check_npos(2, npos);
-    struct ell_obj *num1 = args[0];
-    struct ell_obj *num2 = args[1];
-    ell_assert_wrapper(num1, ELL_WRAPPER(num_int));
-    ell_assert_wrapper(num2, ELL_WRAPPER(num_int));
-    return ell_make_num_from_int(ell_num_int(num1) * ell_num_int(num2));
+    return ell_num_mul(args[0], args[1]);
 }
 
 /**** Initialization ****/
@@ -1786,11 +2449,23 @@ ELL_DEFCLASS(obj, "<object>")
     /* Built-in functions. */
     __ell_g_blockFf_2_ = ell_make_clo(&ell_block_code, NULL);
     __ell_g_unwindDprotectFf_2_ = ell_make_clo(&ell_unwind_protect_code, NULL);
+    __ell_g_handlerDbindFf_2_ = ell_make_clo(&ell_handler_bind_code, NULL);
+    __ell_g_signal_2_ = ell_make_clo(&ell_signal_code, NULL);
+    __ell_g_withDrestartFf_2_ = ell_make_clo(&ell_with_restart_code, NULL);
+    __ell_g_invokeDrestart_2_ = ell_make_clo(&ell_invoke_restart_code, NULL);
 
     __ell_g_apply_2_ = ell_make_clo(&ell_apply_code, NULL);
     __ell_g_send_2_ = ell_make_clo(&ell_send_code, NULL);
+    __ell_g_values_2_ = ell_make_clo(&ell_values_code, NULL);
+    __ell_g_multipleDvalueDref_2_ = ell_make_clo(&ell_multiple_value_ref_code, NULL);
     __ell_g_syntaxDlist_2_ = ell_make_clo(&ell_syntax_list_code, NULL);
     __ell_g_syntaxDlistDrest_2_ = ell_make_clo(&ell_syntax_list_rest_code, NULL);
+    __ell_g_syntaxDlistDlength_2_ = ell_make_clo(&ell_syntax_list_length_code, NULL);
+    __ell_g_syntaxDlistDref_2_ = ell_make_clo(&ell_syntax_list_ref_code, NULL);
+    __ell_g_syntaxDlistDtail_2_ = ell_make_clo(&ell_syntax_list_tail_code, NULL);
+    __ell_g_syntaxDlistDkeyDp_2_ = ell_make_clo(&ell_syntax_list_key_p_code, NULL);
+    __ell_g_syntaxDlistDkey_2_ = ell_make_clo(&ell_syntax_list_key_code, NULL);
+    __ell_g_checkDsyntaxDlistDlength_2_ = ell_make_clo(&ell_check_syntax_list_length_code, NULL);
     __ell_g_appendDsyntaxDlists_2_ = ell_make_clo(&ell_append_syntax_lists_code, NULL);
     __ell_g_applyDsyntaxDlist_2_ = ell_make_clo(&ell_apply_syntax_list_code, NULL);
     __ell_g_datumDGsyntax_2_ = ell_make_clo(&ell_datum_syntax_code, NULL);
@@ -1800,6 +2475,7 @@ ELL_DEFCLASS(obj, "<object>")
 
     __ell_g_makeDclass_2_ = ell_make_clo(&ell_make_class_code, NULL);
     __ell_g_addDsuperclass_2_ = ell_make_clo(&ell_add_superclass_code, NULL);
+    __ell_g_putDclassDoption_2_ = ell_make_clo(&ell_put_class_option_code, NULL);
     __ell_g_makeDgenericDfunction_2_ = ell_make_clo(&ell_make_generic_function_code, NULL);
     __ell_g_dissectDgenericDfunctionDparams_2_ =
         ell_make_clo(&ell_dissect_generic_function_params_code, NULL);
@@ -1807,6 +2483,8 @@ ELL_DEFCLASS(obj, "<object>")
     __ell_g_make_2_ = ell_make_clo(&ell_make_code, NULL);
     __ell_g_slotDvalue_2_ = ell_make_clo(&ell_slot_value_code, NULL);
     __ell_g_setDslotDvalue_2_ = ell_make_clo(&ell_set_slot_value_code, NULL);
+    __ell_g_mapDcolumn_2_ = ell_make_clo(&ell_map_column_code, NULL);
+    __ell_g_sumDcolumn_2_ = ell_make_clo(&ell_sum_column_code, NULL);
     __ell_g_typeQ_2_ = ell_make_clo(&ell_typeQ_code, NULL);
 
     __ell_g_L_2_ = ell_make_clo(&ell_less_than_code, NULL);
@@ -1818,8 +2496,6 @@ ELL_DEFCLASS(obj, "<object>")
 
     __ell_g_readDline_2_ = ell_make_clo(&ell_read_line_code, NULL);
 
-    __ell_g_signal_2_ = ell_unbound;
-
     /* Set names of built-in classes, now that symbols work. */
     ell_set_class_name(ELL_CLASS(class), ell_intern(ell_make_str("<class>")));
     ell_set_class_name(ELL_CLASS(obj), ell_intern(ell_make_str("<object>")));
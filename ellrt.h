@@ -6,6 +6,7 @@
 #include <gc/gc.h>
 #include <setjmp.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -24,13 +25,25 @@
 /* Wrappers introduce a level of indirection between objects and their
    classes, which will allow efficient implementation of method
    lookup.  See the paper ``Efficient Method Dispatch in PCL'' by
-   Gregor J. Kiczales and Luis H. Rodriguez Jr. */
+   Gregor J. Kiczales and Luis H. Rodriguez Jr.
+
+   As in PCL, wrappers also hold the slot layout of instances: the
+   names of the slots, in the order of their indexes in the instances'
+   slot vectors.  A slot is added to the layout when it's first set on
+   any instance of the class, so indexes never change.
+
+   Wrappers of pooled classes also hold the pool of their
+   instances. */
 
 struct ell_obj;
+struct ell_pool;
 
 struct ell_wrapper {
     struct ell_obj *class;
     list_t *type_args; // class object
+    list_t *slots; // sym
+    struct ell_pool *pool; // NULL unless the class is pooled
+    bool instantiated; // set when the first instance is made
 };
 
 struct ell_obj {
@@ -38,16 +51,73 @@ struct ell_obj {
     void *data;
 };
 
+/* Instances created by `make'.  The slot vector of an instance
+   created before slots were added to the layout is shorter than the
+   layout, and gets grown when one of those slots is set.  Unbound
+   slots are NULL. */
+struct ell_instance_data {
+    unsigned slots_ct;
+    struct ell_obj **slots;
+};
+
+/* Instances of pooled classes are stored column-wise: there's a
+   column for every slot in the layout, holding the slot's values of
+   all instances, indexed by instance.  The instances themselves are
+   only handles, whose data is their index.  All columns have the same
+   capacity, and get grown together.  Unbound slots are NULL.
+
+   Rows are never freed: a pool holds all instances ever made of its
+   class, which `map-column' and `sum-column' visit, so the slot values
+   of unreachable instances stay alive as long as the class. */
+struct ell_pool {
+    unsigned ct;
+    unsigned capacity;
+    unsigned columns_ct;
+    struct ell_obj ***columns;
+};
+
+#define ELL_POOL_INDEX(obj) ((unsigned) (uintptr_t) (obj)->data)
+
+/* Per-site inline cache of open-coded slot accesses: the wrapper of
+   the last instance accessed at the site, and the index of the slot
+   in its layout. */
+struct ell_slot_cache {
+    struct ell_wrapper *wrapper;
+    unsigned index;
+};
+
+/* Per-site cache of MAKE with keyword arguments: the wrapper of the
+   class last instantiated at the site, and the indexes of the slots
+   named by the keywords in its layout. */
+struct ell_make_cache {
+    struct ell_wrapper *wrapper;
+    unsigned *indexes;
+};
+
+/* .all_superclasses: Flattened vector of all direct and indirect
+   superclasses, computed lazily for the fast subclass test.  It is
+   valid only if .all_superclasses_epoch equals the global class
+   hierarchy epoch, which gets bumped whenever a superclass is
+   added to any class. */
 struct ell_class_data {
     struct ell_obj *name;
     list_t *superclasses;
     struct ell_wrapper *wrapper;
     unsigned *type_params_ct;
+    struct ell_obj **all_superclasses;
+    unsigned all_superclasses_ct;
+    unsigned all_superclasses_epoch;
 };
 
 struct ell_obj *
 ell_make_obj(struct ell_wrapper *wrapper, void *data);
 struct ell_obj *
+ell_make_instance(struct ell_wrapper *wrapper);
+void
+ell_put_class_option(struct ell_obj *class, struct ell_obj *option);
+int
+ell_slot_index(struct ell_wrapper *wrapper, struct ell_obj *slot_sym, bool add);
+struct ell_obj *
 ell_slot_value(struct ell_obj *obj, struct ell_obj *slot_sym);
 struct ell_obj *
 ell_set_slot_value(struct ell_obj *obj, struct ell_obj *slot_sym, struct ell_obj *val);
@@ -110,9 +180,6 @@ struct ell_obj *__ell_g_LsyntaxDsymbolG_1_;
 struct ell_obj *__ell_g_LunspecifiedG_1_;
 struct ell_obj *__ell_g_LconditionG_1_;
 
-/* As a special case, `signal' is used from C but written in Lisp. */
-struct ell_obj *__ell_g_signal_2_;
-
 /**** Closures ****/
 
 /* The calling convention for closures: the closure receives itself as
@@ -139,6 +206,16 @@ struct ell_clo_data {
     void *env;
 };
 
+/* The link of a top-level function holds the closure that the
+   function's last definition made, and its code, which compiled code
+   calls directly while the function's global still holds the closure
+   (see `ellc_link' in `ellc.h'). */
+
+struct ell_link {
+    struct ell_obj *clo;
+    ell_code *code;
+};
+
 struct ell_obj *
 ell_make_clo(ell_code *code, void *env);
 void *
@@ -231,25 +308,123 @@ ell_send(struct ell_obj *rcv, struct ell_obj *generic,
 
 /**** Control Flow ****/
 
+/* Dynamic (special) variables use shallow binding: a global
+   variable's value cell always contains the current value, and a
+   dynamic binding saves the variable's previous value in a frame on
+   the C stack, from where it is restored when the binding's extent is
+   exited, either normally or through a non-local exit.  This makes
+   binding and unbinding O(1), and variable access as fast as for any
+   other global variable. */
+struct ell_dynamic_binding {
+    struct ell_dynamic_binding *parent;
+    struct ell_obj **cell;
+    struct ell_obj *old_value;
+};
+
+/* Unwind-protects and blocks remember the dynamic bindings in effect
+   when they were established, so that non-local exits can restore
+   them, and so that cleanups run with the correct bindings. */
+
+struct ell_handler;
+struct ell_restart;
+
 struct ell_unwind_protect {
     struct ell_unwind_protect *parent;
+    struct ell_dynamic_binding *dynamic_binding;
+    struct ell_handler *handler;
+    struct ell_restart *restart;
     struct ell_obj *cleanup;
 };
 
 struct ell_block {
     struct ell_unwind_protect *parent;
+    struct ell_dynamic_binding *dynamic_binding;
+    struct ell_handler *handler;
+    struct ell_restart *restart;
     struct ell_obj *volatile val;
     jmp_buf dest;
 };
 
 struct ell_unwind_protect *ell_current_unwind_protect;
+struct ell_dynamic_binding *ell_current_dynamic_binding;
 
+void
+ell_unwind_dynamic_bindings(struct ell_dynamic_binding *dynamic_binding);
+
+void
+ell_init_block(struct ell_block *block);
+void
+ell_return_from(struct ell_block *block, struct ell_obj *val);
 struct ell_obj *
 ell_block(struct ell_obj *fun);
 
 struct ell_obj *
 ell_unwind_protect(struct ell_obj *protected, struct ell_obj *cleanup);
 
+/**** Multiple Values ****/
+
+/* VALUES returns its first value, and stores all of its values in the
+   multiple values buffer, from where MULTIPLE-VALUE-BIND reads the
+   extra values.  Compiled code clears the buffer whenever a value
+   that's returned, or bound by MULTIPLE-VALUE-BIND, doesn't come
+   directly from VALUES or a call, so that stale extra values, stored
+   by some other call to VALUES, aren't seen by a caller of a function
+   that returns a single value (see `ellc_ir_clear_values').  Builtins
+   that call functions, and return something other than the value of
+   such a call, clear the buffer themselves before returning. */
+
+#define ELL_MAX_VALUES 16
+
+extern struct ell_obj *ell_values_buf[ELL_MAX_VALUES];
+extern unsigned ell_values_ct;
+
+struct ell_obj *
+ell_multiple_value_ref(struct ell_obj *primary, unsigned i);
+
+/**** Conditions ****/
+
+/* Condition handlers form a stack of frames on the C stack, much like
+   dynamic bindings.  Signalling a condition walks the stack from the
+   innermost handler outwards, and calls the function of the first
+   handler whose class the condition is an instance of with the
+   condition and a resume function.  The handler function runs with
+   only the handlers outside of its own handler in effect.  If it
+   returns normally, it declines, and the search continues outwards.
+   If it calls the resume function with a value, `signal' returns
+   that value.  Like a block's escape function, the resume function
+   has dynamic extent.  Neither handler lookup nor resumption
+   allocate memory. */
+struct ell_handler {
+    struct ell_handler *parent;
+    struct ell_obj *class;
+    struct ell_obj *function;
+};
+
+struct ell_handler *ell_current_handler;
+
+struct ell_obj *
+ell_handler_bind(struct ell_obj *class, struct ell_obj *function, struct ell_obj *body);
+struct ell_obj *
+ell_signal(struct ell_obj *condition);
+
+/* Restarts are kept on a separate stack, so that they remain visible
+   to handler functions, which run with the handler stack unwound.  A
+   restart is named by a class, and is simply an exit point: invoking
+   it performs a non-local exit to the point where the restart was
+   established, returning a value from there. */
+struct ell_restart {
+    struct ell_restart *parent;
+    struct ell_obj *class;
+    struct ell_block *block;
+};
+
+struct ell_restart *ell_current_restart;
+
+struct ell_obj *
+ell_with_restart(struct ell_obj *class, struct ell_obj *body);
+void
+ell_invoke_restart(struct ell_obj *class, struct ell_obj *val);
+
 /**** Strings ****/
 
 struct ell_str_data {
@@ -281,6 +456,16 @@ struct ell_obj *
 ell_make_num_from_int(int i);
 int
 ell_num_int(struct ell_obj *num);
+__attribute__((cold)) void
+ell_num_overflow();
+struct ell_obj *
+ell_num_add(struct ell_obj *num1, struct ell_obj *num2);
+struct ell_obj *
+ell_num_sub(struct ell_obj *num1, struct ell_obj *num2);
+struct ell_obj *
+ell_num_mul(struct ell_obj *num1, struct ell_obj *num2);
+struct ell_obj *
+ell_num_lt(struct ell_obj *num1, struct ell_obj *num2);
 
 /**** Symbols ****/
 
@@ -312,10 +497,17 @@ struct ell_obj *__ell_g_Of_1_;
 struct ell_obj *ell_t;
 struct ell_obj *ell_f;
 
-bool
-ell_is_true(struct ell_obj *obj);
-struct ell_obj *
-ell_truth(bool b);
+static inline bool
+ell_is_true(struct ell_obj *obj)
+{
+    return obj != ell_f;
+}
+
+static inline struct ell_obj *
+ell_truth(bool b)
+{
+    return b ? ell_t : ell_f;
+}
 
 /**** Unspecified value ****/
 
@@ -449,14 +641,21 @@ ell_ptr_cmp(void *a, void *b);
 
 __attribute__((weak)) struct ell_obj *ell_result;
 
-void
+__attribute__((cold)) void
 ell_arity_error();
 struct ell_obj *
 ell_unbound_arg();
-struct ell_obj *
+__attribute__((cold)) struct ell_obj *
 ell_unbound_var(char *name);
-struct ell_obj *
+__attribute__((cold)) struct ell_obj *
 ell_unbound_fun(char *name);
+struct ell_obj *
+ell_make_with_slots(struct ell_make_cache *cache, struct ell_obj *class, unsigned nslots, ...);
+struct ell_obj *
+ell_slot_value_miss(struct ell_slot_cache *cache, struct ell_obj *obj, struct ell_obj *slot_sym);
+struct ell_obj *
+ell_set_slot_value_miss(struct ell_slot_cache *cache, struct ell_obj *obj,
+                        struct ell_obj *slot_sym, struct ell_obj *val);
 struct ell_obj **
 ell_make_box(struct ell_obj *value);
 struct ell_obj *
@@ -466,27 +665,189 @@ ell_box_write(struct ell_obj **box, struct ell_obj *value);
 struct ell_obj *
 ell_lookup_key(struct ell_obj *key_sym, ell_arg_ct npos, ell_arg_ct nkey,
                struct ell_obj **args);
+struct ell_obj *
+ell_make_rest_lst(ell_arg_ct start, ell_arg_ct npos, struct ell_obj **args);
 
 /**** Emitted Code Macros ****/
 
 // mid = mangled ID
 // sid = original ID literal string
 
-#define ELL_GEN_GLO_REF(mid, sid)  (mid != ell_unbound ? mid : ell_unbound_var(sid))
-#define ELL_GEN_GLO_FREF(mid, sid) (mid != ell_unbound ? mid : ell_unbound_fun(sid))
+/* The emitted code is flat: arguments of these macros are temporaries,
+   locals or constants, and most macros are used as statements.  Cold
+   paths (arity errors, unbound variables, overflow, slow arithmetic)
+   are marked for the C compiler. */
+#define ELL_LIKELY(x)   __builtin_expect(!!(x), 1)
+#define ELL_UNLIKELY(x) __builtin_expect(!!(x), 0)
+
+#define ELL_GEN_GLO_REF(mid, sid)  (ELL_LIKELY(mid != ell_unbound) ? mid : ell_unbound_var(sid))
+#define ELL_GEN_GLO_FREF(mid, sid) (ELL_LIKELY(mid != ell_unbound) ? mid : ell_unbound_fun(sid))
+#define ELL_GEN_GLO_REF_BOUND(mid) (mid)
 #define ELL_GEN_ARG_REF_PLAIN(mid) (mid)
-#define ELL_GEN_ARG_REF_BOXED(mid) (ell_box_read(mid))
+#define ELL_GEN_ARG_REF_BOXED(mid) (*(struct ell_obj **) (mid))
 #define ELL_GEN_ENV_REF_PLAIN(mid) (__ell_env->mid)
-#define ELL_GEN_ENV_REF_BOXED(mid) (ell_box_read(__ell_env->mid))
+#define ELL_GEN_ENV_REF_BOXED(mid) (*(struct ell_obj **) (__ell_env->mid))
 #define ELL_GEN_DEF(mid, val)      (mid = val)
 #define ELL_GEN_DEFP(mid)          (mid != ell_unbound ? ell_t : ell_f)
-#define ELL_GEN_GLO_SET(mid, sid, val)  ({ if (mid == ell_unbound) ell_unbound_var(sid); mid = val; })
+#define ELL_GEN_GLO_SET(mid, sid, val)                                  \
+    do { if (ELL_UNLIKELY(mid == ell_unbound)) ell_unbound_var(sid); mid = val; } while (0)
+#define ELL_GEN_GLO_SET_BOUND(mid, val) (mid = val)
+/* Functions exported for inlining into, or direct calls from, other
+   units (see `ellc_inline' and `ellc_link' in `ellc.h'). */
+#define ELL_GEN_SET_CELL(cell, val) (cell = val)
+#define ELL_GEN_CHECK_INLINED(mid, cell, flag)                          \
+    (flag = ((cell != NULL) && (mid == cell)))
+#define ELL_GEN_SET_LINK(link, val)                                     \
+    (link.clo = val, link.code = ((struct ell_clo_data *) (val)->data)->code)
+#define ELL_GEN_LINKED_CALL(link, fun, npos, nkey, args)                \
+    (ELL_LIKELY(fun == link.clo)                                        \
+     ? link.code(fun, npos, nkey, args) : ell_call(fun, npos, nkey, args))
+/* Open-coded VALUES and MULTIPLE-VALUE-REF with a literal index of
+   an extra value (see `ell_multiple_value_ref'), and clearing of the
+   multiple values buffer. */
+#define ELL_GEN_VALUES(n, ...)                                          \
+    ({                                                                  \
+        struct ell_obj *__ell_vals[] = { __VA_ARGS__ };                 \
+        memcpy(ell_values_buf, __ell_vals, sizeof(__ell_vals));         \
+        ell_values_ct = (n);                                            \
+        __ell_vals[0];                                                  \
+    })
+#define ELL_GEN_MULTIPLE_VALUE_REF(primary, i)                          \
+    ((void) (primary), ((i) < ell_values_ct) ? ell_values_buf[i] : ell_unspecified)
+#define ELL_GEN_CLEAR_VALUES() (ell_values_ct = 0)
+/* Open-coded SLOT-VALUE and SET-SLOT-VALUE with a quoted slot name:
+   if the instance has the wrapper in the site's cache, the slot is
+   accessed by index, otherwise the slow path looks it up by name and
+   fills the cache.  Handles of pooled instances never fill it. */
+#define ELL_GEN_INSTANCE(obj) ((struct ell_instance_data *) (obj)->data)
+#define ELL_GEN_SLOT_VALUE(cache, obj, sym)                             \
+    (ELL_LIKELY(((obj)->wrapper == cache.wrapper)                       \
+                && (cache.index < ELL_GEN_INSTANCE(obj)->slots_ct)      \
+                && (ELL_GEN_INSTANCE(obj)->slots[cache.index] != NULL)) \
+     ? ELL_GEN_INSTANCE(obj)->slots[cache.index]                        \
+     : ell_slot_value_miss(&cache, obj, sym))
+#define ELL_GEN_SET_SLOT_VALUE(cache, obj, sym, val)                    \
+    (ELL_LIKELY(((obj)->wrapper == cache.wrapper)                       \
+                && (cache.index < ELL_GEN_INSTANCE(obj)->slots_ct))     \
+     ? (ELL_GEN_INSTANCE(obj)->slots[cache.index] = val)                \
+     : ell_set_slot_value_miss(&cache, obj, sym, val))
 #define ELL_GEN_ARG_SET_PLAIN(mid, val) (mid = val)
-#define ELL_GEN_ARG_SET_BOXED(mid, val) (ell_box_write(mid, val))
+#define ELL_GEN_ARG_SET_BOXED(mid, val) (*(struct ell_obj **) (mid) = val)
 #define ELL_GEN_ENV_SET_PLAIN(mid, val) (__ell_env->mid = val)
-#define ELL_GEN_ENV_SET_BOXED(mid, val) (ell_box_write(__ell_env->mid, val))
-#define ELL_GEN_COND(test, _then, _else) (ell_is_true(test) ? _then : _else)
-#define ELL_GEN_LOOP(expr)              ({ for(;;) { expr; }; ell_unspecified; })
+#define ELL_GEN_ENV_SET_BOXED(mid, val) (*(struct ell_obj **) (__ell_env->mid) = val)
+/* Closures of lambdas that don't escape, see `ellc_ast_lam'. */
+#define ELL_GEN_STACK_CLO_DECL(env_type, name)                          \
+    struct ell_obj name; struct ell_clo_data name##_data; env_type name##_env
+#define ELL_GEN_STACK_ENV(name)         (&name##_env)
+#define ELL_GEN_STACK_CLO(name, _code)                                  \
+    ({ name##_data.code = _code; name##_data.env = &name##_env;         \
+       name.wrapper = ELL_WRAPPER(clo); name.data = &name##_data; &name; })
+
+/* Function prologues. */
+#define ELL_GEN_CHECK_ARITY_MIN(n)                                      \
+    do { if (ELL_UNLIKELY(__ell_npos < (n))) ell_arity_error(); } while (0)
+#define ELL_GEN_CHECK_ARITY_MAX(n)                                      \
+    do { if (ELL_UNLIKELY(__ell_npos > (n))) ell_arity_error(); } while (0)
+#define ELL_GEN_ARG_SUPPLIED(i)    (__ell_npos > (i))
+#define ELL_GEN_KEY_SUPPLIED(val)  ((val) != NULL)
+
+/* Open-coded arithmetic: the fast path handles integers inline, the
+   slow path (other types, overflow) is out of line. */
+#define ELL_GEN_NUM_INT(num) (((struct ell_num_int_data *) (num)->data)->int_value)
+#define ELL_GEN_THE_INT(num) (ell_assert_wrapper(num, ELL_WRAPPER(num_int)), (num))
+#define ELL_GEN_NUM_INTS_P(num1, num2)                                  \
+    ((num1->wrapper == ELL_WRAPPER(num_int)) && (num2->wrapper == ELL_WRAPPER(num_int)))
+#define ELL_GEN_ARITH(overflow_op, slow, a, b)                          \
+    ({                                                                  \
+        struct ell_obj *__ell_num1 = a;                                 \
+        struct ell_obj *__ell_num2 = b;                                 \
+        int __ell_num_res;                                              \
+        ELL_LIKELY(ELL_GEN_NUM_INTS_P(__ell_num1, __ell_num2)          \
+                   && !overflow_op(ELL_GEN_NUM_INT(__ell_num1),         \
+                                   ELL_GEN_NUM_INT(__ell_num2),         \
+                                   &__ell_num_res))                     \
+            ? ell_make_num_from_int(__ell_num_res)                      \
+            : slow(__ell_num1, __ell_num2);                             \
+    })
+#define ELL_GEN_ADD(a, b) ELL_GEN_ARITH(__builtin_add_overflow, ell_num_add, a, b)
+#define ELL_GEN_SUB(a, b) ELL_GEN_ARITH(__builtin_sub_overflow, ell_num_sub, a, b)
+#define ELL_GEN_MUL(a, b) ELL_GEN_ARITH(__builtin_mul_overflow, ell_num_mul, a, b)
+#define ELL_GEN_LT(a, b)                                                \
+    ({                                                                  \
+        struct ell_obj *__ell_num1 = a;                                 \
+        struct ell_obj *__ell_num2 = b;                                 \
+        ELL_LIKELY(ELL_GEN_NUM_INTS_P(__ell_num1, __ell_num2))          \
+            ? ell_truth(ELL_GEN_NUM_INT(__ell_num1) < ELL_GEN_NUM_INT(__ell_num2)) \
+            : ell_num_lt(__ell_num1, __ell_num2);                       \
+    })
+
+/* Arithmetic on unboxed integers. */
+#define ELL_GEN_INT_ARITH(overflow_op, a, b)                            \
+    ({                                                                  \
+        int __ell_int_res;                                              \
+        if (ELL_UNLIKELY(overflow_op(a, b, &__ell_int_res)))            \
+            ell_num_overflow();                                         \
+        __ell_int_res;                                                  \
+    })
+#define ELL_GEN_ADD_INT(a, b) ELL_GEN_INT_ARITH(__builtin_add_overflow, a, b)
+#define ELL_GEN_SUB_INT(a, b) ELL_GEN_INT_ARITH(__builtin_sub_overflow, a, b)
+#define ELL_GEN_MUL_INT(a, b) ELL_GEN_INT_ARITH(__builtin_mul_overflow, a, b)
+#define ELL_GEN_LT_INT(a, b) ((a) < (b))
+/* Comparisons of an unboxed integer with an object, which is unboxed
+   too if it's an integer. */
+#define ELL_GEN_LT_INT_OBJ(a, b)                                        \
+    ({                                                                  \
+        int __ell_int = a;                                              \
+        struct ell_obj *__ell_num = b;                                  \
+        ELL_LIKELY(__ell_num->wrapper == ELL_WRAPPER(num_int))          \
+            ? (__ell_int < ELL_GEN_NUM_INT(__ell_num))                  \
+            : ell_is_true(ell_num_lt(ell_make_num_from_int(__ell_int), __ell_num)); \
+    })
+#define ELL_GEN_LT_OBJ_INT(a, b)                                        \
+    ({                                                                  \
+        struct ell_obj *__ell_num = a;                                  \
+        int __ell_int = b;                                              \
+        ELL_LIKELY(__ell_num->wrapper == ELL_WRAPPER(num_int))          \
+            ? (ELL_GEN_NUM_INT(__ell_num) < __ell_int)                  \
+            : ell_is_true(ell_num_lt(__ell_num, ell_make_num_from_int(__ell_int))); \
+    })
+
+/* Tests: these produce C conditions instead of boolean objects, for
+   use in branches. */
+#define ELL_GEN_TRUE(expr)         (ell_is_true(expr))
+#define ELL_GEN_DEFP_TEST(mid)     (mid != ell_unbound)
+#define ELL_GEN_TYPEQ_TEST(obj, class) (ell_is_instance(obj, class))
+#define ELL_GEN_LT_TEST(a, b)                                           \
+    ({                                                                  \
+        struct ell_obj *__ell_num1 = a;                                 \
+        struct ell_obj *__ell_num2 = b;                                 \
+        ELL_LIKELY(ELL_GEN_NUM_INTS_P(__ell_num1, __ell_num2))          \
+            ? (ELL_GEN_NUM_INT(__ell_num1) < ELL_GEN_NUM_INT(__ell_num2)) \
+            : ell_is_true(ell_num_lt(__ell_num1, __ell_num2));          \
+    })
+
+/* Conversions of strings for calls of C functions. */
+#define ELL_GEN_STR_CHARS(str) (((struct ell_str_data *) (str)->data)->chars)
+#define ELL_GEN_C_STR(chars)                                            \
+    ({                                                                  \
+        char *__ell_chars = chars;                                      \
+        __ell_chars ? ell_make_str(__ell_chars) : ell_f;                \
+    })
+
+/* Dynamic binding, DYN is a `struct ell_dynamic_binding' local. */
+#define ELL_GEN_DLET_BIND(dyn, mid, sid, val)                           \
+    do {                                                                \
+        dyn.parent = ell_current_dynamic_binding;                       \
+        dyn.cell = &mid;                                                \
+        dyn.old_value = ELL_GEN_GLO_REF(mid, sid);                      \
+        ell_current_dynamic_binding = &dyn;                             \
+        mid = val;                                                      \
+    } while (0)
+#define ELL_GEN_DLET_UNBIND(dyn, mid)                                   \
+    do {                                                                \
+        ell_current_dynamic_binding = dyn.parent;                       \
+        mid = dyn.old_value;                                            \
+    } while (0)
 
 /**** Misc ****/
 
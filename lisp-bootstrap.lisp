@@ -2,10 +2,8 @@
   (ell-lam (defmacro-form)
     #`(ell-mdef ,(second defmacro-form)
         (ell-lam (macro-call-form)
-          (apply-syntax-list
-            (ell-lam ,(third defmacro-form)
-              ,(fourth defmacro-form))
-            (syntax-list-rest macro-call-form))))))
+          (ell-mbind ,(third defmacro-form) macro-call-form
+            ,(fourth defmacro-form))))))
 
 (defmacro defsyntax (name expander)
   #`(ell-mdef ,name ,expander))
@@ -58,12 +56,27 @@
 (defmacro fsetq (name value)
   #`(ell-fset ,name ,value))
 
+(defmacro declare (&rest specs)
+  #`(ell-declare ,@specs))
+
+(defmacro the (type expr)
+  #`(ell-the ,type ,expr))
+
+(defmacro load-time-value (expr)
+  #`(ell-ltv ,expr))
+
+(defmacro compile-time-value (expr)
+  #`(ell-ctv ,expr))
+
 (defmacro c-expression (&rest exprs)
   #`(ell-snip ,@exprs))
 
 (defmacro c-statement (&rest exprs)
   #`(ell-stmt ,@exprs))
 
+(defmacro define-c-function (name c-name param-types result-type)
+  #`(ell-cfun ,name ,c-name ,param-types ,result-type))
+
 (defmacro block (label &rest body)
   #`(block/f (lambda (,label) ,@body)))
 
@@ -78,11 +91,7 @@
   #`(ell-loop (progn ,@exprs)))
 
 (defmacro while (test &rest body)
-  #`(block exit
-      (loop
-         (if ,test 
-             (progn ,@body)
-             (return-from exit unspecified)))))
+  #`(ell-while ,test (progn ,@body)))
 
 (defmacro until (test &rest body)
   #`(while (not ,test) ,@body))
@@ -92,6 +101,12 @@
                ,@body)
              ,@(map-list (lambda (binding) (send binding (function second))) bindings)))
 
+(defmacro multiple-value-bind (vars expr &rest body)
+  #`(ell-mvb ,vars ,expr (progn ,@body)))
+
+(defmacro nth-value (n expr)
+  #`(multiple-value-ref ,expr ,n))
+
 (defmacro do (vars test &rest body)
   #`(let ,(map-list (lambda (var)
                       #`(,(send var (function first))
@@ -104,13 +119,16 @@
                               ,(send var (function third))))
                     vars))))
 
-(defmacro defclass (name &optional (superclasses #'()) &rest slot-specs)
+(defmacro defclass (name &optional (superclasses #'()) &rest slot-specs &key (options #'()))
   #`(progn
       (defvar ,name (make-class ',name))
       (add-superclass ,name <object>)
       ,@(map-list (lambda (superclass)
                     #`(add-superclass ,name ,superclass))
                   superclasses)
+      ,@(map-list (lambda (option)
+                    #`(put-class-option ,name ',option))
+                  options)
       ',name))
 
 (defmacro defgeneric (name &optional params)
@@ -137,10 +155,7 @@
   #`(c-expression ,@snippets))
 
 (defmacro fluid-let (name value &rest body)
-  #`(let ((tmp ,name))
-      (setq ,name ,value)
-      (unwind-protect (progn ,@body)
-        (setq ,name tmp))))
+  #`(ell-dlet ,name ,value (progn ,@body)))
 
 (defclass <string>)
 (defclass <symbol>)
@@ -160,69 +175,20 @@
   name)
 (defclass <unbound-function> (<condition>)
   name)
+(defclass <compile-error> (<condition>)
+  form)
 
 (defclass <restart> (<condition>))
 (defclass <use-value> (<restart>)
   value)
 
-(defclass <handler>)
-
-(defclass <default-handler> (<handler>))
-
-(defclass <user-handler> (<handler>)
-  condition-class
-  handler-function
-  next-handler)
-
-(defmethod print-object ((h <handler>))
-  (print-object '#<handler>))
-
-(defun make-user-handler (condition-class handler-function next-handler)
-  (let ((h (make <user-handler>)))
-    (set-slot-value h 'condition-class condition-class)
-    (set-slot-value h 'handler-function handler-function)
-    (set-slot-value h 'next-handler next-handler)
-    h))
-
-(defparameter *current-handler* (make <default-handler>))
-
-(defgeneric handle-condition (handler condition))
-
-(defmethod handle-condition ((h <default-handler>) (c <condition>))
-  (print condition)
-  (exit))
-
-(defmethod handle-condition ((h <user-handler>) (c <condition>))
-  (if (handler-matches? h condition)
-      (funcall (slot-value h 'handler-function)
-               condition
-               (lambda ()
-                 (handle-condition (slot-value h 'next-handler) condition)))
-      (handle-condition (slot-value h 'next-handler) condition)))
-
-(defgeneric handler-matches? (user-handler condition))
-
-(defmethod handler-matches? ((h <user-handler>) (c <condition>))
-  (type? condition (slot-value h 'condition-class)))
-
-(defun handler-bind/f (condition-class user-handler-function body-thunk)
-  (let ((the-handler-function (lambda (condition call-next-handler)
-                                (block resume
-                                  (funcall user-handler-function
-                                           condition
-                                           (lambda (value) (return-from resume value)))
-                                  (funcall call-next-handler)))))
-    (fluid-let *current-handler* (make-user-handler condition-class
-                                                    the-handler-function
-                                                    *current-handler*)
-      (funcall body-thunk))))
-
 (defmacro handler-bind (condition-class user-handler-function &rest body)
   #`(handler-bind/f ,condition-class ,user-handler-function
                     (lambda () ,@body)))
 
-(defun signal (condition)
-  (handle-condition *current-handler* condition))
+(defun invoke-debugger (condition)
+  (print condition)
+  (exit))
 
 (defun warn (condition)
   (signal condition)
@@ -232,8 +198,12 @@
   (signal condition)
   (invoke-debugger condition))
 
+(defmacro with-restart (restart-class &rest body)
+  #`(with-restart/f ,restart-class (lambda () ,@body)))
+
 (defun cerror (condition)
-  (block use-value
-    (handler-bind <use-value> (lambda (restart resume)
-                                (return-from use-value (slot-value restart 'value)))
-      (error condition))))
+  (with-restart <use-value>
+    (error condition)))
+
+(defun use-value (value)
+  (invoke-restart <use-value> value))
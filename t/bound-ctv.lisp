@@ -0,0 +1,2 @@
+(print (compile-time-value (progn (defvar zz 1) 2)))
+(print zz)
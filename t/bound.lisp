@@ -0,0 +1,18 @@
+(defun twice (x) (* x 2))
+(print (twice 21))
+(defun call-later () (later 1))
+(defun later (x) (+ x 1))
+(print (call-later))
+(let ((i 0))
+  (while (< i 3)
+    (print (later i))
+    (setq i (+ i 1))))
+(print (definedp never-defined))
+(defun count-with (n)
+  (let ((i 0))
+    (while (< i n)
+      (setq i (step i)))
+    i))
+(defun step (i) (+ i 1))
+(print (count-with 5))
+(print (count-with 0))
@@ -0,0 +1,22 @@
+(c-statement "static int ell_cfun_total = 0;")
+(c-statement "static void ell_cfun_bump(int n) { ell_cfun_total += n; }")
+(c-statement "static int ell_cfun_total_get(void) { return ell_cfun_total; }")
+
+(define-c-function c-abs "abs" (<integer>) <integer>)
+(define-c-function c-atoi "atoi" (<string>) <integer>)
+(define-c-function c-getenv "getenv" (<string>) <string>)
+(define-c-function c-strcmp "strcmp" (<string> <string>) <boolean>)
+(define-c-function bump "ell_cfun_bump" (<integer>) <unspecified>)
+(define-c-function total "ell_cfun_total_get" () <integer>)
+
+(defun absolute (x) (c-abs x))
+
+(print (c-abs -42))
+(print (+ (c-atoi "40") 2))
+(print (c-getenv "ELL_CFUN_SURELY_UNSET"))
+(print (if (c-strcmp "a" "b") "differ" "same"))
+(bump 3)
+(bump 4)
+(print (total))
+(print (absolute -5))
+(print (funcall (function c-abs) -7))
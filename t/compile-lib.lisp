@@ -0,0 +1 @@
+(defvar x 7)
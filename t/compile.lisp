@@ -0,0 +1,25 @@
+(defun make-adder (n)
+  (compile #`(lambda (x) (+ x ,n))))
+
+(defvar add5 (make-adder 5))
+(print (funcall add5 10))
+(print (funcall (make-adder 100) 1))
+
+(defvar rule
+  (compile #'(lambda (s) (if (type? s <string>) "string" "other"))))
+(print (funcall rule "x"))
+(print (funcall rule 1))
+
+(defvar body #'x)
+(print (funcall (compile #`(lambda (x) ,body)) 1))
+(c-statement "static char ell_compile_quoted[] = { 'a', 34, 92, 'b', 0 };")
+(c-statement "static char *ell_compile_quoted_get(void) { return ell_compile_quoted; }")
+(define-c-function quoted-string "ell_compile_quoted_get" () <string>)
+(defvar quoted (quoted-string))
+(print (funcall (compile #`(lambda () ,quoted))))
+(defun try-compile (form)
+  (block out
+    (handler-bind <compile-error> (lambda (c resume) (return-from out "error"))
+      (compile form))))
+(print (try-compile #`(lambda () ,(function print))))
+(print (try-compile #'12))
@@ -0,0 +1,26 @@
+(defclass <my-cond> (<condition>))
+(defclass <sub-cond> (<my-cond>))
+(print (block out
+  (handler-bind <my-cond> (lambda (c resume) (return-from out "handled"))
+    (signal (make <sub-cond>))
+    "not handled")))
+(print (handler-bind <my-cond> (lambda (c resume) (funcall resume "resumed"))
+  (signal (make <my-cond>))))
+(print (handler-bind <my-cond> (lambda (c resume) (funcall resume "outer"))
+  (handler-bind <my-cond> (lambda (c resume) "decline")
+    (signal (make <my-cond>)))))
+(print (handler-bind <my-cond> (lambda (c resume) (funcall resume "outer"))
+  (handler-bind <my-cond> (lambda (c resume) (funcall resume (signal c)))
+    (signal (make <my-cond>)))))
+(print (signal (make <my-cond>)))
+(print (handler-bind <my-cond> (lambda (c resume) (use-value 42))
+  (cerror (make <my-cond>))))
+(defun loop-signal (n)
+  (let ((i 0) (acc 0))
+    (handler-bind <my-cond> (lambda (c resume) (funcall resume 1))
+      (while (< i n)
+        (setq acc (+ acc (signal c)))
+        (setq i (+ i 1))))
+    acc))
+(defvar c (make <my-cond>))
+(print (loop-signal 1000))
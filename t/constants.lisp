@@ -0,0 +1,11 @@
+(defun show (&key (name 'none))
+  (print name))
+(let ((i 0))
+  (while (< i 2)
+    (print 'sym)
+    (print "str")
+    (print 42)
+    (show)
+    (setq i (+ i 1))))
+(print (type? 'sym <symbol>))
+(print (type? "str" <string>))
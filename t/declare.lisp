@@ -0,0 +1,31 @@
+(defun add2 (x y)
+  (declare (type <integer> x y) (optimize speed))
+  (+ x y))
+(print (add2 40 2))
+
+(defun twice (x)
+  (* 2 (the <integer> x)))
+(print (twice 21))
+(print (the <integer> 7))
+(print (the <string> "str"))
+
+(defun count-up (n)
+  (declare (optimize (safety 0)) (type <integer> n))
+  (let ((i 0) (sum 0))
+    (declare (type <integer> i))
+    (while (< i n)
+      (setq sum (+ sum i))
+      (setq i (+ i 1)))
+    sum))
+(print (count-up 100))
+
+(defvar inc (lambda (x) (+ x 1)))
+(defun call-inc (x)
+  (declare (optimize (safety 0)))
+  (funcall inc x))
+(print (call-inc 1))
+
+(declare (optimize (safety 0)))
+(defun unsafe-add (a b)
+  (+ (the <integer> a) b))
+(print (unsafe-add 1 2))
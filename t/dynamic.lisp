@@ -0,0 +1,10 @@
+(defvar *d* 1)
+(defun get-d () *d*)
+(print (fluid-let *d* 2 (fluid-let *d* 3 (get-d))))
+(print (get-d))
+(print (block out (fluid-let *d* 5 (fluid-let *d* 6 (return-from out (get-d))))))
+(print (get-d))
+(print (block out (fluid-let *d* 7 (unwind-protect (return-from out 0) (print (get-d))))))
+(print (get-d))
+(print (fluid-let *d* 8 (setq *d* 9) (get-d)))
+(print (get-d))
@@ -0,0 +1,8 @@
+(defun f (x) (if #t (+ x (* 2 3)) (undefined-function)))
+(print (f 1))
+(print (< 1 2))
+(print (- 10 (+ 2 3)))
+(let ((#t #f))
+  (print (if #t "not-shadowed" "shadowed")))
+(unless #f (print "unless"))
+(progn 'ignored (progn 1 2 (print (when (< 2 1) "never"))))
@@ -0,0 +1,6 @@
+(declare (inline twice thrice))
+(defun twice (x) (* x 2))
+(print (twice 1))
+(defun thrice (x) (* x 3))
+(fsetq thrice (lambda (x) 'thrice-redefined))
+(defun plain (x) (+ x 1))
@@ -0,0 +1,9 @@
+(defun use-twice (x) (twice x))
+(print (use-twice 21))
+(fsetq twice (lambda (x) 'redefined))
+(defvar *twice* (function twice))
+(print (funcall *twice* 21))
+(print (use-twice 21))
+(print (thrice 1))
+(fsetq plain (lambda (x) 'plain-redefined))
+(print (plain 1))
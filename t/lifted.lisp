@@ -0,0 +1,33 @@
+(defun sum-of-squares (a b)
+  (let ((square (lambda (x) (* x x))))
+    (+ (funcall square a) (funcall square b))))
+(print (sum-of-squares 3 4))
+(defun scaled-sum (k n)
+  (let ((scale (lambda (x) (* k x)))
+        (i 0)
+        (acc 0))
+    (while (< i n)
+      (setq acc (+ acc (funcall scale i)))
+      (setq i (+ i 1)))
+    acc))
+(print (scaled-sum 2 10))
+(defun bump-all (n)
+  (let ((count 0))
+    (let ((bump (lambda () (setq count (+ count 1)))))
+      (let ((i 0))
+        (while (< i n)
+          (funcall bump)
+          (setq i (+ i 1))))
+      count)))
+(print (bump-all 5))
+(defun escaping (k)
+  (let ((add (lambda (x) (+ k x))))
+    (funcall add 1)
+    add))
+(print (funcall (escaping 40) 2))
+(defun bumped-reader ()
+  (let ((count 0))
+    (let ((bump (lambda () (setq count (+ count 1)))))
+      (funcall bump)
+      (lambda () count))))
+(print (funcall (bumped-reader)))
@@ -0,0 +1,10 @@
+(defun next (x) (+ x 1))
+(defun call-next () (next 1))
+(print (call-next))
+(defun next (x) (* x 10))
+(print (call-next))
+(fsetq next (lambda (x) 'set))
+(print (call-next))
+(defun scale (x &optional (k 10)) (* x k))
+(print (scale 4))
+(print (scale 4 2))
@@ -0,0 +1,17 @@
+(defvar counter 0)
+(defun next () (setq counter (+ counter 1)) counter)
+
+(defclass <widget>)
+(defun widget-class () (load-time-value <widget>))
+(defun stamp () (load-time-value (next)))
+
+(print (stamp))
+(print (stamp))
+(print counter)
+(print (type? (make (widget-class)) <widget>))
+(print (+ (load-time-value (next)) 10))
+
+(print (compile-time-value (+ 40 2)))
+(print (compile-time-value "compiled"))
+(print (compile-time-value 'sym))
+(print (compile-time-value (< 1 2)))
@@ -0,0 +1,20 @@
+(defclass <point>)
+(defun make-point (x y) (make <point> x: x y: y))
+(defun point-sum (p) (+ (slot-value p 'x) (slot-value p 'y)))
+
+(defvar p1 (make-point 1 2))
+(print (point-sum p1))
+(defvar p2 (make-point 30 40))
+(print (point-sum p2))
+
+(defvar p3 (make <point> z: 5))
+(print (slot-value p3 'z))
+(defvar p4 (make-point 100 200))
+(set-slot-value p4 'z 300)
+(print (+ (point-sum p4) (slot-value p4 'z)))
+
+(defclass <pair>)
+(defun make-any (class) (make class x: 7 y: 8))
+(print (point-sum (make-any <pair>)))
+(print (point-sum (make-any <point>)))
+(print (slot-value (funcall (function make) <pair> x: "gen") 'x))
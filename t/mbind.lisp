@@ -0,0 +1,26 @@
+(defmacro pair (a b)
+  #`(+ ,a ,b))
+
+(defmacro opt (a &optional (b a) (c #'10))
+  #`(+ ,a (+ ,b ,c)))
+
+(defmacro last-of (first &rest more)
+  #`(progn ,first ,@more))
+
+(print (pair 1 2))
+(print (opt 1))
+(print (opt 1 2))
+(print (opt 1 2 3))
+(print (last-of 5 1 2 7))
+(print (last-of 5))
+
+(defmacro with-key (a &key (k #'1))
+  #`(+ ,a ,k))
+
+(defmacro last-or-key (&rest more &key (k #'0))
+  #`(progn ,k ,@more))
+
+(print (with-key 1))
+(print (with-key 1 k: 5))
+(print (last-or-key 3 k: 9))
+(print (last-or-key k: 9))
@@ -0,0 +1,7 @@
+(print (+ 1 2))
+(print (< 1 2))
+(print (< 3 2))
+(print (- 1 5))
+(print (* 1000 1000))
+(defun sum-to (n) (let ((i 0) (acc 0)) (while (< i n) (setq acc (+ acc i)) (setq i (+ i 1))) acc))
+(print (sum-to 10000))
@@ -0,0 +1,7 @@
+(defclass <late>)
+(defun late-x (l) (slot-value l 'x))
+
+(defvar l1 (make <late> x: 1))
+(print (late-x l1))
+(put-class-option <late> 'pooled)
+(print "not reached")
@@ -0,0 +1,26 @@
+(defclass <sample> ()
+  value weight
+  options: (pooled))
+(defclass <point> () (x 0) (y 0))
+(defun make-sample (v) (make <sample> value: v))
+(defun sample-value (s) (slot-value s 'value))
+
+(defvar s1 (make-sample 1))
+(print (sample-value s1))
+(let ((i 2))
+  (while (< i 101)
+    (make-sample i)
+    (setq i (+ i 1))))
+(print (sum-column <sample> 'value))
+(set-slot-value s1 'value 1001)
+(print (sample-value s1))
+(print (sum-column <sample> 'value))
+
+(defvar s2 (make <sample>))
+(set-slot-value s2 'value 0)
+(set-slot-value s2 'weight 3)
+(print (slot-value s2 'weight))
+(print (type? s2 <sample>))
+(let ((n 0))
+  (map-column (lambda (v) (setq n (+ n 1))) <sample> 'value)
+  (print n))
@@ -0,0 +1,25 @@
+(defclass <point>)
+(defun point-x (p) (slot-value p 'x))
+(defun set-point-x (p v) (set-slot-value p 'x v))
+
+(defvar p1 (make <point>))
+(print (set-point-x p1 1))
+(print (point-x p1))
+(funcall (function set-slot-value) p1 'y 2)
+(defvar p2 (make <point>))
+(set-slot-value p2 'y 20)
+(set-point-x p2 10)
+(print (+ (point-x p1) (point-x p2)))
+
+(defclass <other>)
+(defvar o (make <other>))
+(set-slot-value o 'z 0)
+(set-point-x o 5)
+(print (point-x o))
+(print (point-x p1))
+
+(let ((i 0) (sum 0))
+  (while (< i 10)
+    (setq sum (+ sum (slot-value p1 'y)))
+    (setq i (+ i 1)))
+  (print sum))
@@ -0,0 +1,42 @@
+(defclass <tick> (<condition>))
+(defun find-first-over (limit)
+  (let ((i 0))
+    (block found
+      (loop
+        (when (< limit i)
+          (return-from found i))
+        (setq i (+ i 1))))))
+(print (find-first-over 41))
+(defun count-cleanups (n)
+  (let ((i 0) (cleanups 0))
+    (while (< i n)
+      (unwind-protect
+          (setq i (+ i 1))
+        (setq cleanups (+ cleanups 1))))
+    cleanups))
+(print (count-cleanups 100))
+(defun count-ticks (n)
+  (let ((i 0) (ticks 0))
+    (while (< i n)
+      (handler-bind <tick> (lambda (c resume) (setq ticks (+ ticks 1)))
+        (signal (make <tick>)))
+      (setq i (+ i 1)))
+    ticks))
+(print (count-ticks 7))
+(defun escape-from-cleanup (x)
+  (block outer
+    (unwind-protect
+        (return-from outer x)
+      (setq x (+ x 1)))))
+(print (escape-from-cleanup 5))
+(defun make-counter ()
+  (let ((n 0))
+    (block b (setq n 10))
+    (lambda () (setq n (+ n 1)) n)))
+(defvar counter (make-counter))
+(funcall counter)
+(print (funcall counter))
+(defun ignore-rest (x &rest ignored) x)
+(print (ignore-rest 1 2 3))
+(defun keep-rest (&rest r) r)
+(print (keep-rest 2 3))
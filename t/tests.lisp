@@ -0,0 +1,11 @@
+(print (if (< 1 2) "a" "b"))
+(print (if (not (< 1 2)) "a" "b"))
+(print (if (type? 1 <integer>) "int" "no"))
+(print (if (type? "s" <integer>) "int" "no"))
+(print (if (definedp nope) "def" "undef"))
+(defvar yep 1)
+(print (if (definedp yep) "def" "undef"))
+(print (if (not (not 1)) "t" "f"))
+(print (if #f "t" "f"))
+(print (if (progn 1 #f) "t" "f"))
+(print (not (< 2 1)))
@@ -0,0 +1,41 @@
+(defun count-to (n)
+  (let ((i 0) (done #f))
+    (while (not done)
+      (setq i (+ i 1))
+      (when (< n i) (setq done #t)))
+    i))
+(print (count-to 10))
+
+(defun add-int (x)
+  (if (type? x <integer>) (+ x 1) "not-int"))
+(print (add-int 41))
+(print (add-int "a"))
+
+(defvar f0)
+(defvar f1)
+(let ((i 0))
+  (while (< i 2)
+    (let ((j (* (+ i 1) 10)))
+      (if (< i 1)
+          (setq f0 (lambda () j))
+          (setq f1 (lambda () j))))
+    (setq i (+ i 1))))
+(print (funcall f0))
+(print (funcall f1))
+
+(let ((n 5) (b (< 1 2)))
+  (let ((f (lambda () (setq n (+ n 1)) n)))
+    (funcall f)
+    (print (funcall f))
+    (print b)))
+
+(defun count-below (limit)
+  (let ((i 0))
+    (while (< i limit) (setq i (+ i 1)))
+    i))
+(defun count-above (limit)
+  (let ((i 10))
+    (while (< limit i) (setq i (- i 1)))
+    i))
+(print (count-below 7))
+(print (count-above 3))
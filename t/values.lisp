@@ -0,0 +1,40 @@
+(defun div-mod (a b)
+  (let ((q 0))
+    (while (< (* (+ q 1) b) (+ a 1))
+      (setq q (+ q 1)))
+    (values q (- a (* q b)))))
+
+(multiple-value-bind (q r) (div-mod 17 5)
+  (print q)
+  (print r))
+
+(defun identity-ish (x) (+ x 0))
+(multiple-value-bind (q r) (identity-ish (div-mod 9 2))
+  (print q)
+  (print (if (type? r <integer>) "stale" "single")))
+
+(multiple-value-bind (a b c) (values 1 2)
+  (print (+ a b))
+  (print (if (type? c <integer>) "int" "missing")))
+
+(print (nth-value 1 (values "first" "second")))
+(print (nth-value 0 (values "first" "second")))
+(print (funcall (function values) 7 8))
+(print (multiple-value-ref (values 'x 'y 'z) 2))
+
+(defun inner () (values #t 42))
+(defun outer () (inner) #t)
+(multiple-value-bind (a b) (outer)
+  (print a)
+  (print (if (type? b <integer>) "stale" "none")))
+
+(div-mod 9 2)
+(multiple-value-bind (a b) (+ 1 2)
+  (print (if (type? b <integer>) "stale" "none")))
+
+(defun two (x) (values x 99))
+(defun list-of (&rest elts) elts)
+(multiple-value-bind (a b) (map-list (function two) (list-of 1 2))
+  (print (if (type? b <integer>) "stale" "none")))
+(multiple-value-bind (a b) (unwind-protect (values 1 2) (two 3))
+  (print b))